@@ -13,6 +13,8 @@
 #ifndef OPENHMD_H
 #define OPENHMD_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +39,8 @@ extern "C" {
 
 /** Maximum length of a string, including termination, in OpenHMD. */
 #define OHMD_STR_SIZE 256
+/** Number of floats in OHMD_FUSION_STATE. */
+#define OHMD_FUSION_STATE_SIZE 16
 
 /** Return status codes, used for all functions that can return an error. */
 typedef enum {
@@ -55,6 +59,8 @@ typedef enum {
 	OHMD_VENDOR    = 0,
 	OHMD_PRODUCT   = 1,
 	OHMD_PATH      = 2,
+	/** Serial number reported by the device, empty if the driver doesn't know it. */
+	OHMD_SERIAL    = 3,
 } ohmd_string_value;
 
 /** A collection of string descriptions, used for getting strings with ohmd_gets(). */
@@ -151,6 +157,7 @@ typedef enum {
 	 * float[10] (set): Perform sensor fusion on values from external sensors.
 	 *
 	 * Values are: dt (time since last update in seconds) X, Y, Z gyro, X, Y, Z accelerometer and X, Y, Z magnetometer.
+	 * Use ohmd_device_push_imu_samples() to feed many samples at once.
 	 **/
 	OHMD_EXTERNAL_SENSOR_FUSION           = 19,
 
@@ -163,6 +170,18 @@ typedef enum {
 	/** float[OHMD_CONTROL_COUNT] (get): Get the state of the device's controls. */
 	OHMD_CONTROLS_STATE                = 22,
 
+	/**
+	 * float[OHMD_FUSION_STATE_SIZE] (get, set): Learned sensor fusion state, such as the gyro bias and gravity error.
+	 *
+	 * Save it when closing the device, keyed by OHMD_SERIAL and OHMD_PRODUCT, and set it right after opening the
+	 * device again so fusion starts converged and the gyro bias is only refined, not measured anew. The serial alone
+	 * is not enough: the controllers of the Rift CV1, the Rift S and NOLO report the serial of their headset. The
+	 * contents are versioned, setting state saved by an incompatible version returns OHMD_S_INVALID_PARAMETER.
+	 * Unsupported for devices that fuse on their own and for the Rift S controllers, whose driver keeps its fusion
+	 * to itself.
+	 **/
+	OHMD_FUSION_STATE                  = 23,
+
 } ohmd_float_value;
 
 /** A collection of int value information types used for getting information with ohmd_device_geti(). */
@@ -198,14 +217,71 @@ typedef enum {
 	 * This can be used to fill in information about the device internally, such as Android, or for setting profiles.
 	 **/
 	OHMD_DRIVER_PROPERTIES	= 1,
+	/**
+	 * const char* (set, external driver only): Attach a source of sensor data that is drained whenever the device is updated.
+	 *
+	 * "ip:port[:device]" receives poses streamed with ohmd_ctx_stream_start(), multicast addresses join
+	 * the group, device selects the streamed device id (default: any).
+	 * "shm:name" reads samples in place from a ring created by another process with ohmd_imu_ring_create().
+	 * "unix:path" connects to a SOCK_SEQPACKET unix domain socket where every message is an array of up to 64
+	 *   ohmd_imu_sample, other messages are dropped. Windows has no such sockets and refuses it.
+	 * NULL detaches the current source.
+	 **/
+	OHMD_EXTERNAL_STREAM_SOURCE	= 2,
 } ohmd_data_value;
 
 typedef enum {
 	/** int[1] (set, default: 1): Set this to 0 to prevent OpenHMD from creating background threads to do automatic device ticking.
 	    Call ohmd_update(); must be called frequently, at least 10 times per second, if the background threads are disabled. */
 	OHMD_IDS_AUTOMATIC_UPDATE = 0,
+	/** int[1] (set, default: 0): Park the device once it has not been queried for this many milliseconds, 0 never parks.
+	    A parked device is not read or fused, and drivers that can stop the sensor stream do so. Querying the device with
+	    ohmd_device_getf() or reading its control events resumes it. */
+	OHMD_IDS_IDLE_TIMEOUT_MS = 1,
+	/** int[1] (set, default: 0): Defer sensor fusion from the update thread to the thread that queries the device.
+	    The update only stores the calibrated samples, they are fused in one go when the device is next updated by
+	    ohmd_ctx_update() or queried, or once this many samples are waiting. 0 fuses every sample as it arrives.
+	    Meant for devices that are read rarely, ignored by devices that do their own fusion. */
+	OHMD_IDS_LAZY_FUSION_SAMPLES = 2,
+	/** int[1] (set, default: OHMD_FUSION_DEFAULT): The ohmd_fusion_engine used for the device's sensor fusion.
+	    Ignored by devices that do their own fusion. */
+	OHMD_IDS_FUSION_ENGINE = 3,
+	/** int[1] (set, default: 0): Set this to 1 to read the device on a thread of its own. The reader thread only drains
+	    the device into a queue, decoding and fusion stay on the update thread, so reports are not dropped while the
+	    update thread is busy or preempted. Costs a thread per device, ignored by drivers that don't support it. */
+	OHMD_IDS_READER_THREAD = 4,
+	/** int[1] (set, default: 0): Pre-integrate this many IMU samples, at most 64, into one sensor fusion step. The gyro
+	    increments are summed with coning compensation and the accelerometer is averaged, so fusion runs once per
+	    group for a fraction of the CPU time. The orientation trails by up to this many samples minus one.
+	    0 or 1 fuses every sample, ignored by devices that do their own fusion. */
+	OHMD_IDS_PREINTEGRATE_SAMPLES = 5,
+	/** int[1] (set, default: 0): Set this to 1 to fuse the device together with the other devices of the context that
+	    set it, four or eight devices per SIMD instruction, for hosts with many trackers. The device switches to
+	    OHMD_FUSION_MAHONY and its samples wait as with OHMD_IDS_LAZY_FUSION_SAMPLES, 64 of them unless that is set,
+	    until ohmd_ctx_update() fuses all of them. Ignored by devices that do their own fusion. */
+	OHMD_IDS_FUSION_BANK = 6,
 } ohmd_int_settings;
 
+/** Sensor fusion algorithms, see OHMD_IDS_FUSION_ENGINE. */
+typedef enum {
+	/** The driver's choice, the complementary filter unless the device is known to run on a slow CPU. Libraries built
+	    with fixed-point fusion use OHMD_FUSION_FIXED instead of the complementary filter. */
+	OHMD_FUSION_DEFAULT = -1,
+	/** Gyro integration with a slow gravity tilt correction. */
+	OHMD_FUSION_COMPLEMENTARY = 0,
+	/** Error-state Kalman filter over orientation and gyro bias, converges faster and keeps learning the bias. */
+	OHMD_FUSION_ESKF = 1,
+	/** Mahony filter, first order integration with a proportional and integral gravity correction. The cheapest
+	    engine with a gravity correction, it also learns the gyro bias of the tilt axes. */
+	OHMD_FUSION_MAHONY = 2,
+	/** Madgwick filter, first order integration with a gradient descent step towards gravity. Does not learn
+	    the gyro bias. */
+	OHMD_FUSION_MADGWICK = 3,
+	/** The complementary filter in fixed-point arithmetic with table based trigonometry, for CPUs without an FPU.
+	    Follows the complementary filter to within a fraction of a degree. */
+	OHMD_FUSION_FIXED = 4,
+} ohmd_fusion_engine;
+
 /** Device classes. */
 typedef enum 
 {
@@ -228,6 +304,33 @@ typedef enum
 	OHMD_DEVICE_FLAGS_RIGHT_CONTROLLER    = 16,
 } ohmd_device_flags;
 
+/** A timestamped IMU sample, used for feeding external sensors with ohmd_device_push_imu_samples(). */
+typedef struct {
+	/** Absolute time of the sample in nanoseconds, from any monotonic clock. */
+	uint64_t timestamp_ns;
+	/** X, Y, Z angular velocity in radians per second. */
+	float gyro[3];
+	/** X, Y, Z acceleration in metres per second squared. */
+	float accel[3];
+	/** X, Y, Z magnetic field. */
+	float mag[3];
+} ohmd_imu_sample;
+
+/** A change of a control, read with ohmd_device_poll_control_events(). */
+typedef struct {
+	/** Host monotonic time in nanoseconds when the driver received the change. */
+	uint64_t timestamp_ns;
+	/** Index of the control, same as in OHMD_CONTROLS_STATE. */
+	int control;
+	/** Value before the change. */
+	float old_value;
+	/** Value after the change. */
+	float new_value;
+} ohmd_control_event;
+
+/** An opaque pointer to a shared memory ring of IMU samples, see ohmd_imu_ring_create(). */
+typedef struct ohmd_imu_ring ohmd_imu_ring;
+
 /** An opaque pointer to a context structure. */
 typedef struct ohmd_context ohmd_context;
 
@@ -280,6 +383,48 @@ OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_ctx_get_error(ohmd_context* ctx)
  **/
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_update(ohmd_context* ctx);
 
+/**
+ * Stream device poses over UDP.
+ *
+ * Every time a device is updated, after sensor fusion, a datagram with the device id, a sequence number,
+ * the host monotonic timestamp in nanoseconds, the rotation quaternion, the position and a bitfield of the
+ * pressed digital controls is sent to the given IPv4 address. Multicast and broadcast addresses are supported.
+ * See src/stream.h for the wire format, it can be received with OHMD_EXTERNAL_STREAM_SOURCE.
+ * Starting a new stream replaces the current one.
+ *
+ * @param ctx The context whose devices should be streamed.
+ * @param address IPv4 address to send to.
+ * @param port UDP port to send to.
+ * @param decimation Only send every n-th update of each device, 1 sends all (1000 Hz with automatic updates).
+ * @return 0 on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_start(ohmd_context* ctx, const char* address, int port, int decimation);
+
+/**
+ * Stream device poses over UDP, several per datagram.
+ *
+ * Same as ohmd_ctx_stream_start(), but the poses of a device are collected and sent batch at a time, compressed to
+ * about 12 bytes each, so 1000 Hz poses of many devices need a fraction of the datagrams and bandwidth. Each pose
+ * keeps the time it was fused, the last one of a batch is sent up to batch - 1 updates late.
+ * See src/stream.h and src/posecodec.h for the wire format, OHMD_EXTERNAL_STREAM_SOURCE receives both.
+ *
+ * @param ctx The context whose devices should be streamed.
+ * @param address IPv4 address to send to.
+ * @param port UDP port to send to.
+ * @param decimation Only send every n-th update of each device, 1 sends all.
+ * @param batch Poses per datagram, 1 to 32, 1 sends each pose as ohmd_ctx_stream_start() does.
+ * @return 0 on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_start_batched(ohmd_context* ctx, const char* address, int port, int decimation, int batch);
+
+/**
+ * Stop streaming device poses.
+ *
+ * @param ctx The context that is streaming.
+ * @return 0 on success, <0 if no stream was running.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_stop(ohmd_context* ctx);
+
 /**
  * Probe for devices.
  *
@@ -315,7 +460,7 @@ OHMD_APIENTRYDLL int ohmd_gets(ohmd_string_description type, const char** out);
  *
  * @param ctx A (probed) context.
  * @param index An index, between 0 and the value returned from ohmd_ctx_probe.
- * @param type The type of data to fetch. One of OHMD_VENDOR, OHMD_PRODUCT and OHMD_PATH.
+ * @param type The type of data to fetch. One of OHMD_VENDOR, OHMD_PRODUCT, OHMD_PATH and OHMD_SERIAL.
  * @return a string with a human readable device name.
  **/
 OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_list_gets(ohmd_context* ctx, int index, ohmd_string_value type);
@@ -412,6 +557,19 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_close_device(ohmd_device* device);
  **/
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_getf(ohmd_device* device, ohmd_float_value type, float* out);
 
+/**
+ * Get several floating point values from a device at once.
+ *
+ * The values are read under a single lock, so they all belong to the same update of the device.
+ *
+ * @param device An open device.
+ * @param types The values to get.
+ * @param outs One output pointer per type, each large enough for its value.
+ * @param count Number of values.
+ * @return 0 on success, <0 on the first failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_getf_batch(ohmd_device* device, const ohmd_float_value* types, float* const* outs, int count);
+
 /**
  * Set a floating point value for a device.
  *
@@ -422,6 +580,67 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_getf(ohmd_device* device, ohmd_fl
  **/
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_setf(ohmd_device* device, ohmd_float_value type, const float* in);
 
+/**
+ * Perform sensor fusion on a batch of samples from an external sensor.
+ *
+ * The batched counterpart of OHMD_EXTERNAL_SENSOR_FUSION. The device is locked once for the whole batch
+ * and the time step of each sample is derived from its timestamp and the one before it, so samples must be
+ * pushed in order. Samples that are not newer than the last fused sample are skipped.
+ *
+ * @param device An open device that supports external sensor fusion.
+ * @param samples The samples, oldest first.
+ * @param count Number of samples.
+ * @return 0 on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_push_imu_samples(ohmd_device* device, const ohmd_imu_sample* samples, int count);
+
+/**
+ * Read the changes of the controls of a device since the last call.
+ *
+ * The driver queues an event whenever it receives a report that changes the value of a control, so presses shorter
+ * than a frame are not missed and carry the time they were received. Reading does not lock the device and only
+ * returns what changed. A device has a single queue, it must only be read from one thread at a time. If the queue is
+ * not read for a while new events are dropped, OHMD_CONTROLS_STATE always holds the current state.
+ *
+ * @param device An open device.
+ * @param[out] events Receives up to max_events events, oldest first.
+ * @param max_events Size of events.
+ * @return the number of events read, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_poll_control_events(ohmd_device* device, ohmd_control_event* events, int max_events);
+
+/**
+ * Create a named shared memory ring of IMU samples.
+ *
+ * Used by a process that acquires IMU data to feed the external driver of another process, which attaches with
+ * OHMD_EXTERNAL_STREAM_SOURCE "shm:name". The ring has a single producer and a single consumer and never blocks.
+ * Does not need an ohmd_context. Fails while another running producer has a ring of that name, a ring left behind
+ * by a producer that exited is replaced. On Windows the name stays taken as long as a consumer is attached to it.
+ *
+ * @param name Name of the shared memory object, such as "/my-imu".
+ * @param capacity Number of samples the ring can hold, must be a power of two.
+ * @return a ring on success, NULL on failure.
+ **/
+OHMD_APIENTRYDLL ohmd_imu_ring* OHMD_APIENTRY ohmd_imu_ring_create(const char* name, int capacity);
+
+/**
+ * Append samples to a ring.
+ *
+ * @param ring A ring created with ohmd_imu_ring_create().
+ * @param samples The samples, oldest first.
+ * @param count Number of samples.
+ * @return the number of samples that fit, the rest is dropped if the consumer falls behind,
+ * or OHMD_S_INVALID_PARAMETER if samples is NULL or count is negative.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_imu_ring_push(ohmd_imu_ring* ring, const ohmd_imu_sample* samples, int count);
+
+/**
+ * Destroy a ring and remove its name.
+ *
+ * @param ring A ring created with ohmd_imu_ring_create().
+ **/
+OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_imu_ring_destroy(ohmd_imu_ring* ring);
+
 /**
  * Get an integer value from a device.
  *
@@ -0,0 +1,413 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/**
+ * \file openhmd.hpp
+ * Header-only C++17 binding for the OpenHMD public API.
+ *
+ * Contexts and devices are move-only handles that release themselves. Properties are types, so the size and
+ * type of a value are known at compile time:
+ *
+ *     openhmd::context ctx;
+ *     ctx.probe();
+ *     openhmd::device hmd = ctx.open(0);
+ *     openhmd::quatf rot = hmd.get<openhmd::Rotation>();
+ *     auto [view, proj] = hmd.get<openhmd::LeftEyeView, openhmd::LeftEyeProjection>();
+ *
+ * Failures throw openhmd::error. A device must not outlive the context it was opened from.
+ **/
+
+#ifndef OPENHMD_HPP
+#define OPENHMD_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "openhmd.h"
+
+namespace openhmd {
+
+/** Thrown when a call into OpenHMD fails. */
+class error : public std::runtime_error {
+public:
+	error(int status, const std::string& what) : std::runtime_error(what), status_(status) {}
+
+	/** The ohmd_status the call returned. */
+	int status() const noexcept { return status_; }
+
+private:
+	int status_;
+};
+
+/** Rotation quaternion, same layout as OHMD_ROTATION_QUAT. */
+struct quatf { float x, y, z, w; };
+
+/** 3-D vector, same layout as OHMD_POSITION_VECTOR. */
+struct vec3f { float x, y, z; };
+
+/** OpenGL style column major 4x4 matrix. */
+struct mat4 { float m[16]; };
+
+/** Fixed size array of floats, for values without a more specific type. */
+template<std::size_t N>
+struct floats {
+	float v[N];
+
+	float& operator[](std::size_t i) noexcept { return v[i]; }
+	const float& operator[](std::size_t i) const noexcept { return v[i]; }
+	static constexpr std::size_t size() noexcept { return N; }
+};
+
+namespace detail {
+
+template<ohmd_float_value Value, class T, bool Settable = false>
+struct float_property {
+	static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % sizeof(float) == 0,
+		"float properties must be made of floats");
+
+	using type = T;
+	static constexpr ohmd_float_value value = Value;
+	static constexpr std::size_t count = sizeof(T) / sizeof(float);
+	static constexpr bool settable = Settable;
+};
+
+template<ohmd_int_value Value>
+struct int_property {
+	using type = int;
+	static constexpr ohmd_int_value value = Value;
+};
+
+template<class P, class = void>
+struct is_float_property : std::false_type {};
+template<class P>
+struct is_float_property<P, std::void_t<decltype(P::count)>> : std::true_type {};
+
+// copies out of a float buffer, keeps the accessors free of aliasing casts
+template<class T>
+inline T from_floats(const float* in) noexcept
+{
+	T out;
+	std::memcpy(&out, in, sizeof(T));
+	return out;
+}
+
+inline void check(ohmd_context* ctx, int status)
+{
+	if(status < 0)
+		throw error(status, ctx ? ohmd_ctx_get_error(ctx) : "openhmd error");
+}
+
+} // namespace detail
+
+/* float properties, see ohmd_float_value */
+
+struct Rotation : detail::float_property<OHMD_ROTATION_QUAT, quatf> {};
+struct LeftEyeView : detail::float_property<OHMD_LEFT_EYE_GL_MODELVIEW_MATRIX, mat4> {};
+struct RightEyeView : detail::float_property<OHMD_RIGHT_EYE_GL_MODELVIEW_MATRIX, mat4> {};
+struct LeftEyeProjection : detail::float_property<OHMD_LEFT_EYE_GL_PROJECTION_MATRIX, mat4> {};
+struct RightEyeProjection : detail::float_property<OHMD_RIGHT_EYE_GL_PROJECTION_MATRIX, mat4> {};
+struct Position : detail::float_property<OHMD_POSITION_VECTOR, vec3f> {};
+struct ScreenHorizontalSize : detail::float_property<OHMD_SCREEN_HORIZONTAL_SIZE, float> {};
+struct ScreenVerticalSize : detail::float_property<OHMD_SCREEN_VERTICAL_SIZE, float> {};
+struct LensHorizontalSeparation : detail::float_property<OHMD_LENS_HORIZONTAL_SEPARATION, float> {};
+struct LensVerticalPosition : detail::float_property<OHMD_LENS_VERTICAL_POSITION, float> {};
+struct LeftEyeFov : detail::float_property<OHMD_LEFT_EYE_FOV, float> {};
+struct LeftEyeAspectRatio : detail::float_property<OHMD_LEFT_EYE_ASPECT_RATIO, float> {};
+struct RightEyeFov : detail::float_property<OHMD_RIGHT_EYE_FOV, float> {};
+struct RightEyeAspectRatio : detail::float_property<OHMD_RIGHT_EYE_ASPECT_RATIO, float> {};
+struct EyeIpd : detail::float_property<OHMD_EYE_IPD, float, true> {};
+struct ProjectionZFar : detail::float_property<OHMD_PROJECTION_ZFAR, float, true> {};
+struct ProjectionZNear : detail::float_property<OHMD_PROJECTION_ZNEAR, float, true> {};
+struct DistortionK : detail::float_property<OHMD_DISTORTION_K, floats<6>> {};
+struct UniversalDistortionK : detail::float_property<OHMD_UNIVERSAL_DISTORTION_K, floats<4>> {};
+struct UniversalAberrationK : detail::float_property<OHMD_UNIVERSAL_ABERRATION_K, floats<3>> {};
+struct FusionState : detail::float_property<OHMD_FUSION_STATE, floats<OHMD_FUSION_STATE_SIZE>, true> {};
+
+/* int properties, see ohmd_int_value */
+
+struct ScreenHorizontalResolution : detail::int_property<OHMD_SCREEN_HORIZONTAL_RESOLUTION> {};
+struct ScreenVerticalResolution : detail::int_property<OHMD_SCREEN_VERTICAL_RESOLUTION> {};
+struct DeviceClass : detail::int_property<OHMD_DEVICE_CLASS> {};
+struct DeviceFlags : detail::int_property<OHMD_DEVICE_FLAGS> {};
+struct ControlCount : detail::int_property<OHMD_CONTROL_COUNT> {};
+
+/** An open device, closed when destroyed. */
+class device {
+public:
+	device() noexcept = default;
+	explicit device(ohmd_device* dev) noexcept : dev_(dev) {}
+	~device() { reset(); }
+
+	device(const device&) = delete;
+	device& operator=(const device&) = delete;
+
+	device(device&& other) noexcept : dev_(std::exchange(other.dev_, nullptr)) {}
+	device& operator=(device&& other) noexcept
+	{
+		if(this != &other){
+			reset();
+			dev_ = std::exchange(other.dev_, nullptr);
+		}
+		return *this;
+	}
+
+	/** Close the device, if any. */
+	void reset() noexcept
+	{
+		if(dev_)
+			ohmd_close_device(std::exchange(dev_, nullptr));
+	}
+
+	ohmd_device* get() const noexcept { return dev_; }
+	explicit operator bool() const noexcept { return dev_ != nullptr; }
+
+	/** Get a single property, such as get<Rotation>() or get<ControlCount>(). */
+	template<class P>
+	typename P::type get() const
+	{
+		if constexpr(detail::is_float_property<P>::value){
+			float out[P::count];
+			check(ohmd_device_getf(dev_, P::value, out));
+			return detail::from_floats<typename P::type>(out);
+		}else{
+			int out;
+			check(ohmd_device_geti(dev_, P::value, &out));
+			return out;
+		}
+	}
+
+	/** Get several float properties from the same device update, with a single call. */
+	template<class P0, class P1, class... Ps>
+	std::tuple<typename P0::type, typename P1::type, typename Ps::type...> get() const
+	{
+		static_assert(detail::is_float_property<P0>::value && detail::is_float_property<P1>::value &&
+			(detail::is_float_property<Ps>::value && ...), "only float properties can be read together");
+
+		std::tuple<typename P0::type, typename P1::type, typename Ps::type...> out;
+		std::apply([this](auto&... values){
+			const ohmd_float_value types[] = { P0::value, P1::value, Ps::value... };
+			float* const outs[] = { reinterpret_cast<float*>(&values)... };
+			check(ohmd_device_getf_batch(dev_, types, outs, static_cast<int>(sizeof...(values))));
+		}, out);
+		return out;
+	}
+
+	/** Set a settable float property, such as set<EyeIpd>(.065f). */
+	template<class P>
+	void set(const typename P::type& value)
+	{
+		static_assert(detail::is_float_property<P>::value && P::settable, "property can not be set");
+
+		float in[P::count];
+		std::memcpy(in, &value, sizeof(in));
+		check(ohmd_device_setf(dev_, P::value, in));
+	}
+
+	/** Read the state of all controls into a contiguous float container, returns the number of controls. */
+	template<class Container>
+	std::size_t controls_state(Container& out) const
+	{
+		std::size_t count = static_cast<std::size_t>(get<ControlCount>());
+		if(std::size(out) < count)
+			throw error(OHMD_S_INVALID_PARAMETER, "buffer too small for controls state");
+
+		if(count > 0)
+			check(ohmd_device_getf(dev_, OHMD_CONTROLS_STATE, std::data(out)));
+		return count;
+	}
+
+	/** Drain queued control changes into a contiguous container, returns the number of events read. */
+	template<class Container>
+	std::size_t poll_control_events(Container& out)
+	{
+		int ret = ohmd_device_poll_control_events(dev_, std::data(out), static_cast<int>(std::size(out)));
+		check(ret);
+		return static_cast<std::size_t>(ret);
+	}
+
+	/** Fuse a contiguous container of ohmd_imu_sample, oldest first. */
+	template<class Container>
+	void push_imu_samples(const Container& samples)
+	{
+		check(ohmd_device_push_imu_samples(dev_, std::data(samples), static_cast<int>(std::size(samples))));
+	}
+
+private:
+	void check(int status) const
+	{
+		if(status < 0)
+			throw error(status, "openhmd device call failed");
+	}
+
+	ohmd_device* dev_ = nullptr;
+};
+
+/** Settings used when opening a device. */
+class device_settings {
+public:
+	explicit device_settings(ohmd_context* ctx) : settings_(ohmd_device_settings_create(ctx))
+	{
+		if(!settings_)
+			throw error(OHMD_S_UNKNOWN_ERROR, "could not create device settings");
+	}
+	~device_settings() { if(settings_) ohmd_device_settings_destroy(settings_); }
+
+	device_settings(const device_settings&) = delete;
+	device_settings& operator=(const device_settings&) = delete;
+	device_settings(device_settings&& other) noexcept : settings_(std::exchange(other.settings_, nullptr)) {}
+	device_settings& operator=(device_settings&& other) noexcept
+	{
+		std::swap(settings_, other.settings_);
+		return *this;
+	}
+
+	/** Set OHMD_IDS_AUTOMATIC_UPDATE. */
+	device_settings& automatic_update(bool enable)
+	{
+		int val = enable ? 1 : 0;
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_AUTOMATIC_UPDATE, &val));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_IDLE_TIMEOUT_MS, 0 never parks the device. */
+	device_settings& idle_timeout_ms(int ms)
+	{
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_IDLE_TIMEOUT_MS, &ms));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_FUSION_ENGINE. */
+	device_settings& fusion_engine(ohmd_fusion_engine engine)
+	{
+		int val = engine;
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_FUSION_ENGINE, &val));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_LAZY_FUSION_SAMPLES, 0 fuses every sample as it arrives. */
+	device_settings& lazy_fusion_samples(int samples)
+	{
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_LAZY_FUSION_SAMPLES, &samples));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_READER_THREAD. */
+	device_settings& reader_thread(bool enable)
+	{
+		int val = enable ? 1 : 0;
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_READER_THREAD, &val));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_PREINTEGRATE_SAMPLES, 0 fuses every sample as it arrives. */
+	device_settings& preintegrate_samples(int samples)
+	{
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_PREINTEGRATE_SAMPLES, &samples));
+		return *this;
+	}
+
+	/** Set OHMD_IDS_FUSION_BANK. */
+	device_settings& fusion_bank(bool enable)
+	{
+		int val = enable ? 1 : 0;
+		detail::check(nullptr, ohmd_device_settings_seti(settings_, OHMD_IDS_FUSION_BANK, &val));
+		return *this;
+	}
+
+	ohmd_device_settings* get() const noexcept { return settings_; }
+
+private:
+	ohmd_device_settings* settings_;
+};
+
+/** An OpenHMD context, destroyed with all its devices when it goes out of scope. */
+class context {
+public:
+	context() : ctx_(ohmd_ctx_create())
+	{
+		if(!ctx_)
+			throw error(OHMD_S_UNKNOWN_ERROR, "could not create context");
+	}
+	~context() { if(ctx_) ohmd_ctx_destroy(ctx_); }
+
+	context(const context&) = delete;
+	context& operator=(const context&) = delete;
+	context(context&& other) noexcept : ctx_(std::exchange(other.ctx_, nullptr)) {}
+	context& operator=(context&& other) noexcept
+	{
+		std::swap(ctx_, other.ctx_);
+		return *this;
+	}
+
+	ohmd_context* get() const noexcept { return ctx_; }
+
+	/** Probe for devices, returns the number of devices found. */
+	int probe()
+	{
+		int count = ohmd_ctx_probe(ctx_);
+		detail::check(ctx_, count);
+		return count;
+	}
+
+	/** Update all open devices, only needed without automatic updates. */
+	void update() { ohmd_ctx_update(ctx_); }
+
+	/** Get a string for a probed device, see ohmd_list_gets(). */
+	std::string list_gets(int index, ohmd_string_value type) const
+	{
+		const char* str = ohmd_list_gets(ctx_, index, type);
+		if(!str)
+			throw error(OHMD_S_INVALID_PARAMETER, ohmd_ctx_get_error(ctx_));
+		return str;
+	}
+
+	/** Get an int property of a probed device, see ohmd_list_geti(). */
+	template<class P>
+	int list_get(int index) const
+	{
+		static_assert(!detail::is_float_property<P>::value, "only int properties can be listed");
+
+		int out;
+		detail::check(ctx_, ohmd_list_geti(ctx_, index, P::value, &out));
+		return out;
+	}
+
+	/** Create settings for open(). */
+	device_settings settings() const { return device_settings(ctx_); }
+
+	/** Open a probed device. */
+	device open(int index)
+	{
+		return checked(ohmd_list_open_device(ctx_, index));
+	}
+
+	/** Open a probed device with settings. */
+	device open(int index, const device_settings& settings)
+	{
+		return checked(ohmd_list_open_device_s(ctx_, index, settings.get()));
+	}
+
+private:
+	device checked(ohmd_device* dev) const
+	{
+		if(!dev)
+			throw error(OHMD_S_UNKNOWN_ERROR, ohmd_ctx_get_error(ctx_));
+		return device(dev);
+	}
+
+	ohmd_context* ctx_;
+};
+
+} // namespace openhmd
+
+#endif
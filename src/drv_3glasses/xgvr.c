@@ -139,6 +139,7 @@ static void _update_device(ohmd_device* device)
     while ((size = hid_read(priv->hid_handle, buffer, FEATURE_BUFFER_SIZE)) > 0) {
         if (buffer[0] == FEATURE_SENSOR_ID) {
             xgvr_decode_hmd_data_packet(buffer, size, &priv->hmd_data);
+            ohmd_device_sample_controls(&priv->device);
         } else {
             LOGE("unknown message type: %u", buffer[0]);
         }
@@ -270,6 +271,7 @@ static void _get_device_list(ohmd_driver* driver, ohmd_device_list* list)
             desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
             strcpy(desc->path, cur_dev->path);
+            _hid_copy_serial(desc->serial, cur_dev->serial_number);
             desc->driver_ptr = driver;
             cur_dev = cur_dev->next;
         }
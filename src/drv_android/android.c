@@ -223,7 +223,9 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
         nofusion_init(&priv->sensor_fusion);
     else {
         ofusion_init(&priv->sensor_fusion); //Default when all sensors are available
-        priv->sensor_fusion.flags = 0; // Disable the gravity
+        ofusion_set_engine(&priv->sensor_fusion, &ofusion_mahony); //Cheapest on phone CPUs
+        priv->base.sensor_fusion = &priv->sensor_fusion;
+        priv->sensor_fusion.flags &= ~FF_USE_GRAVITY; // Disable the gravity, the gyro bias is still estimated
     }
 
 	return (ohmd_device*)priv;
@@ -269,9 +271,9 @@ ohmd_driver* ohmd_create_android_drv(ohmd_context* ctx)
 static void nofusion_update(fusion* me, float dt, const vec3f* accel)
 {
 	//avg raw accel data to smooth jitter, and normalise
-	ofq_add(&me->accel_fq, accel);
+	ostats_add(&me->accel_stats, me->accel_window, NULL, accel);
 	vec3f accel_mean;
-	ofq_get_mean(&me->accel_fq, &accel_mean);
+	ostats_get_mean(&me->accel_stats, &accel_mean);
 	vec3f acc_n = accel_mean;
 	ovec3f_normalize_me(&acc_n);
 
@@ -305,15 +307,11 @@ static void nofusion_update(fusion* me, float dt, const vec3f* accel)
 //shorter buffers for frame smoothing
 static void nofusion_init(fusion* me)
 {
-	memset(me, 0, sizeof(fusion));
-	me->orient.w = 1.0f;
+	ofusion_init(me);
 
-	ofq_init(&me->mag_fq, 10);
-	ofq_init(&me->accel_fq, 10);
-	ofq_init(&me->ang_vel_fq, 10);
-
-	me->flags = FF_USE_GRAVITY;
-	me->grav_gain = 0.05f;
+	fusion_params params = ofusion_default_params;
+	params.window_size = 10;
+	ofusion_set_params(me, &params);
 }
 
 static void set_android_properties(ohmd_device* device, ohmd_device_properties* props)
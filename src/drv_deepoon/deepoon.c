@@ -261,6 +261,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	// initialize sensor fusion
 	ofusion_init(&priv->sensor_fusion);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return &priv->base;
 
@@ -292,6 +293,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 			desc->revision = 0;
 			strcpy(desc->path, cur_dev->path);
+			_hid_copy_serial(desc->serial, cur_dev->serial_number);
 			desc->driver_ptr = driver;
 		}
 		cur_dev = cur_dev->next;
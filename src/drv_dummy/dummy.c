@@ -19,6 +19,8 @@ typedef struct {
 
 static void update_device(ohmd_device* device)
 {
+	// the static control state is reported as if it was received on the first update
+	ohmd_device_sample_controls(device);
 }
 
 static int getf(ohmd_device* device, ohmd_float_value type, float* out)
@@ -10,15 +10,82 @@
 
 
 #include "../openhmdi.h"
+#include "../imuring.h"
 #include "string.h"
 
+// samples per unix socket message that are read at once
+#define SOCKET_BATCH_SIZE 64
+
+// pushed samples are converted and fused this many at a time
+#define FUSION_BATCH_SIZE 32
+
 typedef struct {
 	ohmd_device base;
 	fusion sensor_fusion;
+
+	// timestamp of the last sample given to ohmd_device_push_imu_samples
+	bool have_timestamp;
+	uint64_t last_timestamp_ns;
+
+	// attached sources, see OHMD_EXTERNAL_STREAM_SOURCE
+	ohmd_stream_receiver* stream;
+	bool have_stream_pose;
+	quatf stream_rotation;
+	vec3f stream_position;
+
+	ohmd_imu_ring* ring;
+
+	ohmd_unix_socket* sock;
+	ohmd_imu_sample sock_samples[SOCKET_BATCH_SIZE];
 } external_priv;
 
+static int push_imu_samples(ohmd_device* device, const ohmd_imu_sample* samples, int count);
+static void detach_sources(external_priv* priv);
+
 static void update_device(ohmd_device* device)
 {
+	external_priv* priv = (external_priv*)device;
+	ohmd_stream_packet pkt;
+
+	if(priv->ring){
+		// read straight out of the shared memory, push_imu_samples converts a batch at a time for the fusion
+		const ohmd_imu_sample* samples;
+		int count;
+
+		while((count = ohmd_imu_ring_peek(priv->ring, &samples)) > 0){
+			push_imu_samples(device, samples, count);
+			ohmd_imu_ring_consume(priv->ring, count);
+		}
+	}
+
+	if(priv->sock){
+		int size;
+
+		while((size = ohmd_unix_recv(priv->sock, priv->sock_samples, sizeof(priv->sock_samples))) > 0){
+			// a message is a whole number of samples that fits the buffer, anything else is dropped
+			if(size > (int)sizeof(priv->sock_samples) || size % (int)sizeof(ohmd_imu_sample) != 0){
+				LOGW("dropped an external sensor message that is not up to %d whole samples", SOCKET_BATCH_SIZE);
+				continue;
+			}
+
+			push_imu_samples(device, priv->sock_samples, size / (int)sizeof(ohmd_imu_sample));
+		}
+
+		if(size == 0){
+			LOGW("external sensor socket closed");
+			detach_sources(priv);
+		}
+	}
+
+	if(!priv->stream)
+		return;
+
+	// batches are handed out pose by pose
+	while(ohmd_stream_receiver_next(priv->stream, &pkt)){
+		memcpy(priv->stream_rotation.arr, pkt.payload.pose.rotation, sizeof(pkt.payload.pose.rotation));
+		memcpy(priv->stream_position.arr, pkt.payload.pose.position, sizeof(pkt.payload.pose.position));
+		priv->have_stream_pose = true;
+	}
 }
 
 static int getf(ohmd_device* device, ohmd_float_value type, float* out)
@@ -27,12 +94,15 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 
 	switch(type){
 		case OHMD_ROTATION_QUAT: {
-				*(quatf*)out = priv->sensor_fusion.orient;
+				*(quatf*)out = priv->have_stream_pose ? priv->stream_rotation : priv->sensor_fusion.orient;
 				break;
 			}
 
 		case OHMD_POSITION_VECTOR:
-			out[0] = out[1] = out[2] = 0;
+			if(priv->have_stream_pose)
+				*(vec3f*)out = priv->stream_position;
+			else
+				out[0] = out[1] = out[2] = 0;
 			break;
 
 		default:
@@ -51,6 +121,7 @@ static int setf(ohmd_device* device, ohmd_float_value type, const float* in)
 	switch(type){
 		case OHMD_EXTERNAL_SENSOR_FUSION: {
 				ofusion_update(&priv->sensor_fusion, *in, (vec3f*)(in + 1), (vec3f*)(in + 4), (vec3f*)(in + 7));
+				priv->have_stream_pose = false;
 			}
 			break;
 
@@ -63,9 +134,124 @@ static int setf(ohmd_device* device, ohmd_float_value type, const float* in)
 	return 0;
 }
 
+static int push_imu_samples(ohmd_device* device, const ohmd_imu_sample* samples, int count)
+{
+	external_priv* priv = (external_priv*)device;
+	fusion_sample batch[FUSION_BATCH_SIZE];
+	int n = 0;
+	uint64_t last = priv->last_timestamp_ns;
+
+	for(int i = 0; i < count; i++){
+		const ohmd_imu_sample* s = samples + i;
+		float dt;
+
+		// the very first sample only establishes the time base
+		if(!priv->have_timestamp){
+			dt = 0;
+			priv->have_timestamp = true;
+		} else if(s->timestamp_ns <= last){
+			continue;
+		} else {
+			dt = (float)(s->timestamp_ns - last) * 1e-9f;
+		}
+
+		last = s->timestamp_ns;
+
+		fusion_sample* fs = batch + n++;
+		fs->dt = dt;
+		memcpy(fs->ang_vel.arr, s->gyro, sizeof(fs->ang_vel.arr));
+		memcpy(fs->accel.arr, s->accel, sizeof(fs->accel.arr));
+		memcpy(fs->mag.arr, s->mag, sizeof(fs->mag.arr));
+
+		if(n == FUSION_BATCH_SIZE){
+			ofusion_update_batch(&priv->sensor_fusion, batch, n);
+			n = 0;
+		}
+	}
+
+	ofusion_update_batch(&priv->sensor_fusion, batch, n);
+
+	priv->last_timestamp_ns = last;
+	priv->have_stream_pose = false;
+
+	return OHMD_S_OK;
+}
+
+static void detach_sources(external_priv* priv)
+{
+	if(priv->stream)
+		ohmd_stream_receiver_destroy(priv->stream);
+	if(priv->ring)
+		ohmd_imu_ring_detach(priv->ring);
+	if(priv->sock)
+		ohmd_unix_close(priv->sock);
+
+	priv->stream = NULL;
+	priv->ring = NULL;
+	priv->sock = NULL;
+	priv->have_stream_pose = false;
+}
+
+static int attach_source(external_priv* priv, const char* source)
+{
+	ohmd_context* ctx = priv->base.ctx;
+
+	// NULL detaches the current source
+	if(!source){
+		detach_sources(priv);
+		return OHMD_S_OK;
+	}
+
+	if(strncmp(source, "shm:", 4) == 0){
+		ohmd_imu_ring* ring = ohmd_imu_ring_attach(ctx, source + 4);
+		if(!ring)
+			return OHMD_S_INVALID_PARAMETER;
+
+		detach_sources(priv);
+		priv->ring = ring;
+	}else if(strncmp(source, "unix:", 5) == 0){
+		ohmd_unix_socket* sock = ohmd_unix_connect(ctx, source + 5);
+		if(!sock)
+			return OHMD_S_INVALID_PARAMETER;
+
+		detach_sources(priv);
+		priv->sock = sock;
+	}else{
+		ohmd_stream_receiver* stream = ohmd_stream_receiver_create(ctx, source);
+		if(!stream)
+			return OHMD_S_INVALID_PARAMETER;
+
+		detach_sources(priv);
+		priv->stream = stream;
+	}
+
+	return OHMD_S_OK;
+}
+
+static int set_data(ohmd_device* device, ohmd_data_value type, const void* in)
+{
+	external_priv* priv = (external_priv*)device;
+
+	switch(type){
+		case OHMD_EXTERNAL_STREAM_SOURCE:
+			return attach_source(priv, (const char*)in);
+
+		default:
+			ohmd_set_error(priv->base.ctx, "invalid type given to set_data (%d)", type);
+			return OHMD_S_INVALID_PARAMETER;
+	}
+
+	return OHMD_S_OK;
+}
+
 static void close_device(ohmd_device* device)
 {
+	external_priv* priv = (external_priv*)device;
+
 	LOGD("closing external device");
+
+	detach_sources(priv);
+
 	free(device);
 }
 
@@ -98,8 +284,11 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.close = close_device;
 	priv->base.getf = getf;
 	priv->base.setf = setf;
-	
+	priv->base.set_data = set_data;
+	priv->base.push_imu_samples = push_imu_samples;
+
 	ofusion_init(&priv->sensor_fusion);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return (ohmd_device*)priv;
 }
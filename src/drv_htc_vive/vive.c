@@ -31,6 +31,7 @@
 #include <stdbool.h>
 
 #include "vive.h"
+#include "../hid.h"
 
 typedef enum {
 	REV_VIVE,
@@ -47,9 +48,6 @@ typedef struct {
 	uint32_t last_ticks;
 	uint8_t last_seq;
 
-	vec3f gyro_error;
-	filter_queue gyro_q;
-
 	vive_revision revision;
 
 	vive_imu_config imu_config;
@@ -76,22 +74,6 @@ static void vec3f_from_vive_vec_gyro(const vive_imu_config* config,
 	out->z = range * config->gyro_scale.z * (float)smp[2] - config->gyro_bias.z;
 }
 
-static bool process_error(vive_priv* priv)
-{
-	if(priv->gyro_q.at >= priv->gyro_q.size - 1)
-		return true;
-
-	ofq_add(&priv->gyro_q, &priv->raw_gyro);
-
-	if(priv->gyro_q.at >= priv->gyro_q.size - 1){
-		ofq_get_mean(&priv->gyro_q, &priv->gyro_error);
-		LOGE("gyro error: %f, %f, %f\n",
-		     priv->gyro_error.x, priv->gyro_error.y, priv->gyro_error.z);
-	}
-
-	return false;
-}
-
 static vive_headset_imu_sample* get_next_sample(vive_headset_imu_packet* pkt,
                                                 int last_seq)
 {
@@ -129,8 +111,10 @@ static void handle_imu_packet(vive_priv* priv, unsigned char *buffer, int size)
 	vive_decode_sensor_packet(&pkt, buffer, size);
 
 	vive_headset_imu_sample* smp = NULL;
+	fusion_sample samples[3];
+	int num_samples = 0;
 
-	while((smp = get_next_sample(&pkt, priv->last_seq)) != NULL)
+	while(num_samples < 3 && (smp = get_next_sample(&pkt, priv->last_seq)) != NULL)
 	{
 		if(priv->last_ticks == 0)
 			priv->last_ticks = smp->time_ticks;
@@ -164,17 +148,17 @@ static void handle_imu_packet(vive_priv* priv, unsigned char *buffer, int size)
 				LOGE("Unknown VIVE revision.\n");
 		}
 
-		if(process_error(priv)){
-			vec3f mag = {{0.0f, 0.0f, 0.0f}};
-			vec3f gyro;
-			ovec3f_subtract(&priv->raw_gyro, &priv->gyro_error, &gyro);
-
-			ofusion_update(&priv->sensor_fusion, dt,
-			               &gyro, &priv->raw_accel, &mag);
-		}
+		// the fusion measures and subtracts the gyro bias
+		fusion_sample* fs = samples + num_samples++;
+		fs->dt = dt;
+		fs->ang_vel = priv->raw_gyro;
+		fs->accel = priv->raw_accel;
+		fs->mag.x = fs->mag.y = fs->mag.z = 0.0f;
 
 		priv->last_seq = smp->seq;
 	}
+
+	ofusion_update_batch(&priv->sensor_fusion, samples, num_samples);
 }
 
 static void update_device(ohmd_device* device)
@@ -652,8 +636,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.getf = getf;
 
 	ofusion_init(&priv->sensor_fusion);
-
-	ofq_init(&priv->gyro_q, 128);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return (ohmd_device*)priv;
 
@@ -690,6 +673,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 		desc->revision = rev;
 
 		snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+		_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 		desc->driver_ptr = driver;
 		desc->device_class = OHMD_DEVICE_CLASS_HMD;
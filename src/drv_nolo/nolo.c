@@ -42,7 +42,7 @@ static void gyro_from_nolo_vec(const int16_t* smp, vec3f* out_vec)
 	out_vec->z = -(float)smp[2];
 }
 
-static void handle_tracker_sensor_msg(drv_priv* priv, unsigned char* buffer, int size, int type)
+static void handle_tracker_sensor_msg(drv_priv* priv, unsigned char* buffer, int size, int type, uint64_t tick)
 {
 	uint64_t last_sample_tick = priv->sample.tick;
 
@@ -52,7 +52,7 @@ static void handle_tracker_sensor_msg(drv_priv* priv, unsigned char* buffer, int
 		case 1: nolo_decode_controller(priv, buffer); break;
 	}
 	
-	priv->sample.tick = ohmd_monotonic_get(priv->base.ctx);
+	priv->sample.tick = tick;
 
 	// Startup correction, ignore last_sample_tick if zero.
 	uint64_t tick_delta = 0;
@@ -67,6 +67,29 @@ static void handle_tracker_sensor_msg(drv_priv* priv, unsigned char* buffer, int
 	ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &mag);
 }
 
+static int read_timeout(void* handle, unsigned char* data, int size, int timeout_ms)
+{
+	return hid_read_timeout((hid_device*)handle, data, size, timeout_ms);
+}
+
+// reads the next report, from the reader thread's queue if there is one, tick is when it arrived
+static int read_report(drv_priv* priv, unsigned char* buffer, uint64_t* tick)
+{
+	if(!priv->reader){
+		int size = hid_read(priv->handle, buffer, FEATURE_BUFFER_SIZE);
+		*tick = ohmd_monotonic_get(priv->base.ctx);
+		return size;
+	}
+
+	uint32_t dropped = ohmd_hid_reader_dropped(priv->reader);
+	if(dropped != priv->reader_dropped){
+		LOGW("the update thread fell behind, %u reports dropped", dropped - priv->reader_dropped);
+		priv->reader_dropped = dropped;
+	}
+
+	return ohmd_hid_reader_read(priv->reader, buffer, FEATURE_BUFFER_SIZE, tick);
+}
+
 static void update_device(ohmd_device* device)
 {
 	drv_priv* priv = drv_priv_get(device);
@@ -93,9 +116,19 @@ static void update_device(ohmd_device* device)
 		current = current->next;
 	}
 
+	// the settings are applied after open_device, the reader is started on the first update
+	if(device->settings.reader_thread && !priv->reader){
+		priv->reader = ohmd_hid_reader_create(device->ctx, read_timeout, priv->handle);
+		if(!priv->reader){
+			LOGE("could not start the reader thread, reading on the update thread");
+			device->settings.reader_thread = false;
+		}
+	}
+
 	// Read all the messages from the device.
 	while(true){
-		int size = hid_read(priv->handle, buffer, FEATURE_BUFFER_SIZE);
+		uint64_t tick;
+		int size = read_report(priv, buffer, &tick);
 		if(size < 0){
 			LOGE("error reading from device");
 			return;
@@ -122,17 +155,17 @@ static void update_device(ohmd_device* device)
 			case NOLO_CONTROLLER_0_HMD_SMP1:
 			{
 				if (controller0)
-					handle_tracker_sensor_msg(controller0, buffer, size, 1);
+					handle_tracker_sensor_msg(controller0, buffer, size, 1, tick);
 
-				handle_tracker_sensor_msg(priv, buffer, size, 0);
+				handle_tracker_sensor_msg(priv, buffer, size, 0, tick);
 				break;
 			}
 			case NOLO_CONTROLLER_1_HMD_SMP2:
 			{
 				if (controller1)
-					handle_tracker_sensor_msg(controller1, buffer, size, 1);
+					handle_tracker_sensor_msg(controller1, buffer, size, 1, tick);
 
-				handle_tracker_sensor_msg(priv, buffer, size, 0);
+				handle_tracker_sensor_msg(priv, buffer, size, 0, tick);
 				break;
 			}
 			default:
@@ -192,6 +225,8 @@ static void close_device(ohmd_device* device)
 {
 	LOGD("closing device");
 	drv_priv* priv = drv_priv_get(device);
+	if(priv->reader)
+		ohmd_hid_reader_destroy(priv->reader);
 	hid_close(priv->handle);
 	free(priv);
 }
@@ -321,6 +356,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.getf = getf;
 
 	ofusion_init(&priv->sensor_fusion);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return &priv->base;
 
@@ -376,6 +412,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			desc->revision = is_nolo_device(cur_dev);
 
 			strcpy(desc->path, cur_dev->path);
+			_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 			desc->device_flags = OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING | OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 			desc->device_class = OHMD_DEVICE_CLASS_GENERIC_TRACKER;
@@ -391,6 +428,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			strcpy(desc->product, "NOLO CV1: Controller 0");
 
 			strcpy(desc->path, cur_dev->path);
+			_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 			desc->device_flags =
 				OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -410,6 +448,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			strcpy(desc->product, "NOLO CV1: Controller 1");
 
 			strcpy(desc->path, cur_dev->path);
+			_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 			desc->device_flags =
 				OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
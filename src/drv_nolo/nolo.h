@@ -12,6 +12,7 @@
 #define NOLODRIVER_H
 
 #include "../openhmdi.h"
+#include "../hidreader.h"
 #include <hidapi.h>
 
 #define FEATURE_BUFFER_SIZE 64
@@ -27,6 +28,8 @@ typedef struct {
 	ohmd_device base;
 
 	hid_device* handle;
+	ohmd_hid_reader* reader; // NULL unless OHMD_IDS_READER_THREAD is set
+	uint32_t reader_dropped; // drops already logged
 	int id;
 	int rev;
 	float controller_values[8];
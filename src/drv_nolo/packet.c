@@ -192,6 +192,7 @@ void nolo_decode_controller(drv_priv* priv, const unsigned char* data)
 	}
 
 	priv->base.position = position;
+	ohmd_device_sample_controls(&priv->base);
 }
 
 void nolo_decode_hmd_marker(drv_priv* priv, const unsigned char* data)
@@ -221,6 +222,7 @@ void nolo_decode_hmd_marker(drv_priv* priv, const unsigned char* data)
 	}
 
 	priv->base.position = position;
+	ohmd_device_sample_controls(&priv->base);
 }
 
 void nolo_decode_base_station(drv_priv* priv, const unsigned char* data)
@@ -224,14 +224,22 @@ static void handle_tracker_sensor_msg(rift_hmd_t* priv, unsigned char* buffer, i
 		dt -= (s->num_samples - 1) * TICK_LEN; // TODO: query the Rift for the sample rate
 	}
 
-	for(int i = 0; i < s->num_samples; i++){
+	fusion_sample samples[3];
+	int num_samples = OHMD_MIN(s->num_samples, 3);
+
+	for(int i = 0; i < num_samples; i++){
 		vec3f_from_rift_vec(s->samples[i].accel, &priv->raw_accel);
 		vec3f_from_rift_vec(s->samples[i].gyro, &priv->raw_gyro);
 
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &priv->raw_mag);
+		samples[i].dt = dt;
+		samples[i].ang_vel = priv->raw_gyro;
+		samples[i].accel = priv->raw_accel;
+		samples[i].mag = priv->raw_mag;
 		dt = TICK_LEN; // TODO: query the Rift for the sample rate
 	}
 
+	ofusion_update_batch(&priv->sensor_fusion, samples, num_samples);
+
 	priv->last_imu_timestamp = s->timestamp;
 }
 
@@ -389,12 +397,19 @@ static void handle_rift_radio_message(rift_hmd_t *hmd, pkt_rift_radio_message *m
 				LOGV ("Remote buttons state 0x%02x", msg->remote.buttons);
 			}
 			hmd->remote_buttons_state = msg->remote.buttons;
+			ohmd_device_sample_controls (&hmd->hmd_dev.base);
 			break;
 		case RIFT_TOUCH_CONTROLLER_RIGHT:
+			if (hmd->touch_dev[0].base.parked)
+				break;
 			handle_touch_controller_message (hmd, &hmd->touch_dev[0], msg);
+			ohmd_device_sample_controls (&hmd->touch_dev[0].base.base);
 			break;
 		case RIFT_TOUCH_CONTROLLER_LEFT:
+			if (hmd->touch_dev[1].base.parked)
+				break;
 			handle_touch_controller_message (hmd, &hmd->touch_dev[1], msg);
+			ohmd_device_sample_controls (&hmd->touch_dev[1].base.base);
 			break;
 	}
 }
@@ -439,6 +454,10 @@ static void update_hmd(rift_hmd_t *priv)
 			break; // No more messages, return.
 		}
 
+		// a parked HMD only drains its reports while the controllers are still in use
+		if (priv->hmd_dev.parked)
+			continue;
+
 		// currently the only message type the hardware supports (I think)
 		if(buffer[0] == RIFT_IRQ_SENSORS_DK1 || buffer[0] == RIFT_IRQ_SENSORS_DK2) {
 			handle_tracker_sensor_msg(priv, buffer, size);
@@ -465,20 +484,26 @@ static void update_hmd(rift_hmd_t *priv)
 	}
 }
 
+static bool device_in_use(rift_device_priv* dev_priv)
+{
+	return dev_priv->opened && !dev_priv->parked;
+}
+
 static void update_device(ohmd_device* device)
 {
 	rift_device_priv* dev_priv = rift_device_priv_get(device);
 	rift_hmd_t *hmd = dev_priv->hmd;
 
-	/* Update on whichever is the lowest open id device */
+	/* Update on whichever is the lowest open id device that isn't parked,
+	 * parked devices aren't updated and must not starve the others */
 	if (dev_priv->id == 2) {
-		if (hmd->hmd_dev.opened)
+		if (device_in_use(&hmd->hmd_dev))
 			return;
-		if (hmd->touch_dev[0].base.opened)
+		if (device_in_use(&hmd->touch_dev[0].base))
 			return;
 	}
 	else if (dev_priv->id == 1) {
-		if (hmd->hmd_dev.opened)
+		if (device_in_use(&hmd->hmd_dev))
 			return;
 	}
 	update_hmd (dev_priv->hmd);
@@ -575,6 +600,24 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 	return -1;
 }
 
+static void park_device(ohmd_device* device, bool parked)
+{
+	rift_device_priv* dev_priv = rift_device_priv_get(device);
+
+	// The sensors stop streaming on their own once no keep alives are sent,
+	// which happens when every device sharing the handle is parked. Until then
+	// update_hmd() skips the reports of parked devices. Make sure the gap
+	// isn't integrated when a device comes back.
+	dev_priv->parked = parked;
+	if (parked)
+		return;
+
+	if (dev_priv->id == 0)
+		dev_priv->hmd->last_imu_timestamp = -1;
+	else
+		((rift_touch_controller_t *)dev_priv)->time_valid = false;
+}
+
 static void close_device(ohmd_device* device)
 {
 	LOGD("closing device");
@@ -732,6 +775,7 @@ static void init_touch_device(rift_touch_controller_t *touch, int id, int device
 
 	touch->device_num = device_num;
 	ofusion_init(&touch->imu_fusion);
+	ohmd_dev->sensor_fusion = &touch->imu_fusion;
 	touch->time_valid = false;
 
 	ohmd_set_default_device_properties(&ohmd_dev->properties);
@@ -966,6 +1010,7 @@ static rift_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	// initialize sensor fusion
 	ofusion_init(&priv->sensor_fusion);
+	hmd_dev->base.sensor_fusion = &priv->sensor_fusion;
 
 	return priv;
 
@@ -1048,9 +1093,11 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	dev->hmd = hmd;
 	dev->id = desc->id;
 	dev->opened = true;
+	dev->parked = false;
 
 	dev->base.update = update_device;
 	dev->base.close = close_device;
+	dev->base.park = park_device;
 	dev->base.getf = getf;
 
 	return &dev->base;
@@ -1096,6 +1143,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
 				strcpy(desc->path, cur_dev->path);
+				_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 				desc->driver_ptr = driver;
 				desc->id = id++;
@@ -1111,6 +1159,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 					sprintf(desc->product, "%s: Right Controller", rd[i].name);
 
 					strcpy(desc->path, cur_dev->path);
+					_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 					desc->device_flags =
 						//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -1130,6 +1179,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 					sprintf(desc->product, "%s: Left Controller", rd[i].name);
 
 					strcpy(desc->path, cur_dev->path);
+					_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 					desc->device_flags =
 						//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -205,6 +205,7 @@ struct rift_device_priv_s {
 	ohmd_device base;
 	int id;
 	bool opened;
+	bool parked;
 
 	rift_hmd_t *hmd;
 };
@@ -395,4 +395,9 @@ rift_s_handle_controller_report (rift_s_hmd_t *hmd, hid_device *hid, const unsig
 
 	if (!update_controller_state (ctrl, &report))
 		rift_s_hexdump_buffer ("Invalid Controller Report Content", buf, size);
+
+	for (int i = 0; i < 2; i++) {
+		if (hmd->touch_dev[i].device_num == ctrl - hmd->controllers)
+			ohmd_device_sample_controls (&hmd->touch_dev[i].base.base);
+	}
 }
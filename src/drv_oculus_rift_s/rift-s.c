@@ -141,6 +141,9 @@ handle_hmd_report (rift_s_hmd_t *priv, const unsigned char *buf, int size)
 	const float temperature_scale = 1.0 / priv->imu_config.temperature_scale;
 	const float temperature_offset = priv->imu_config.temperature_offset;
 
+	fusion_sample samples[3];
+	int num_samples = 0;
+
 	for(int i = 0; i < 3; i++) {
 		rift_s_hmd_imu_sample_t *s = report.samples + i;
 
@@ -178,11 +181,17 @@ handle_hmd_report (rift_s_hmd_t *priv, const unsigned char *buf, int size)
 			priv->raw_gyro.x, priv->raw_gyro.y, priv->raw_gyro.z);
 #endif
 
-		ofusion_update(&priv->sensor_fusion, dt_sec, &priv->raw_gyro, &priv->raw_accel, &priv->raw_mag);
+		fusion_sample* fs = samples + num_samples++;
+		fs->dt = dt_sec;
+		fs->ang_vel = priv->raw_gyro;
+		fs->accel = priv->raw_accel;
+		fs->mag = priv->raw_mag;
 		end_ts += dt;
 		dt = TICK_LEN_US;
 	}
 
+	ofusion_update_batch(&priv->sensor_fusion, samples, num_samples);
+
 	priv->last_imu_timestamp = end_ts;
 }
 
@@ -501,6 +510,7 @@ static rift_s_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	// initialize sensor fusion
 	ofusion_init(&priv->sensor_fusion);
+	hmd_dev->base.sensor_fusion = &priv->sensor_fusion;
 
 	// Init touch devices 
 	for (int i = 0; i < MAX_CONTROLLERS; i++)
@@ -648,6 +658,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
 				strcpy(desc->path, cur_dev->path);
+				_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 				desc->driver_ptr = driver;
 				desc->id = id++;
@@ -661,6 +672,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				sprintf(desc->product, "%s: Left Controller", rd[i].name);
 
 				strcpy(desc->path, cur_dev->path);
+				_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 				desc->device_flags =
 					//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -680,6 +692,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				sprintf(desc->product, "%s: Right Controller", rd[i].name);
 
 				strcpy(desc->path, cur_dev->path);
+				_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 				desc->device_flags =
 					//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 
 #include "psvr.h"
+#include "../hid.h"
 
 typedef struct {
 	ohmd_device base;
@@ -95,13 +96,17 @@ static void handle_tracker_sensor_msg(psvr_priv* priv, unsigned char* buffer, in
 	}
 
 	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	fusion_sample samples[2];
 
 	for (int i = 0; i < 2; i++) {
 		float dt = tick_delta * TICK_LEN;
 		accel_from_psvr_vec(s->samples[i].accel, &priv->raw_accel);
 		gyro_from_psvr_vec(s->samples[i].gyro, &priv->raw_gyro);
 
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &mag);
+		samples[i].dt = dt;
+		samples[i].ang_vel = priv->raw_gyro;
+		samples[i].accel = priv->raw_accel;
+		samples[i].mag = mag;
 
 		if (i == 0) {
 			tick_delta = calc_delta_and_handle_rollover(
@@ -109,7 +114,10 @@ static void handle_tracker_sensor_msg(psvr_priv* priv, unsigned char* buffer, in
 		}
 	}
 
+	ofusion_update_batch(&priv->sensor_fusion, samples, 2);
+
 	priv->buttons = s->buttons;
+	ohmd_device_sample_controls(&priv->base);
 }
 
 static void teardown(psvr_priv* priv)
@@ -304,6 +312,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.getf = getf;
 
 	ofusion_init(&priv->sensor_fusion);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return (ohmd_device*)priv;
 
@@ -345,6 +354,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			desc->revision = 0;
 
 			snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+			_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 			desc->driver_ptr = driver;
 
@@ -606,6 +606,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
     if (priv->ofusion) {
         ofusion_init(&priv->ofusion->sensor_fusion);
+        priv->device.sensor_fusion = &priv->ofusion->sensor_fusion;
 
         /* Known initial value for startup correction */
         priv->hmd_data.message_num = 256;
@@ -643,6 +644,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
             desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
             strcpy(desc->path, cur_dev->path);
+            _hid_copy_serial(desc->serial, cur_dev->serial_number);
             desc->driver_ptr = driver;
         }
         cur_dev = cur_dev->next;
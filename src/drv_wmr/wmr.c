@@ -23,6 +23,7 @@
 #include <stdbool.h>
 
 #include "wmr.h"
+#include "../hid.h"
 #include "config_key.h"
 
 #include "../ext_deps/nxjson.h"
@@ -86,6 +87,7 @@ static void handle_tracker_sensor_msg(wmr_priv* priv, unsigned char* buffer, int
 
 
 	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	fusion_sample samples[4];
 
 	for(int i = 0; i < 4; i++){
 		uint64_t tick_delta = 1000;
@@ -97,10 +99,15 @@ static void handle_tracker_sensor_msg(wmr_priv* priv, unsigned char* buffer, int
 		vec3f_from_hololens_gyro(s->gyro, i, &priv->raw_gyro);
 		vec3f_from_hololens_accel(s->accel, i, &priv->raw_accel);
 
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &mag);
+		samples[i].dt = dt;
+		samples[i].ang_vel = priv->raw_gyro;
+		samples[i].accel = priv->raw_accel;
+		samples[i].mag = mag;
 
 		last_sample_tick = s->gyro_timestamp[i];
 	}
+
+	ofusion_update_batch(&priv->sensor_fusion, samples, 4);
 }
 
 static void update_device(ohmd_device* device)
@@ -154,6 +161,18 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 	return 0;
 }
 
+static void park_device(ohmd_device* device, bool parked)
+{
+	wmr_priv* priv = (wmr_priv*)device;
+
+	if(parked)
+		return;
+
+	// don't integrate the time the device was parked, and make sure the IMU is still streaming
+	priv->sensor.gyro_timestamp[3] = 0;
+	hid_write(priv->hmd_imu, hololens_sensors_imu_on, sizeof(hololens_sensors_imu_on));
+}
+
 static void close_device(ohmd_device* device)
 {
 	wmr_priv* priv = (wmr_priv*)device;
@@ -442,9 +461,11 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	// set up device callbacks
 	priv->base.update = update_device;
 	priv->base.close = close_device;
+	priv->base.park = park_device;
 	priv->base.getf = getf;
 
 	ofusion_init(&priv->sensor_fusion);
+	priv->base.sensor_fusion = &priv->sensor_fusion;
 
 	return (ohmd_device*)priv;
 
@@ -471,6 +492,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 		desc->revision = 0;
 
 		snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+		_hid_copy_serial(desc->serial, cur_dev->serial_number);
 
 		desc->driver_ptr = driver;
 
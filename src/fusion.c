@@ -11,55 +11,125 @@
 #include <string.h>
 #include "openhmdi.h"
 
+const fusion_params ofusion_default_params = {
+	0.05f, // grav_gain
+	0.4f,  // gravity_tolerance
+	0.1f,  // ang_vel_tolerance
+	50,    // level_samples
+	20     // window_size
+};
+
+static vec3f* accel_window(fusion* me)
+{
+	return me->window_storage ? me->window_storage : me->accel_window;
+}
+
+static int window_capacity(const fusion* me)
+{
+	return me->window_storage ? me->window_storage_size : FUSION_WINDOW_SIZE;
+}
+
 void ofusion_init(fusion* me)
 {
 	memset(me, 0, sizeof(fusion));
 	me->orient.w = 1.0f;
+	me->params = ofusion_default_params;
 
-	ofq_init(&me->mag_fq, 20);
-	ofq_init(&me->accel_fq, 20);
-	ofq_init(&me->ang_vel_fq, 20);
+	ostats_init(&me->accel_stats, me->accel_window, NULL, me->params.window_size);
 
-	me->flags = FF_USE_GRAVITY;
-	me->grav_gain = 0.05f;
+	me->flags = FF_USE_GRAVITY | FF_ESTIMATE_BIAS;
+
+#ifdef OHMD_FIXED_POINT_FUSION
+	me->engine = &ofusion_fixed;
+	me->engine->reset(me);
+#else
+	me->engine = &ofusion_complementary;
+#endif
 }
 
-void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* accel, const vec3f* mag)
+bool ofusion_set_params(fusion* me, const fusion_params* params)
 {
-	me->ang_vel = *ang_vel;
-	me->accel = *accel;
-	me->raw_mag = *mag;
+	if(params->grav_gain < 0 || params->gravity_tolerance <= 0 || params->ang_vel_tolerance <= 0 ||
+	   params->level_samples < 1 || params->window_size < 1 || params->window_size > window_capacity(me))
+		return false;
 
-	me->mag = *mag;
+	ofusion_flush(me);
 
-	vec3f world_accel;
-	oquatf_get_rotated(&me->orient, accel, &world_accel);
+	if(params->window_size != me->params.window_size)
+		ostats_init(&me->accel_stats, accel_window(me), NULL, params->window_size);
 
-	me->iterations += 1;
-	me->time += dt;
+	me->params = *params;
 
-	ofq_add(&me->mag_fq, mag);
-	ofq_add(&me->accel_fq, &world_accel);
-	ofq_add(&me->ang_vel_fq, ang_vel);
+	return true;
+}
 
-	float ang_vel_length = ovec3f_get_length(ang_vel);
+bool ofusion_set_window(fusion* me, vec3f* storage, int size)
+{
+	if(me->params.window_size > (storage ? size : FUSION_WINDOW_SIZE))
+		return false;
 
-	if(ang_vel_length > 0.0001f){
-		vec3f rot_axis =
-			{{ ang_vel->x / ang_vel_length, ang_vel->y / ang_vel_length, ang_vel->z / ang_vel_length }};
+	ofusion_flush(me);
 
-		float rot_angle = ang_vel_length * dt;
+	me->window_storage = storage;
+	me->window_storage_size = storage ? size : 0;
+	ostats_init(&me->accel_stats, accel_window(me), NULL, me->params.window_size);
 
-		quatf delta_orient;
-		oquatf_init_axis(&delta_orient, &rot_axis, rot_angle);
+	return true;
+}
 
-		oquatf_mult_me(&me->orient, &delta_orient);
-	}
+// applies the gravity correction gathered over a batch. It multiplies from the left, the gyro deltas from the
+// right, so collecting it and applying it once gives the same orientation as correcting after every sample.
+static void apply_gravity_correction(fusion* me, float angle)
+{
+	if(angle == 0)
+		return;
+
+	quatf corr_quat, old_orient;
+	oquatf_init_axis(&corr_quat, &me->grav_error_axis, angle);
+	old_orient = me->orient;
+
+	oquatf_mult(&corr_quat, &old_orient, &me->orient);
+}
+
+static void complementary_update(fusion* me, const fusion_sample* samples, int count)
+{
+	const float gravity_tolerance = me->params.gravity_tolerance, ang_vel_tolerance = me->params.ang_vel_tolerance;
+	const float min_tilt_error = 0.05f, max_tilt_error = 0.01f;
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+	const vec3f bias = me->gyro_bias;
+	vec3f* window = accel_window(me);
+
+	float corr_angle = 0;
+
+	for(int i = 0; i < count; i++){
+		const fusion_sample* s = samples + i;
+		const vec3f* accel = &s->accel;
+		vec3f ang_vel = {{ s->ang_vel.x - bias.x, s->ang_vel.y - bias.y, s->ang_vel.z - bias.z }};
+
+		vec3f world_accel;
+		oquatf_get_rotated(&me->orient, accel, &world_accel);
+
+		ostats_add(&me->accel_stats, window, NULL, &world_accel);
+
+		float ang_vel_length = ovec3f_get_length(&ang_vel);
+
+		if(ang_vel_length > 0.0001f){
+			vec3f rot_axis =
+				{{ ang_vel.x / ang_vel_length, ang_vel.y / ang_vel_length, ang_vel.z / ang_vel_length }};
+
+			float rot_angle = ang_vel_length * s->dt;
+
+			quatf delta_orient;
+			oquatf_init_axis(&delta_orient, &rot_axis, rot_angle);
 
-	// gravity correction
-	if(me->flags & FF_USE_GRAVITY){
-		const float gravity_tolerance = .4f, ang_vel_tolerance = .1f;
-		const float min_tilt_error = 0.05f, max_tilt_error = 0.01f;
+			oquatf_mult_me(&me->orient, &delta_orient);
+		}
+
+		me->iterations += 1;
+		me->time += s->dt;
+
+		if(!use_gravity)
+			continue;
 
 		// if the device is within tolerance levels, count this as the device is level and add to the counter
 		// otherwise reset the counter and start over
@@ -68,14 +138,14 @@ void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* acc
 			fabsf(ovec3f_get_length(accel) - 9.82f) < gravity_tolerance * 2.0f && ang_vel_length < ang_vel_tolerance
 			? me->device_level_count + 1 : 0;
 
-		// device has been level for long enough, grab mean from the accelerometer filter queue (last n values)
+		// device has been level for long enough, grab mean from the accelerometer statistics (last n values)
 		// and use for correction
 
-		if(me->device_level_count > 50){
+		if(me->device_level_count > me->params.level_samples){
 			me->device_level_count = 0;
 
 			vec3f accel_mean;
-			ofq_get_mean(&me->accel_fq, &accel_mean);
+			ostats_get_mean(&me->accel_stats, &accel_mean);
 			if (ovec3f_get_length(&accel_mean) - 9.82f < gravity_tolerance)
 			{
 				// Calculate a cross product between what the device
@@ -91,6 +161,10 @@ void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* acc
 				float tilt_angle = ovec3f_get_angle(&up, &accel_mean);
 
 				if(tilt_angle > max_tilt_error){
+					// the correction gathered so far is around the old axis
+					apply_gravity_correction(me, corr_angle);
+					corr_angle = 0;
+
 					me->grav_error_angle = tilt_angle;
 					me->grav_error_axis = tilt;
 				}
@@ -108,20 +182,359 @@ void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* acc
 
 			// otherwise try to correct
 			else {
-				use_angle = -me->grav_gain * me->grav_error_angle * 0.005f * (5.0f * ang_vel_length + 1.0f);
+				use_angle = -me->params.grav_gain * me->grav_error_angle * 0.005f * (5.0f * ang_vel_length + 1.0f);
 				me->grav_error_angle += use_angle;
 			}
 
-			// perform the correction
-			quatf corr_quat, old_orient;
-			oquatf_init_axis(&corr_quat, &me->grav_error_axis, use_angle);
-			old_orient = me->orient;
-
-			oquatf_mult(&corr_quat, &old_orient, &me->orient);
+			corr_angle += use_angle;
 		}
 	}
 
+	apply_gravity_correction(me, corr_angle);
+
 	// mitigate drift due to floating point
-	// inprecision with quat multiplication.
+	// inprecision with quat multiplication, once per batch is plenty.
 	oquatf_normalize_me(&me->orient);
+
+	const fusion_sample* last = samples + count - 1;
+	ovec3f_subtract(&last->ang_vel, &bias, &me->ang_vel);
+	me->accel = last->accel;
+	me->mag = last->mag;
+}
+
+const fusion_engine ofusion_complementary = {
+	"complementary",
+	false,
+	NULL,
+	complementary_update
+};
+
+void ofusion_set_engine(fusion* me, const fusion_engine* engine)
+{
+	ofusion_flush(me);
+
+	// a block started for the old engine would be judged with samples the new one may have estimated the bias from
+	me->bias.count = 0;
+	me->bias.time = 0;
+
+	me->engine = engine;
+	if(engine->reset)
+		engine->reset(me);
+}
+
+const fusion_engine* ofusion_get_engine(int type)
+{
+	switch(type){
+	case OHMD_FUSION_COMPLEMENTARY:
+		return &ofusion_complementary;
+	case OHMD_FUSION_ESKF:
+		return &ofusion_eskf;
+	case OHMD_FUSION_MAHONY:
+		return &ofusion_mahony;
+	case OHMD_FUSION_MADGWICK:
+		return &ofusion_madgwick;
+	case OHMD_FUSION_FIXED:
+		return &ofusion_fixed;
+	default:
+		return NULL;
+	}
+}
+
+void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* accel, const vec3f* mag)
+{
+	fusion_sample s;
+	s.dt = dt;
+	s.ang_vel = *ang_vel;
+	s.accel = *accel;
+	s.mag = *mag;
+
+	ofusion_update_batch(me, &s, 1);
+}
+
+// background gyro bias estimation, see FF_ESTIMATE_BIAS
+#define BIAS_STILL_GYRO_VAR (0.02f * 0.02f) // (rad/s)^2 per axis, the noise of a gyro at rest
+#define BIAS_STILL_GYRO_RANGE 0.1f          // rad/s per axis, a knock shows in the range before the variance
+#define BIAS_STILL_ACCEL_VAR (0.1f * 0.1f)  // (m/s^2)^2 per axis, the noise of an accelerometer at rest
+#define BIAS_MAX 0.03f                      // rad/s, a few times the bias of a MEMS gyro, more is a slow turn
+#define BIAS_SETTLE_TIME 1.0f               // s at rest in a row before the first estimate
+#define BIAS_TIME_CONSTANT 10.0f            // s, the time at rest the bias is averaged over
+
+// the first sample of a block starts the statistics over
+static void block_stats_add(fusion_block_stats* st, const vec3f* v, bool first)
+{
+	if(first){
+		memset(st, 0, sizeof(fusion_block_stats));
+		st->shift = st->min = st->max = *v;
+		return;
+	}
+
+	for(int i = 0; i < 3; i++){
+		float d = v->arr[i] - st->shift.arr[i];
+		st->sum.arr[i] += d;
+		st->sum_sq.arr[i] += d * d;
+		st->min.arr[i] = OHMD_MIN(st->min.arr[i], v->arr[i]);
+		st->max.arr[i] = OHMD_MAX(st->max.arr[i], v->arr[i]);
+	}
+}
+
+static void block_stats_get(const fusion_block_stats* st, int count, vec3f* mean, vec3f* var)
+{
+	float inv_count = 1.0f / (float)count;
+	for(int i = 0; i < 3; i++){
+		float m = st->sum.arr[i] * inv_count;
+		float v = st->sum_sq.arr[i] * inv_count - m * m;
+		mean->arr[i] = st->shift.arr[i] + m;
+		var->arr[i] = v > 0 ? v : 0;
+	}
+}
+
+// at rest the gyro measures nothing but its bias. Fusion keeps running meanwhile. A steady turn slower than
+// BIAS_MAX looks the same, so the first estimate is the mean of BIAS_SETTLE_TIME at rest in a row, which a short
+// pan doesn't last. Every block at rest after that goes into an exponential average over BIAS_TIME_CONSTANT,
+// which follows the drift with temperature. A restored bias is only refined.
+static void bias_add(fusion* me, const fusion_sample* s)
+{
+	fusion_bias* b = &me->bias;
+
+	block_stats_add(&b->gyro, &s->ang_vel, b->count == 0);
+	block_stats_add(&b->accel, &s->accel, b->count == 0);
+	b->time += s->dt;
+
+	if(++b->count < FUSION_BIAS_WINDOW)
+		return;
+
+	vec3f gyro_mean, gyro_var, accel_mean, accel_var;
+	block_stats_get(&b->gyro, b->count, &gyro_mean, &gyro_var);
+	block_stats_get(&b->accel, b->count, &accel_mean, &accel_var);
+
+	float block_time = b->time;
+	b->count = 0;
+	b->time = 0;
+
+	bool still = fabsf(ovec3f_get_length(&accel_mean) - 9.82f) <= me->params.gravity_tolerance * 2.0f &&
+	             ovec3f_get_length(&gyro_mean) <= BIAS_MAX;
+	for(int i = 0; i < 3; i++)
+		still = still && gyro_var.arr[i] < BIAS_STILL_GYRO_VAR && accel_var.arr[i] < BIAS_STILL_ACCEL_VAR &&
+		        b->gyro.max.arr[i] - b->gyro.min.arr[i] < BIAS_STILL_GYRO_RANGE;
+
+	if(!still){
+		b->still_time = 0;
+		return;
+	}
+
+	if(!(me->flags & FF_GYRO_BIAS_VALID)){
+		if(b->still_time == 0)
+			memset(&b->still_sum, 0, sizeof(vec3f));
+
+		b->still_time += block_time;
+		for(int i = 0; i < 3; i++)
+			b->still_sum.arr[i] += gyro_mean.arr[i] * block_time;
+
+		if(b->still_time < BIAS_SETTLE_TIME)
+			return;
+
+		for(int i = 0; i < 3; i++)
+			me->gyro_bias.arr[i] = b->still_sum.arr[i] / b->still_time;
+
+		b->rest_time = OHMD_MIN(b->still_time, BIAS_TIME_CONSTANT);
+		me->flags |= FF_GYRO_BIAS_VALID;
+		return;
+	}
+
+	// a restored bias counts as measured over the whole averaging time
+	if(b->rest_time == 0)
+		b->rest_time = BIAS_TIME_CONSTANT;
+
+	b->rest_time = OHMD_MIN(b->rest_time + block_time, BIAS_TIME_CONSTANT);
+
+	float k = block_time / b->rest_time;
+	for(int i = 0; i < 3; i++)
+		me->gyro_bias.arr[i] += k * (gyro_mean.arr[i] - me->gyro_bias.arr[i]);
+}
+
+// fused steps built on the stack before they are handed on
+#define PREINT_STEPS 16
+
+static void fuse_batch(fusion* me, const fusion_sample* samples, int count)
+{
+	if(!me->pending){
+		me->engine->update(me, samples, count);
+		return;
+	}
+
+	while(count > 0){
+		int n = OHMD_MIN(count, me->pending_size - me->pending_count);
+		memcpy(me->pending + me->pending_count, samples, sizeof(fusion_sample) * n);
+		me->pending_count += n;
+		samples += n;
+		count -= n;
+
+		if(me->pending_count == me->pending_size)
+			ofusion_flush(me);
+	}
+}
+
+static void preint_add(fusion_preint* p, const fusion_sample* s)
+{
+	vec3f inc = {{ s->ang_vel.x * s->dt, s->ang_vel.y * s->dt, s->ang_vel.z * s->dt }};
+	const vec3f* r = &p->rotation;
+
+	// the second order term of combining the increments, rotation x increment, zero about a fixed axis
+	p->coning.x += 0.5f * (r->y * inc.z - r->z * inc.y);
+	p->coning.y += 0.5f * (r->z * inc.x - r->x * inc.z);
+	p->coning.z += 0.5f * (r->x * inc.y - r->y * inc.x);
+
+	p->rotation.x += inc.x;
+	p->rotation.y += inc.y;
+	p->rotation.z += inc.z;
+
+	// the accelerometer samples so far are rotated into the body frame of this one, sum -= increment x sum,
+	// else the mean lags the end of the step by half of it and moving devices pick up a tilt error
+	vec3f a = p->accel_sum;
+	p->accel_sum.x += s->accel.x - (inc.y * a.z - inc.z * a.y);
+	p->accel_sum.y += s->accel.y - (inc.z * a.x - inc.x * a.z);
+	p->accel_sum.z += s->accel.z - (inc.x * a.y - inc.y * a.x);
+
+	p->mag = s->mag;
+	p->dt += s->dt;
+	p->count++;
+}
+
+// the summed up samples as one sample, the angular velocity is the mean one that rotates the same way
+static void preint_take(fusion_preint* p, fusion_sample* out)
+{
+	float inv_dt = p->dt > 0 ? 1.0f / p->dt : 0;
+	float inv_count = 1.0f / p->count;
+
+	out->dt = p->dt;
+	out->ang_vel.x = (p->rotation.x + p->coning.x) * inv_dt;
+	out->ang_vel.y = (p->rotation.y + p->coning.y) * inv_dt;
+	out->ang_vel.z = (p->rotation.z + p->coning.z) * inv_dt;
+	out->accel.x = p->accel_sum.x * inv_count;
+	out->accel.y = p->accel_sum.y * inv_count;
+	out->accel.z = p->accel_sum.z * inv_count;
+	out->mag = p->mag;
+
+	int size = p->size;
+	memset(p, 0, sizeof(fusion_preint));
+	p->size = size;
+}
+
+void ofusion_update_batch(fusion* me, const fusion_sample* samples, int count)
+{
+	if(count <= 0)
+		return;
+
+	// two estimators writing gyro_bias would fight, the one of the engine wins
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+	if((me->flags & FF_ESTIMATE_BIAS) && !(me->engine->learns_bias && use_gravity))
+		for(int i = 0; i < count; i++)
+			bias_add(me, samples + i);
+
+	if(me->preint.size <= 1){
+		fuse_batch(me, samples, count);
+		return;
+	}
+
+	fusion_sample steps[PREINT_STEPS];
+	int n = 0;
+
+	for(int i = 0; i < count; i++){
+		preint_add(&me->preint, samples + i);
+		if(me->preint.count < me->preint.size)
+			continue;
+
+		preint_take(&me->preint, steps + n++);
+		if(n == PREINT_STEPS){
+			fuse_batch(me, steps, n);
+			n = 0;
+		}
+	}
+
+	if(n > 0)
+		fuse_batch(me, steps, n);
+}
+
+bool ofusion_set_preintegration(fusion* me, int samples)
+{
+	if(samples < 0 || samples > FUSION_MAX_PREINTEGRATE)
+		return false;
+
+	if(me->preint.count > 0){
+		fusion_sample step;
+		preint_take(&me->preint, &step);
+		fuse_batch(me, &step, 1);
+	}
+
+	me->preint.size = samples;
+
+	return true;
+}
+
+void ofusion_flush(fusion* me)
+{
+	if(me->pending_count > 0)
+		me->engine->update(me, me->pending, me->pending_count);
+
+	me->pending_count = 0;
+}
+
+void ofusion_defer(fusion* me, fusion_sample* pending, int size)
+{
+	ofusion_flush(me);
+
+	me->pending = size > 0 ? pending : NULL;
+	me->pending_size = size;
+}
+
+// layout of OHMD_FUSION_STATE, bump the version when it changes
+#define STATE_VERSION 1.0f
+
+enum {
+	STATE_VERSION_IDX = 0,
+	STATE_FLAGS_IDX = 1,
+	STATE_GYRO_BIAS_IDX = 2,
+	STATE_ORIENT_IDX = 5,
+	STATE_GRAV_ANGLE_IDX = 9,
+	STATE_GRAV_AXIS_IDX = 10
+};
+
+void ofusion_get_state(fusion* me, float* out)
+{
+	ofusion_flush(me);
+
+	memset(out, 0, sizeof(float) * OHMD_FUSION_STATE_SIZE);
+
+	out[STATE_VERSION_IDX] = STATE_VERSION;
+	out[STATE_FLAGS_IDX] = (float)(me->flags & FF_GYRO_BIAS_VALID);
+	memcpy(out + STATE_GYRO_BIAS_IDX, me->gyro_bias.arr, sizeof(me->gyro_bias.arr));
+	memcpy(out + STATE_ORIENT_IDX, me->orient.arr, sizeof(me->orient.arr));
+	out[STATE_GRAV_ANGLE_IDX] = me->grav_error_angle;
+	memcpy(out + STATE_GRAV_AXIS_IDX, me->grav_error_axis.arr, sizeof(me->grav_error_axis.arr));
+}
+
+bool ofusion_set_state(fusion* me, const float* in)
+{
+	if(in[STATE_VERSION_IDX] != STATE_VERSION)
+		return false;
+
+	quatf orient;
+	memcpy(orient.arr, in + STATE_ORIENT_IDX, sizeof(orient.arr));
+	if(fabsf(oquatf_get_length(&orient) - 1.0f) > 0.01f)
+		return false;
+
+	ofusion_flush(me);
+
+	// the gravity snap of the first iterations stays on, the device may have been moved while it was off
+	me->flags = (me->flags & ~FF_GYRO_BIAS_VALID) | ((int)in[STATE_FLAGS_IDX] & FF_GYRO_BIAS_VALID);
+	memcpy(me->gyro_bias.arr, in + STATE_GYRO_BIAS_IDX, sizeof(me->gyro_bias.arr));
+	me->orient = orient;
+	me->grav_error_angle = in[STATE_GRAV_ANGLE_IDX];
+	memcpy(me->grav_error_axis.arr, in + STATE_GRAV_AXIS_IDX, sizeof(me->grav_error_axis.arr));
+
+	// lets the engine trust the restored bias
+	if(me->engine->reset)
+		me->engine->reset(me);
+
+	return true;
 }
@@ -14,32 +14,210 @@
 #include "omath.h"
 
 #define FF_USE_GRAVITY 1
+#define FF_GYRO_BIAS_VALID 2 // gyro_bias has been measured or restored
+#define FF_ESTIMATE_BIAS 4   // gyro_bias is measured in the background whenever the device is at rest, unless the
+                             // engine learns it itself, see fusion_engine.learns_bias
 
+// accelerometer samples averaged for gravity correction that fit in fusion itself, larger windows need storage from
+// ofusion_set_window, see fusion_params.window_size
+#define FUSION_WINDOW_SIZE 20
+
+// tuning of the complementary filter, the defaults suit most devices
+typedef struct {
+	float grav_gain;         // amount of correction
+	float gravity_tolerance; // m/s^2 away from 1 g where the device counts as level
+	float ang_vel_tolerance; // rad/s below which the device counts as level
+	int level_samples;       // level samples in a row before the accelerometer mean is used
+	int window_size;         // accelerometer samples averaged, at most FUSION_WINDOW_SIZE or the ofusion_set_window size
+} fusion_params;
+
+extern const fusion_params ofusion_default_params;
+
+// a sample for ofusion_update_batch, dt is the time since the previous sample in seconds
+typedef struct {
+	float dt;
+	vec3f ang_vel;
+	vec3f accel;
+	vec3f mag;
+} fusion_sample;
+
+// most raw samples pre-integrated into one fused step, see ofusion_set_preintegration
+#define FUSION_MAX_PREINTEGRATE 64
+
+// raw samples summed up for the next fused step
+typedef struct {
+	int size;        // samples per step, 0 fuses every sample as it is
+	int count;
+	float dt;
+	vec3f rotation;  // sum of the gyro increments
+	vec3f coning;    // half the sum of rotation x increment, the non-commutative part of the rotation
+	vec3f accel_sum;
+	vec3f mag;       // last magnetometer sample
+} fusion_preint;
+
+// samples in a block of the background gyro bias estimation, the block is judged at rest or not as a whole
+#define FUSION_BIAS_WINDOW 64
+
+// running statistics of one sensor over a block, the sums are taken around the first sample of the block
+// to keep the rounding of the variance down
+typedef struct {
+	vec3f shift;
+	vec3f sum, sum_sq;
+	vec3f min, max;
+} fusion_block_stats;
+
+// the background gyro bias estimation, statistics of the raw samples of the current block
+typedef struct {
+	fusion_block_stats gyro, accel;
+	int count;        // samples in the current block
+	float time;       // length of the current block
+	float still_time; // blocks at rest in a row, while there is no bias yet
+	vec3f still_sum;  // their gyro means weighted by their length
+	float rest_time;  // time at rest gyro_bias was measured over, up to the averaging time
+} fusion_bias;
+
+typedef struct fusion fusion;
+
+// a fusion algorithm, the orientation, bias and sample bookkeeping in fusion are shared by all of them
+typedef struct {
+	const char* name;
+	// the engine learns gyro_bias itself from gravity, FF_ESTIMATE_BIAS only applies while FF_USE_GRAVITY is off
+	bool learns_bias;
+	// prepares the engine's own state, the shared state is kept
+	void (*reset)(fusion* me);
+	// fuses count > 0 samples, updating orient, gyro_bias, iterations, time and the last sample values
+	void (*update)(fusion* me, const fusion_sample* samples, int count);
+} fusion_engine;
+
+// tuning of the Mahony and Madgwick filters, also used by the lane-parallel Mahony filter of fusion_bank
+#define FUSION_MAHONY_KP 0.5f  // proportional gain, 1/s
+#define FUSION_MAHONY_KI 0.02f // integral gain, learns the gyro bias, 1/s^2
+// the gains are raised for the first seconds so the filters find gravity quickly, without the
+// integral term of mahony picking up the large initial error as bias
+#define FUSION_SETTLE_TIME 2.0f
+#define FUSION_SETTLE_GAIN 20.0f
+#define FUSION_ACCEL_GATE 0.8f // m/s^2 away from 1 g where the accelerometer is ignored
+#define FUSION_GRAVITY 9.81f
+
+extern const fusion_engine ofusion_complementary;
+extern const fusion_engine ofusion_eskf;
+extern const fusion_engine ofusion_mahony;
+extern const fusion_engine ofusion_madgwick;
+extern const fusion_engine ofusion_fixed;
+
+// error-state Kalman filter over the orientation error and the gyro bias
+#define FUSION_ESKF_STATES 6
+
+typedef struct {
+	float P[FUSION_ESKF_STATES][FUSION_ESKF_STATES]; // error covariance
+} fusion_eskf_state;
+
+// the complementary filter in fixed-point, Q30 quaternions and unit vectors, Q29 angles and Q16 m/s^2
 typedef struct {
-	int state;
+	int32_t orient[4];
+	int32_t accel_mean[3];  // exponential average of the world space accelerometer values
+	int32_t grav_error_angle;
+	int32_t grav_error_axis[3];
+	bool accel_mean_valid;
+} fusion_fixed_state;
 
+// fusion holds no pointers into itself and can be copied, a copy shares the caller owned storage
+struct fusion {
+	// fields touched on every sample are kept together at the front
+	// so the update path only pulls in a couple of cache lines
 	quatf orient;   // orientation
-	vec3f accel;    // acceleration
-	vec3f ang_vel;  // angular velocity
-	vec3f mag;      // magnetometer
-	vec3f raw_mag;  // raw magnetometer values
+	const fusion_engine* engine;
 
 	int iterations;
 	float time;
 
 	int flags;
 
-	// filter queues for magnetometer, accelerometers and angular velocity
-	filter_queue mag_fq, accel_fq, ang_vel_fq;
-
-	// gravity correction
+	// gravity correction of the complementary filter
 	int device_level_count;
 	float grav_error_angle;
 	vec3f grav_error_axis;
-	float grav_gain; // amount of correction
-} fusion;
+	fusion_params params;
+
+	// statistics of the world space accelerometer values, kept in accel_window or window_storage
+	stats_window accel_stats;
+
+	vec3f accel;    // acceleration
+	vec3f ang_vel;  // angular velocity, without gyro_bias
+	vec3f mag;      // magnetometer
+
+	vec3f gyro_bias; // subtracted from every angular velocity sample
+
+	// storage for accel_stats, one slot is written per sample
+	vec3f accel_window[FUSION_WINDOW_SIZE];
+	vec3f* window_storage; // caller owned, NULL for accel_window
+	int window_storage_size;
+
+	// samples not fused yet, NULL unless fusion is deferred
+	fusion_sample* pending;
+	int pending_count;
+	int pending_size;
 
+	fusion_preint preint;
+	fusion_bias bias;
+
+	// state of the engine that runs, set up by its reset
+	union {
+		fusion_eskf_state eskf;
+		fusion_fixed_state fixed;
+	} state;
+};
+
+// estimates the gyro bias in the background and starts out with the complementary filter, or its fixed-point version in OHMD_FIXED_POINT_FUSION builds, and
+// ofusion_default_params
 void ofusion_init(fusion* me);
+// false if a value is out of range, a new window size restarts the accelerometer statistics
+bool ofusion_set_params(fusion* me, const fusion_params* params);
+// caller owned storage of size entries for accelerometer windows larger than FUSION_WINDOW_SIZE, NULL goes back to
+// the storage in fusion. The accelerometer statistics restart, false if the window size doesn't fit.
+bool ofusion_set_window(fusion* me, vec3f* storage, int size);
+// switches the algorithm, pending samples are fused by the old one and the orientation and bias carry over
+void ofusion_set_engine(fusion* me, const fusion_engine* engine);
+// the engine for an ohmd_fusion_engine value, NULL if there is none
+const fusion_engine* ofusion_get_engine(int type);
+
 void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* accel, const vec3f* mag_field);
+// fuses all samples of a report at once, normalizing and applying the gravity correction once per call
+void ofusion_update_batch(fusion* me, const fusion_sample* samples, int count);
+
+// sums up this many raw samples into one fused step, with coning compensation for the gyro and the mean of the
+// accelerometer. The orientation trails by up to samples - 1 samples, and the sample counts of fusion_params count
+// steps. 0 or 1 fuses every sample, false if samples is out of range. A partial step is fused first.
+bool ofusion_set_preintegration(fusion* me, int samples);
+
+// makes ofusion_update only store samples in pending (caller owned, size entries) until ofusion_flush is called
+// or pending is full, NULL fuses every sample right away again. Anything still pending is fused first.
+void ofusion_defer(fusion* me, fusion_sample* pending, int size);
+void ofusion_flush(fusion* me);
+
+// learned state that carries over to the next session, see OHMD_FUSION_STATE
+void ofusion_get_state(fusion* me, float* out);
+bool ofusion_set_state(fusion* me, const float* in);
+
+// many devices fused together, see fusion_bank.c. The devices defer their samples with ofusion_defer and
+// ofusion_bank_flush runs the Mahony filter over all of them, four or eight devices per SIMD instruction.
+// The device storage is owned by the caller and must hold at least size entries.
+typedef struct {
+	fusion** devices;
+	int size;
+	int count;
+} fusion_bank;
+
+#define FUSION_BANK_LANES 8    // devices fused side by side, the widest kernel
+#define FUSION_BANK_PENDING 64 // samples a device in a bank keeps unless it already defers fusion
+
+void ofusion_bank_init(fusion_bank* me, fusion** devices, int size);
+// switches the device to ofusion_mahony, it must defer its samples, false if the bank is full
+bool ofusion_bank_add(fusion_bank* me, fusion* f);
+void ofusion_bank_remove(fusion_bank* me, fusion* f);
+// fuses the pending samples of every device, the same as ofusion_flush on each of them to within rounding
+void ofusion_bank_flush(fusion_bank* me);
+// the name of the kernel ofusion_bank_flush uses, it follows the omath backend
+const char* ofusion_bank_kernel(void);
 
 #endif
@@ -0,0 +1,313 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Sensor Fusion - Lane-Parallel Mahony Filter Bank */
+
+/*
+ * For hosts fusing dozens of IMUs, where running mahony_update once per device leaves most of every SIMD register
+ * empty. The devices with pending samples are taken FUSION_BANK_LANES at a time, one device per lane. A scalar pass
+ * transposes their samples into one array per component and step and does everything that branches on the way,
+ * the accelerometer gate and the settling gains become per lane gains that are zero where mahony_update skips the
+ * correction. The kernel then keeps the orientation and bias of its lanes in registers for all steps. Lanes whose
+ * device has run out of samples get a dt of 0, which leaves them as they are.
+ *
+ * The kernel does the operations of mahony_update in the same order, so it matches it to within the rounding of
+ * the fused multiply adds a compiler may contract the vector code to. The kernel follows the omath backend:
+ * eight lanes with AVX2, four with SSE2 and on AArch64, one with the scalar backend.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include "openhmdi.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BANK_SSE
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define BANK_TARGET_AVX2
+#else
+#define BANK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (defined(__aarch64__) || defined(_M_ARM64))
+// 32 bit NEON has no vector division or square root
+#define BANK_NEON
+#include <arm_neon.h>
+#endif
+
+#define BANK_STEPS 16 // samples per device transposed at a time
+
+// the inputs of one sample per lane
+typedef struct {
+	float dt[FUSION_BANK_LANES];
+	float gx[FUSION_BANK_LANES], gy[FUSION_BANK_LANES], gz[FUSION_BANK_LANES];
+	float ax[FUSION_BANK_LANES], ay[FUSION_BANK_LANES], az[FUSION_BANK_LANES];
+	float kp[FUSION_BANK_LANES], ki[FUSION_BANK_LANES];
+} bank_step;
+
+typedef struct {
+	float x[FUSION_BANK_LANES], y[FUSION_BANK_LANES], z[FUSION_BANK_LANES], w[FUSION_BANK_LANES];
+	float bx[FUSION_BANK_LANES], by[FUSION_BANK_LANES], bz[FUSION_BANK_LANES]; // gyro bias
+} bank_lanes;
+
+// fuses count steps of the first lanes lanes, a vector kernel rounds that up to its width
+typedef void (*bank_kernel)(bank_lanes* l, const bank_step* steps, int count, int lanes);
+
+// mahony_update with one device per lane, _w lanes per instruction
+#define FUSION_BANK_KERNEL(_pre, _attr, _v, _w, _load, _store, _set1, _add, _sub, _mul, _div, _sqrt, _max) \
+_attr static void _pre##_bank_kernel(bank_lanes* l, const bank_step* steps, int count, int lanes) \
+{ \
+	const _v half = _set1(0.5f), one = _set1(1.0f), two = _set1(2.0f), tiny = _set1(FLT_MIN); \
+	for(int i = 0; i < lanes; i += _w){ \
+		_v x = _load(l->x + i), y = _load(l->y + i), z = _load(l->z + i), w = _load(l->w + i); \
+		_v bx = _load(l->bx + i), by = _load(l->by + i), bz = _load(l->bz + i); \
+		for(int k = 0; k < count; k++){ \
+			const bank_step* s = steps + k; \
+			_v dt = _load(s->dt + i), kp = _load(s->kp + i), ki = _load(s->ki + i); \
+			_v ax = _load(s->ax + i), ay = _load(s->ay + i), az = _load(s->az + i); \
+			_v inv_norm = _div(one, _sqrt(_max(_add(_add(_mul(ax, ax), _mul(ay, ay)), _mul(az, az)), tiny))); \
+			ax = _mul(ax, inv_norm); \
+			ay = _mul(ay, inv_norm); \
+			az = _mul(az, inv_norm); \
+			_v vx = _mul(two, _add(_mul(x, y), _mul(w, z))); \
+			_v vy = _sub(one, _mul(two, _add(_mul(x, x), _mul(z, z)))); \
+			_v vz = _mul(two, _sub(_mul(y, z), _mul(w, x))); \
+			_v ex = _sub(_mul(ay, vz), _mul(az, vy)); \
+			_v ey = _sub(_mul(az, vx), _mul(ax, vz)); \
+			_v ez = _sub(_mul(ax, vy), _mul(ay, vx)); \
+			_v wx = _add(_sub(_load(s->gx + i), bx), _mul(kp, ex)); \
+			_v wy = _add(_sub(_load(s->gy + i), by), _mul(kp, ey)); \
+			_v wz = _add(_sub(_load(s->gz + i), bz), _mul(kp, ez)); \
+			bx = _sub(bx, _mul(_mul(ki, ex), dt)); \
+			by = _sub(by, _mul(_mul(ki, ey), dt)); \
+			bz = _sub(bz, _mul(_mul(ki, ez), dt)); \
+			_v h = _mul(half, dt); \
+			_v nx = _add(x, _mul(h, _sub(_add(_mul(w, wx), _mul(y, wz)), _mul(z, wy)))); \
+			_v ny = _add(y, _mul(h, _sub(_add(_mul(w, wy), _mul(z, wx)), _mul(x, wz)))); \
+			_v nz = _add(z, _mul(h, _sub(_add(_mul(w, wz), _mul(x, wy)), _mul(y, wx)))); \
+			w = _sub(w, _mul(h, _add(_add(_mul(x, wx), _mul(y, wy)), _mul(z, wz)))); \
+			x = nx; \
+			y = ny; \
+			z = nz; \
+		} \
+		_store(l->x + i, x); \
+		_store(l->y + i, y); \
+		_store(l->z + i, z); \
+		_store(l->w + i, w); \
+		_store(l->bx + i, bx); \
+		_store(l->by + i, by); \
+		_store(l->bz + i, bz); \
+	} \
+}
+
+#define SCALAR_LOAD(_p) (*(_p))
+#define SCALAR_STORE(_p, _v) (*(_p) = (_v))
+#define SCALAR_SET1(_f) (_f)
+#define SCALAR_ADD(_a, _b) ((_a) + (_b))
+#define SCALAR_SUB(_a, _b) ((_a) - (_b))
+#define SCALAR_MUL(_a, _b) ((_a) * (_b))
+#define SCALAR_DIV(_a, _b) ((_a) / (_b))
+
+FUSION_BANK_KERNEL(scalar, , float, 1, SCALAR_LOAD, SCALAR_STORE, SCALAR_SET1, SCALAR_ADD, SCALAR_SUB, SCALAR_MUL,
+                   SCALAR_DIV, sqrtf, fmaxf)
+
+#ifdef BANK_SSE
+FUSION_BANK_KERNEL(sse, , __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps,
+                   _mm_div_ps, _mm_sqrt_ps, _mm_max_ps)
+FUSION_BANK_KERNEL(avx2, BANK_TARGET_AVX2, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+                   _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_sqrt_ps, _mm256_max_ps)
+#endif
+
+#ifdef BANK_NEON
+FUSION_BANK_KERNEL(neon, , float32x4_t, 4, vld1q_f32, vst1q_f32, vdupq_n_f32, vaddq_f32, vsubq_f32, vmulq_f32,
+                   vdivq_f32, vsqrtq_f32, vmaxq_f32)
+#endif
+
+// the widest kernel the omath backend can run, so OHMD_MATH_BACKEND picks this one too
+static bank_kernel pick_kernel(const char** name)
+{
+	const char* backend = omath_get_backend()->name;
+
+#ifdef BANK_SSE
+	if(strcmp(backend, "avx2") == 0){
+		*name = "avx2";
+		return avx2_bank_kernel;
+	}
+	if(strcmp(backend, "sse2") == 0){
+		*name = "sse2";
+		return sse_bank_kernel;
+	}
+#endif
+
+#ifdef BANK_NEON
+	if(strcmp(backend, "neon") == 0){
+		*name = "neon";
+		return neon_bank_kernel;
+	}
+#endif
+
+	*name = "scalar";
+	return scalar_bank_kernel;
+}
+
+const char* ofusion_bank_kernel(void)
+{
+	const char* name;
+	pick_kernel(&name);
+	return name;
+}
+
+// the accelerometer gate of mahony_update
+static inline bool gravity_gate(const vec3f* accel)
+{
+	float norm_sq = accel->x * accel->x + accel->y * accel->y + accel->z * accel->z;
+	return norm_sq >= (FUSION_GRAVITY - FUSION_ACCEL_GATE) * (FUSION_GRAVITY - FUSION_ACCEL_GATE) &&
+	       norm_sq <= (FUSION_GRAVITY + FUSION_ACCEL_GATE) * (FUSION_GRAVITY + FUSION_ACCEL_GATE);
+}
+
+// fuses up to FUSION_BANK_LANES devices side by side
+static void flush_lanes(bank_kernel kernel, fusion** devices, int count)
+{
+	OMATH_ALIGNED bank_lanes lanes;
+	OMATH_ALIGNED bank_step steps[BANK_STEPS];
+	float time[FUSION_BANK_LANES];
+	int max_pending = 0;
+
+	memset(&lanes, 0, sizeof(lanes));
+
+	for(int j = 0; j < count; j++){
+		const fusion* f = devices[j];
+		lanes.x[j] = f->orient.x;
+		lanes.y[j] = f->orient.y;
+		lanes.z[j] = f->orient.z;
+		lanes.w[j] = f->orient.w;
+		lanes.bx[j] = f->gyro_bias.x;
+		lanes.by[j] = f->gyro_bias.y;
+		lanes.bz[j] = f->gyro_bias.z;
+		time[j] = f->time;
+		max_pending = OHMD_MAX(max_pending, f->pending_count);
+	}
+
+	for(int first = 0; first < max_pending; first += BANK_STEPS){
+		int num_steps = OHMD_MIN(BANK_STEPS, max_pending - first);
+		memset(steps, 0, sizeof(bank_step) * num_steps);
+
+		for(int j = 0; j < count; j++){
+			const fusion* f = devices[j];
+			const bool use_gravity = (f->flags & FF_USE_GRAVITY) != 0;
+			int end = OHMD_MIN(f->pending_count - first, num_steps);
+
+			for(int k = 0; k < end; k++){
+				const fusion_sample* s = f->pending + first + k;
+				bank_step* st = steps + k;
+
+				st->dt[j] = s->dt;
+				st->gx[j] = s->ang_vel.x;
+				st->gy[j] = s->ang_vel.y;
+				st->gz[j] = s->ang_vel.z;
+				st->ax[j] = s->accel.x;
+				st->ay[j] = s->accel.y;
+				st->az[j] = s->accel.z;
+
+				if(use_gravity && gravity_gate(&s->accel)){
+					const bool settling = time[j] < FUSION_SETTLE_TIME;
+					st->kp[j] = settling ? FUSION_MAHONY_KP * FUSION_SETTLE_GAIN : FUSION_MAHONY_KP;
+					st->ki[j] = settling ? 0 : FUSION_MAHONY_KI;
+				}
+
+				time[j] += s->dt;
+			}
+		}
+
+		kernel(&lanes, steps, num_steps, count);
+	}
+
+	for(int j = 0; j < count; j++){
+		fusion* f = devices[j];
+		const fusion_sample* last = f->pending + f->pending_count - 1;
+
+		f->orient.x = lanes.x[j];
+		f->orient.y = lanes.y[j];
+		f->orient.z = lanes.z[j];
+		f->orient.w = lanes.w[j];
+		f->gyro_bias.x = lanes.bx[j];
+		f->gyro_bias.y = lanes.by[j];
+		f->gyro_bias.z = lanes.bz[j];
+
+		// as finish_batch in fusion_lite.c
+		oquatf_normalize_me(&f->orient);
+		ovec3f_subtract(&last->ang_vel, &f->gyro_bias, &f->ang_vel);
+		f->accel = last->accel;
+		f->mag = last->mag;
+
+		f->iterations += f->pending_count;
+		f->time = time[j];
+		f->pending_count = 0;
+	}
+}
+
+void ofusion_bank_init(fusion_bank* me, fusion** devices, int size)
+{
+	me->devices = devices;
+	me->size = size;
+	me->count = 0;
+}
+
+bool ofusion_bank_add(fusion_bank* me, fusion* f)
+{
+	for(int i = 0; i < me->count; i++)
+		if(me->devices[i] == f)
+			return true;
+
+	if(me->count == me->size)
+		return false;
+
+	ofusion_set_engine(f, &ofusion_mahony);
+	me->devices[me->count++] = f;
+
+	return true;
+}
+
+void ofusion_bank_remove(fusion_bank* me, fusion* f)
+{
+	for(int i = 0; i < me->count; i++){
+		if(me->devices[i] != f)
+			continue;
+
+		me->devices[i] = me->devices[--me->count];
+		return;
+	}
+}
+
+void ofusion_bank_flush(fusion_bank* me)
+{
+	const char* name;
+	bank_kernel kernel = pick_kernel(&name);
+	fusion* lanes[FUSION_BANK_LANES];
+	int count = 0;
+
+	// only the devices with samples waiting take up a lane, one that switched engines is fused on its own
+	for(int i = 0; i < me->count; i++){
+		fusion* f = me->devices[i];
+		if(f->pending_count == 0)
+			continue;
+
+		if(f->engine != &ofusion_mahony){
+			ofusion_flush(f);
+			continue;
+		}
+
+		lanes[count++] = f;
+		if(count == FUSION_BANK_LANES){
+			flush_lanes(kernel, lanes, count);
+			count = 0;
+		}
+	}
+
+	if(count > 0)
+		flush_lanes(kernel, lanes, count);
+}
@@ -0,0 +1,264 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Sensor Fusion - Error-State Kalman Filter */
+
+/*
+ * The nominal state is the orientation and the gyro bias kept in fusion. The filter tracks the covariance of a small
+ * error around it, a rotation dtheta in the body frame (orient * exp(dtheta)) and a bias error db, six states in all.
+ *
+ * Every gyro sample propagates the nominal state and the covariance. While the device isn't accelerating the
+ * accelerometer corrects both, by comparing the measured direction of gravity with the one the orientation predicts.
+ * Yaw can't be observed without a magnetometer and drifts like it does with the complementary filter.
+ *
+ * The covariance is a fixed 6x6 block inside fusion and the products are written out for its 3x3 block structure,
+ * an update touches a few hundred bytes and never allocates.
+ */
+
+#include <string.h>
+#include "openhmdi.h"
+
+// noise model
+#define GYRO_NOISE 0.01f      // angle random walk, rad/sqrt(s)
+#define BIAS_NOISE 0.0002f    // bias random walk, rad/s/sqrt(s)
+#define ACCEL_NOISE 0.03f     // direction error of an accelerometer sample at rest, rad
+#define ACCEL_GATE 0.8f       // m/s^2 away from 1 g where the accelerometer is ignored
+
+#define INITIAL_ANGLE_VAR (0.5f * 0.5f)
+#define INITIAL_BIAS_VAR (0.02f * 0.02f)
+#define RESTORED_BIAS_VAR (0.002f * 0.002f)
+
+#define GRAVITY 9.81f
+
+typedef float mat3[3][3];
+
+// the 3x3 products below are spelled out, they are small enough that loops only get in the way of the compiler
+
+#define DOT_ROW_COL(_a, _b, _i, _j) ((_a)[_i][0] * (_b)[0][_j] + (_a)[_i][1] * (_b)[1][_j] + (_a)[_i][2] * (_b)[2][_j])
+#define DOT_ROW_ROW(_a, _b, _i, _j) ((_a)[_i][0] * (_b)[_j][0] + (_a)[_i][1] * (_b)[_j][1] + (_a)[_i][2] * (_b)[_j][2])
+
+// out = a * b
+static inline void mat3_mul(mat3 a, mat3 b, mat3 out)
+{
+	out[0][0] = DOT_ROW_COL(a, b, 0, 0); out[0][1] = DOT_ROW_COL(a, b, 0, 1); out[0][2] = DOT_ROW_COL(a, b, 0, 2);
+	out[1][0] = DOT_ROW_COL(a, b, 1, 0); out[1][1] = DOT_ROW_COL(a, b, 1, 1); out[1][2] = DOT_ROW_COL(a, b, 1, 2);
+	out[2][0] = DOT_ROW_COL(a, b, 2, 0); out[2][1] = DOT_ROW_COL(a, b, 2, 1); out[2][2] = DOT_ROW_COL(a, b, 2, 2);
+}
+
+// out = a * b^T
+static inline void mat3_mul_bt(mat3 a, mat3 b, mat3 out)
+{
+	out[0][0] = DOT_ROW_ROW(a, b, 0, 0); out[0][1] = DOT_ROW_ROW(a, b, 0, 1); out[0][2] = DOT_ROW_ROW(a, b, 0, 2);
+	out[1][0] = DOT_ROW_ROW(a, b, 1, 0); out[1][1] = DOT_ROW_ROW(a, b, 1, 1); out[1][2] = DOT_ROW_ROW(a, b, 1, 2);
+	out[2][0] = DOT_ROW_ROW(a, b, 2, 0); out[2][1] = DOT_ROW_ROW(a, b, 2, 1); out[2][2] = DOT_ROW_ROW(a, b, 2, 2);
+}
+
+// inverse of a symmetric positive definite 3x3 matrix
+static inline bool mat3_inverse_sym(mat3 m, mat3 out)
+{
+	float c00 = m[1][1] * m[2][2] - m[1][2] * m[1][2];
+	float c01 = m[0][2] * m[1][2] - m[0][1] * m[2][2];
+	float c02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	float c11 = m[0][0] * m[2][2] - m[0][2] * m[0][2];
+	float c12 = m[0][1] * m[0][2] - m[0][0] * m[1][2];
+	float c22 = m[0][0] * m[1][1] - m[0][1] * m[0][1];
+
+	float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+	if(det <= 1e-30f)
+		return false;
+
+	float inv_det = 1.0f / det;
+	out[0][0] = c00 * inv_det; out[0][1] = c01 * inv_det; out[0][2] = c02 * inv_det;
+	out[1][0] = c01 * inv_det; out[1][1] = c11 * inv_det; out[1][2] = c12 * inv_det;
+	out[2][0] = c02 * inv_det; out[2][1] = c12 * inv_det; out[2][2] = c22 * inv_det;
+
+	return true;
+}
+
+static inline void get_block(float P[FUSION_ESKF_STATES][FUSION_ESKF_STATES], int row, int col, mat3 out)
+{
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++)
+			out[i][j] = P[row + i][col + j];
+}
+
+// orient = orient * exp(angle)
+static void rotate_body(quatf* orient, const vec3f* angle)
+{
+	float length = ovec3f_get_length(angle);
+	if(length < 1e-9f)
+		return;
+
+	vec3f axis = {{ angle->x / length, angle->y / length, angle->z / length }};
+	quatf delta;
+	oquatf_init_axis(&delta, &axis, length);
+	oquatf_mult_me(orient, &delta);
+}
+
+static void eskf_reset(fusion* me)
+{
+	float (*P)[FUSION_ESKF_STATES] = me->state.eskf.P;
+	float bias_var = (me->flags & FF_GYRO_BIAS_VALID) ? RESTORED_BIAS_VAR : INITIAL_BIAS_VAR;
+
+	memset(&me->state.eskf, 0, sizeof(me->state.eskf));
+
+	for(int i = 0; i < 3; i++){
+		P[i][i] = INITIAL_ANGLE_VAR;
+		P[i + 3][i + 3] = bias_var;
+	}
+}
+
+// P = F P F^T + Q, with F = [A, -dt I; 0, I] and A = I - [w dt]x
+static void eskf_predict(fusion* me, const vec3f* w, float dt)
+{
+	float (*P)[FUSION_ESKF_STATES] = me->state.eskf.P;
+	mat3 P11, P12, P22, A, AP11, AP12, M1, M2, P11n;
+
+	get_block(P, 0, 0, P11);
+	get_block(P, 0, 3, P12);
+	get_block(P, 3, 3, P22);
+
+	float x = w->x * dt, y = w->y * dt, z = w->z * dt;
+	A[0][0] = 1;  A[0][1] = z;  A[0][2] = -y;
+	A[1][0] = -z; A[1][1] = 1;  A[1][2] = x;
+	A[2][0] = y;  A[2][1] = -x; A[2][2] = 1;
+
+	mat3_mul(A, P11, AP11);
+	mat3_mul(A, P12, AP12);
+
+	// M1 = A P11 - dt P21, M2 = A P12 - dt P22
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++){
+			M1[i][j] = AP11[i][j] - dt * P12[j][i];
+			M2[i][j] = AP12[i][j] - dt * P22[i][j];
+		}
+
+	// P11 = M1 A^T - dt M2, P12 = M2
+	mat3_mul_bt(M1, A, P11n);
+
+	const float q_angle = GYRO_NOISE * GYRO_NOISE * dt;
+	const float q_bias = BIAS_NOISE * BIAS_NOISE * dt;
+
+	for(int i = 0; i < 3; i++){
+		for(int j = 0; j < 3; j++){
+			// keeps P symmetric despite rounding
+			P[i][j] = 0.5f * ((P11n[i][j] - dt * M2[i][j]) + (P11n[j][i] - dt * M2[j][i]));
+			P[i][j + 3] = M2[i][j];
+			P[j + 3][i] = M2[i][j];
+		}
+		P[i][i] += q_angle;
+		P[i + 3][i + 3] += q_bias;
+	}
+}
+
+// corrects with the direction of gravity measured by the accelerometer
+static void eskf_correct(fusion* me, const vec3f* accel)
+{
+	float (*P)[FUSION_ESKF_STATES] = me->state.eskf.P;
+
+	float norm = ovec3f_get_length(accel);
+	float deviation = (norm - GRAVITY) / ACCEL_GATE;
+	if(fabsf(deviation) >= 1.0f)
+		return;
+
+	// predicted gravity direction in the body frame, h = R^T up
+	quatf inv = {{ -me->orient.x, -me->orient.y, -me->orient.z, me->orient.w }};
+	vec3f up = {{ 0, 1.0f, 0 }}, h;
+	oquatf_get_rotated(&inv, &up, &h);
+
+	float r[3] = { accel->x / norm - h.x, accel->y / norm - h.y, accel->z / norm - h.z };
+
+	// H = [Hx, 0], Hx = [h]x
+	mat3 Hx = {
+		{ 0, -h.z, h.y },
+		{ h.z, 0, -h.x },
+		{ -h.y, h.x, 0 }
+	};
+
+	// PHt = P H^T, rows 0-2 are P11 Hx^T, rows 3-5 are P21 Hx^T
+	mat3 P11, P21, PHt_top, PHt_bottom, S, HPHt, S_inv;
+	get_block(P, 0, 0, P11);
+	get_block(P, 3, 0, P21);
+	mat3_mul_bt(P11, Hx, PHt_top);
+	mat3_mul_bt(P21, Hx, PHt_bottom);
+
+	// S = Hx P11 Hx^T + R
+	mat3_mul(Hx, PHt_top, HPHt);
+	const float noise = ACCEL_NOISE * ACCEL_NOISE * (1.0f + 10.0f * deviation * deviation);
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++)
+			S[i][j] = 0.5f * (HPHt[i][j] + HPHt[j][i]) + (i == j ? noise : 0);
+
+	if(!mat3_inverse_sym(S, S_inv))
+		return;
+
+	// K = P H^T S^-1
+	float K[FUSION_ESKF_STATES][3], PHt[FUSION_ESKF_STATES][3];
+	mat3_mul(PHt_top, S_inv, K);
+	mat3_mul(PHt_bottom, S_inv, K + 3);
+	memcpy(PHt, PHt_top, sizeof(mat3));
+	memcpy(PHt[3], PHt_bottom, sizeof(mat3));
+
+	// P = P - K (P H^T)^T
+	for(int i = 0; i < FUSION_ESKF_STATES; i++)
+		for(int j = i; j < FUSION_ESKF_STATES; j++){
+			float v = P[i][j] - (K[i][0] * PHt[j][0] + K[i][1] * PHt[j][1] + K[i][2] * PHt[j][2]);
+			P[i][j] = v;
+			P[j][i] = v;
+		}
+
+	// inject the error into the nominal state, the error is zero again afterwards
+	vec3f dtheta, dbias;
+	for(int i = 0; i < 3; i++){
+		dtheta.arr[i] = K[i][0] * r[0] + K[i][1] * r[1] + K[i][2] * r[2];
+		dbias.arr[i] = K[i + 3][0] * r[0] + K[i + 3][1] * r[1] + K[i + 3][2] * r[2];
+	}
+
+	rotate_body(&me->orient, &dtheta);
+	for(int i = 0; i < 3; i++)
+		me->gyro_bias.arr[i] += dbias.arr[i];
+}
+
+static void eskf_update(fusion* me, const fusion_sample* samples, int count)
+{
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+
+	for(int i = 0; i < count; i++){
+		const fusion_sample* s = samples + i;
+		vec3f w, angle;
+
+		ovec3f_subtract(&s->ang_vel, &me->gyro_bias, &w);
+
+		// nominal state, orient = orient * exp(w dt)
+		angle.x = w.x * s->dt;
+		angle.y = w.y * s->dt;
+		angle.z = w.z * s->dt;
+		rotate_body(&me->orient, &angle);
+
+		eskf_predict(me, &w, s->dt);
+
+		if(use_gravity)
+			eskf_correct(me, &s->accel);
+
+		me->iterations += 1;
+		me->time += s->dt;
+	}
+
+	oquatf_normalize_me(&me->orient);
+
+	const fusion_sample* last = samples + count - 1;
+	ovec3f_subtract(&last->ang_vel, &me->gyro_bias, &me->ang_vel);
+	me->accel = last->accel;
+	me->mag = last->mag;
+}
+
+const fusion_engine ofusion_eskf = {
+	"eskf",
+	true,
+	eskf_reset,
+	eskf_update
+};
@@ -0,0 +1,431 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Sensor Fusion - Fixed-Point Complementary Filter */
+
+/*
+ * The complementary filter of fusion.c in integer arithmetic, for CPUs without an FPU where every float operation
+ * is a library call. Quaternions and unit vectors are Q30, angles Q29 radians, angular velocities Q20 rad/s and
+ * accelerations Q16 m/s^2. Products are formed in 64 bits and rounded back, sin, cos and atan come from quarter
+ * wave tables with linear interpolation and the only square roots are integer ones.
+ *
+ * Floats are left at the edges: the samples are converted on the way in, and orient and the gravity error are
+ * converted back once per batch, so getf and ofusion_get_state see the usual values. The world space accelerometer
+ * mean is an exponential average instead of the window of accel_stats.
+ */
+
+#include <string.h>
+#include "openhmdi.h"
+
+#define Q30_ONE (1 << 30)
+#define Q29_PI 1686629713
+#define Q29_HALF_PI 843314857
+
+#define TABLE_BITS 8
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define SIN_SCALE 10680707  // table entries per radian, Q16
+
+#define MEAN_SHIFT 4             // the accelerometer mean moves 1/16 towards every sample
+#define MIN_ANG_VEL 105          // 0.0001 rad/s, below it the gyro is not integrated
+#define MIN_TILT_ERROR 26843546  // 0.05 rad
+#define MAX_TILT_ERROR 5368709   // 0.01 rad
+
+// sin(i pi / 512), Q30
+static const int32_t sin_table[TABLE_SIZE + 1] = {
+	0, 6588356, 13176464, 19764076, 26350943, 32936819,
+	39521455, 46104602, 52686014, 59265442, 65842639, 72417357,
+	78989349, 85558366, 92124163, 98686491, 105245103, 111799753,
+	118350194, 124896179, 131437462, 137973796, 144504935, 151030634,
+	157550647, 164064728, 170572633, 177074115, 183568930, 190056834,
+	196537583, 203010932, 209476638, 215934457, 222384147, 228825464,
+	235258165, 241682010, 248096755, 254502159, 260897982, 267283981,
+	273659918, 280025552, 286380643, 292724951, 299058239, 305380268,
+	311690799, 317989595, 324276419, 330551034, 336813204, 343062693,
+	349299266, 355522689, 361732726, 367929144, 374111709, 380280190,
+	386434353, 392573967, 398698801, 404808624, 410903207, 416982319,
+	423045732, 429093217, 435124548, 441139496, 447137835, 453119340,
+	459083786, 465030947, 470960600, 476872522, 482766489, 488642281,
+	494499676, 500338453, 506158392, 511959275, 517740883, 523502998,
+	529245404, 534967884, 540670223, 546352205, 552013618, 557654248,
+	563273883, 568872310, 574449320, 580004702, 585538248, 591049748,
+	596538995, 602005783, 607449906, 612871159, 618269338, 623644239,
+	628995660, 634323400, 639627258, 644907034, 650162530, 655393548,
+	660599890, 665781362, 670937767, 676068911, 681174602, 686254647,
+	691308855, 696337036, 701339000, 706314559, 711263525, 716185713,
+	721080937, 725949013, 730789757, 735602987, 740388522, 745146182,
+	749875788, 754577161, 759250125, 763894504, 768510122, 773096806,
+	777654384, 782182683, 786681534, 791150767, 795590213, 799999706,
+	804379079, 808728167, 813046808, 817334838, 821592095, 825818421,
+	830013654, 834177638, 838310216, 842411232, 846480531, 850517961,
+	854523370, 858496606, 862437520, 866345964, 870221790, 874064853,
+	877875009, 881652112, 885396022, 889106597, 892783698, 896427186,
+	900036924, 903612776, 907154608, 910662286, 914135678, 917574653,
+	920979082, 924348837, 927683790, 930983817, 934248793, 937478595,
+	940673101, 943832191, 946955747, 950043650, 953095785, 956112036,
+	959092290, 962036435, 964944360, 967815955, 970651112, 973449725,
+	976211688, 978936898, 981625251, 984276646, 986890984, 989468165,
+	992008094, 994510675, 996975812, 999403415, 1001793390, 1004145648,
+	1006460100, 1008736660, 1010975242, 1013175761, 1015338134, 1017462281,
+	1019548121, 1021595575, 1023604567, 1025575020, 1027506862, 1029400018,
+	1031254418, 1033069992, 1034846671, 1036584389, 1038283080, 1039942680,
+	1041563127, 1043144360, 1044686319, 1046188946, 1047652185, 1049075980,
+	1050460278, 1051805027, 1053110176, 1054375676, 1055601479, 1056787540,
+	1057933813, 1059040255, 1060106826, 1061133483, 1062120190, 1063066909,
+	1063973603, 1064840240, 1065666786, 1066453210, 1067199483, 1067905576,
+	1068571464, 1069197120, 1069782521, 1070327646, 1070832474, 1071296985,
+	1071721163, 1072104991, 1072448455, 1072751542, 1073014240, 1073236540,
+	1073418433, 1073559913, 1073660973, 1073721611, 1073741824
+};
+
+// atan(i / 256), Q29
+static const int32_t atan_table[TABLE_SIZE + 1] = {
+	0, 2097141, 4194219, 6291168, 8387925, 10484427,
+	12580609, 14676407, 16771758, 18866598, 20960863, 23054490,
+	25147416, 27239578, 29330911, 31421354, 33510843, 35599317,
+	37686712, 39772966, 41858018, 43941805, 46024266, 48105340,
+	50184965, 52263081, 54339626, 56414542, 58487768, 60559244,
+	62628910, 64696708, 66762579, 68826465, 70888307, 72948048,
+	75005631, 77060998, 79114093, 81164859, 83213242, 85259186,
+	87302634, 89343535, 91381832, 93417472, 95450402, 97480570,
+	99507923, 101532409, 103553977, 105572575, 107588154, 109600664,
+	111610055, 113616278, 115619285, 117619027, 119615459, 121608532,
+	123598200, 125584418, 127567140, 129546321, 131521918, 133493887,
+	135462185, 137426768, 139387596, 141344627, 143297819, 145247133,
+	147192530, 149133969, 151071412, 153004822, 154934160, 156859391,
+	158780477, 160697384, 162610076, 164518518, 166422677, 168322519,
+	170218011, 172109122, 173995820, 175878074, 177755853, 179629127,
+	181497868, 183362046, 185221634, 187076603, 188926928, 190772581,
+	192613537, 194449771, 196281257, 198107973, 199929894, 201746997,
+	203559260, 205366662, 207169181, 208966795, 210759486, 212547234,
+	214330019, 216107822, 217880627, 219648415, 221411170, 223168875,
+	224921514, 226669072, 228411535, 230148887, 231881116, 233608207,
+	235330149, 237046928, 238758533, 240464953, 242166178, 243862195,
+	245552997, 247238573, 248918915, 250594014, 252263862, 253928451,
+	255587776, 257241828, 258890602, 260534092, 262172294, 263805201,
+	265432810, 267055116, 268672116, 270283807, 271890185, 273491249,
+	275086997, 276677426, 278262536, 279842326, 281416795, 282985944,
+	284549771, 286108279, 287661468, 289209339, 290751894, 292289135,
+	293821065, 295347685, 296869000, 298385011, 299895724, 301401141,
+	302901268, 304396108, 305885667, 307369949, 308848960, 310322706,
+	311791193, 313254427, 314712414, 316165161, 317612676, 319054965,
+	320492037, 321923898, 323350557, 324772022, 326188302, 327599405,
+	329005341, 330406118, 331801746, 333192234, 334577593, 335957831,
+	337332960, 338702990, 340067931, 341427795, 342782591, 344132331,
+	345477027, 346816690, 348151331, 349480962, 350805596, 352125243,
+	353439918, 354749631, 356054396, 357354224, 358649130, 359939125,
+	361224223, 362504438, 363779782, 365050268, 366315911, 367576724,
+	368832721, 370083915, 371330321, 372571953, 373808825, 375040951,
+	376268345, 377491022, 378708997, 379922284, 381130898, 382334853,
+	383534165, 384728848, 385918917, 387104388, 388285275, 389461594,
+	390633360, 391800588, 392963293, 394121491, 395275197, 396424428,
+	397569197, 398709522, 399845417, 400976898, 402103981, 403226681,
+	404345015, 405458998, 406568646, 407673974, 408774999, 409871737,
+	410964203, 412052413, 413136383, 414216130, 415291668, 416363015,
+	417430186, 418493196, 419552063, 420606802, 421657428
+};
+
+static inline int32_t mul_q(int32_t a, int32_t b, int shift)
+{
+	return (int32_t)(((int64_t)a * b + ((int64_t)1 << (shift - 1))) >> shift);
+}
+
+static inline int32_t to_fixed(float v, int frac)
+{
+	float scaled = v * (float)(1 << frac);
+
+	if(scaled >= 2147483520.0f)
+		return INT32_MAX;
+	if(scaled <= -2147483520.0f)
+		return -INT32_MAX;
+
+	return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+static inline float to_float(int32_t v, int frac)
+{
+	return (float)v * (1.0f / (float)(1 << frac));
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+	uint64_t res = 0, bit = (uint64_t)1 << 62;
+
+	while(bit > v)
+		bit >>= 2;
+
+	while(bit){
+		if(v >= res + bit){
+			v -= res + bit;
+			res = (res >> 1) + bit;
+		}else{
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (uint32_t)res;
+}
+
+static inline int32_t table_lookup(const int32_t* table, int64_t pos)
+{
+	int idx = (int)(pos >> 16);
+	if(idx >= TABLE_SIZE)
+		return table[TABLE_SIZE];
+
+	return table[idx] + (int32_t)(((int64_t)(table[idx + 1] - table[idx]) * (pos & 0xffff)) >> 16);
+}
+
+// sin of a Q29 angle in [-pi, pi], Q30
+static int32_t fixed_sin(int32_t x)
+{
+	bool negative = x < 0;
+	if(negative)
+		x = -x;
+	if(x > Q29_PI)
+		x = Q29_PI;
+	if(x > Q29_HALF_PI)
+		x = Q29_PI - x;
+
+	int32_t v = table_lookup(sin_table, ((int64_t)x * SIN_SCALE) >> 29);
+	return negative ? -v : v;
+}
+
+static int32_t fixed_cos(int32_t x)
+{
+	return fixed_sin(Q29_HALF_PI - (x < 0 ? -x : x));
+}
+
+// the angle of (x, y) to the x axis for y >= 0, Q29 in [0, pi]
+static int32_t fixed_atan2(int32_t y, int32_t x)
+{
+	int32_t ax = x < 0 ? -x : x;
+	int32_t angle;
+
+	if(y == 0 && ax == 0)
+		return 0;
+
+	if(y <= ax)
+		angle = table_lookup(atan_table, (((int64_t)y << 30) / ax) >> (30 - TABLE_BITS - 16));
+	else
+		angle = Q29_HALF_PI - table_lookup(atan_table, (((int64_t)ax << 30) / y) >> (30 - TABLE_BITS - 16));
+
+	return x < 0 ? Q29_PI - angle : angle;
+}
+
+// out = a * b, x y z w
+static void quat_mult(const int32_t* a, const int32_t* b, int32_t* out)
+{
+	const int64_t half = (int64_t)1 << 29;
+	int64_t x = (int64_t)a[3] * b[0] + (int64_t)a[0] * b[3] + (int64_t)a[1] * b[2] - (int64_t)a[2] * b[1];
+	int64_t y = (int64_t)a[3] * b[1] - (int64_t)a[0] * b[2] + (int64_t)a[1] * b[3] + (int64_t)a[2] * b[0];
+	int64_t z = (int64_t)a[3] * b[2] + (int64_t)a[0] * b[1] - (int64_t)a[1] * b[0] + (int64_t)a[2] * b[3];
+	int64_t w = (int64_t)a[3] * b[3] - (int64_t)a[0] * b[0] - (int64_t)a[1] * b[1] - (int64_t)a[2] * b[2];
+
+	out[0] = (int32_t)((x + half) >> 30);
+	out[1] = (int32_t)((y + half) >> 30);
+	out[2] = (int32_t)((z + half) >> 30);
+	out[3] = (int32_t)((w + half) >> 30);
+}
+
+// v rotated by q, v' = v + w t + q x t with t = 2 q x v, in the format of v
+static void quat_rotate(const int32_t* q, const int32_t* v, int32_t* out)
+{
+	int32_t t[3] = {
+		mul_q(q[1], v[2], 29) - mul_q(q[2], v[1], 29),
+		mul_q(q[2], v[0], 29) - mul_q(q[0], v[2], 29),
+		mul_q(q[0], v[1], 29) - mul_q(q[1], v[0], 29)
+	};
+
+	out[0] = v[0] + mul_q(q[3], t[0], 30) + mul_q(q[1], t[2], 30) - mul_q(q[2], t[1], 30);
+	out[1] = v[1] + mul_q(q[3], t[1], 30) + mul_q(q[2], t[0], 30) - mul_q(q[0], t[2], 30);
+	out[2] = v[2] + mul_q(q[3], t[2], 30) + mul_q(q[0], t[1], 30) - mul_q(q[1], t[0], 30);
+}
+
+// one Newton step of 1 / sqrt around 1, the drift of a batch is far below where that stops being enough
+static void quat_normalize(int32_t* q)
+{
+	int64_t sq = 0;
+	for(int i = 0; i < 4; i++)
+		sq += (int64_t)q[i] * q[i];
+
+	int32_t inv = (int32_t)((3 * (int64_t)Q30_ONE - (sq >> 30)) >> 1);
+	for(int i = 0; i < 4; i++)
+		q[i] = mul_q(q[i], inv, 30);
+}
+
+// the rotation by angle about the world space axis of the gravity error, multiplied from the left
+static void apply_gravity_correction(fusion_fixed_state* st, int32_t angle)
+{
+	if(angle == 0)
+		return;
+
+	int32_t sn = fixed_sin(angle / 2), corr[4], old[4];
+	for(int i = 0; i < 3; i++)
+		corr[i] = mul_q(st->grav_error_axis[i], sn, 30);
+	corr[3] = fixed_cos(angle / 2);
+
+	memcpy(old, st->orient, sizeof(old));
+	quat_mult(corr, old, st->orient);
+}
+
+static void fixed_reset(fusion* me)
+{
+	fusion_fixed_state* st = &me->state.fixed;
+	quatf orient = me->orient;
+	oquatf_normalize_me(&orient);
+
+	for(int i = 0; i < 4; i++)
+		st->orient[i] = to_fixed(orient.arr[i], 30);
+	for(int i = 0; i < 3; i++)
+		st->grav_error_axis[i] = to_fixed(me->grav_error_axis.arr[i], 30);
+	st->grav_error_angle = to_fixed(me->grav_error_angle, 29);
+
+	st->accel_mean_valid = false;
+}
+
+static void fixed_update(fusion* me, const fusion_sample* samples, int count)
+{
+	fusion_fixed_state* st = &me->state.fixed;
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+
+	// the float parameters are converted once per batch
+	const int32_t bias[3] = {
+		to_fixed(me->gyro_bias.x, 20), to_fixed(me->gyro_bias.y, 20), to_fixed(me->gyro_bias.z, 20)
+	};
+	const int32_t gain = to_fixed(me->params.grav_gain * 0.005f, 30);
+	const uint32_t ang_vel_tolerance = (uint32_t)to_fixed(me->params.ang_vel_tolerance, 20);
+	const int32_t gravity_tolerance = to_fixed(me->params.gravity_tolerance, 16);
+	const int32_t gravity = to_fixed(9.82f, 16);
+	const int64_t level_min = OHMD_MAX(gravity - 2 * gravity_tolerance, 0);
+	const int64_t level_max = gravity + 2 * gravity_tolerance;
+
+	int32_t corr_angle = 0;
+	int64_t time = 0; // Q30 s
+
+	for(int i = 0; i < count; i++){
+		const fusion_sample* s = samples + i;
+		int32_t ang_vel[3], accel[3], world_accel[3];
+		uint64_t ang_vel_sq = 0, accel_sq = 0;
+
+		for(int k = 0; k < 3; k++){
+			ang_vel[k] = to_fixed(s->ang_vel.arr[k], 20) - bias[k];
+			accel[k] = to_fixed(s->accel.arr[k], 16);
+			ang_vel_sq += (uint64_t)((int64_t)ang_vel[k] * ang_vel[k]);
+			accel_sq += (uint64_t)((int64_t)accel[k] * accel[k]);
+		}
+		const int32_t dt = to_fixed(s->dt, 30);
+
+		quat_rotate(st->orient, accel, world_accel);
+
+		if(!st->accel_mean_valid){
+			memcpy(st->accel_mean, world_accel, sizeof(world_accel));
+			st->accel_mean_valid = true;
+		}else{
+			for(int k = 0; k < 3; k++)
+				st->accel_mean[k] += (world_accel[k] - st->accel_mean[k]) >> MEAN_SHIFT;
+		}
+
+		uint32_t ang_vel_length = isqrt64(ang_vel_sq);
+
+		if(ang_vel_length > MIN_ANG_VEL){
+			// half the rotation angle, Q20 * Q30 -> Q29 and halved
+			int64_t half_angle = OHMD_MIN(((int64_t)ang_vel_length * dt) >> 22, (int64_t)Q29_PI);
+			int32_t sn = fixed_sin((int32_t)half_angle), delta[4], old[4];
+
+			// the axis is ang_vel / |ang_vel|, scaled by the sine in one go
+			int64_t scale = ((int64_t)sn << 20) / ang_vel_length;
+			for(int k = 0; k < 3; k++)
+				delta[k] = (int32_t)((ang_vel[k] * scale + ((int64_t)1 << 19)) >> 20);
+			delta[3] = fixed_cos((int32_t)half_angle);
+
+			memcpy(old, st->orient, sizeof(old));
+			quat_mult(old, delta, st->orient);
+		}
+
+		me->iterations += 1;
+		time += dt;
+
+		if(!use_gravity)
+			continue;
+
+		// level within tolerance, compared squared to save the square root
+		me->device_level_count =
+			accel_sq > (uint64_t)(level_min * level_min) && accel_sq < (uint64_t)(level_max * level_max) &&
+			ang_vel_length < ang_vel_tolerance ? me->device_level_count + 1 : 0;
+
+		if(me->device_level_count > me->params.level_samples){
+			me->device_level_count = 0;
+
+			const int32_t* mean = st->accel_mean;
+			uint64_t mean_sq = 0;
+			for(int k = 0; k < 3; k++)
+				mean_sq += (uint64_t)((int64_t)mean[k] * mean[k]);
+
+			uint32_t horizontal = isqrt64((uint64_t)((int64_t)mean[0] * mean[0] + (int64_t)mean[2] * mean[2]));
+
+			if((int64_t)isqrt64(mean_sq) - gravity < gravity_tolerance && horizontal > 0){
+				// up x mean, the axis that tilts up onto the measured gravity
+				int32_t tilt[3] = {
+					(int32_t)(((int64_t)mean[2] << 30) / horizontal), 0, (int32_t)(-((int64_t)mean[0] << 30) / horizontal)
+				};
+				int32_t tilt_angle = fixed_atan2((int32_t)horizontal, mean[1]);
+
+				if(tilt_angle > MAX_TILT_ERROR){
+					// the correction gathered so far is around the old axis
+					apply_gravity_correction(st, corr_angle);
+					corr_angle = 0;
+
+					st->grav_error_angle = tilt_angle;
+					memcpy(st->grav_error_axis, tilt, sizeof(tilt));
+				}
+			}
+		}
+
+		// perform gravity tilt correction
+		if(st->grav_error_angle > MIN_TILT_ERROR){
+			int32_t use_angle;
+
+			// if less than 2000 iterations have passed, set the up axis to the correction value outright
+			if(me->iterations < 2000){
+				use_angle = -st->grav_error_angle;
+				st->grav_error_angle = 0;
+			}
+
+			// otherwise gain * angle * (5 |ang_vel| + 1)
+			else {
+				int64_t factor = 5 * (int64_t)ang_vel_length + (1 << 20);
+				use_angle = -(int32_t)(((int64_t)mul_q(gain, st->grav_error_angle, 30) * factor) >> 20);
+				st->grav_error_angle += use_angle;
+			}
+
+			corr_angle += use_angle;
+		}
+	}
+
+	apply_gravity_correction(st, corr_angle);
+	quat_normalize(st->orient);
+
+	// the float state the rest of the library reads
+	for(int k = 0; k < 4; k++)
+		me->orient.arr[k] = to_float(st->orient[k], 30);
+	for(int k = 0; k < 3; k++)
+		me->grav_error_axis.arr[k] = to_float(st->grav_error_axis[k], 30);
+	me->grav_error_angle = to_float(st->grav_error_angle, 29);
+	me->time += (float)time * (1.0f / (float)Q30_ONE);
+
+	const fusion_sample* last = samples + count - 1;
+	ovec3f_subtract(&last->ang_vel, &me->gyro_bias, &me->ang_vel);
+	me->accel = last->accel;
+	me->mag = last->mag;
+}
+
+const fusion_engine ofusion_fixed = {
+	"fixed",
+	false,
+	fixed_reset,
+	fixed_update
+};
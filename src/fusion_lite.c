@@ -0,0 +1,167 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Sensor Fusion - Mahony and Madgwick Filters */
+
+/*
+ * Two cheap filters for boards where fusion shows up in the profile. Both integrate the gyro to first order,
+ * orient += 0.5 dt orient * w, which needs no sin, cos or acos, and pull the orientation towards the measured
+ * direction of gravity a little on every sample instead of averaging a window of samples. Apart from the gating
+ * of the accelerometer the only square roots are the ones normalizing vectors.
+ *
+ * Mahony feeds the cross product between the measured and the predicted gravity direction back into the angular
+ * velocity, its integral term is the gyro bias. Madgwick takes a normalized gradient descent step on the same
+ * error and leaves the bias alone.
+ */
+
+#include <math.h>
+#include "openhmdi.h"
+
+#define MADGWICK_BETA 0.05f // gradient step, rad/s
+
+// orient += 0.5 dt orient * (w, 0) + step
+static inline void integrate(quatf* q, const vec3f* w, float dt, const quatf* step)
+{
+	const float h = 0.5f * dt;
+	const float x = q->x, y = q->y, z = q->z, qw = q->w;
+
+	q->x += h * (qw * w->x + y * w->z - z * w->y) + step->x;
+	q->y += h * (qw * w->y + z * w->x - x * w->z) + step->y;
+	q->z += h * (qw * w->z + x * w->y - y * w->x) + step->z;
+	q->w -= h * (x * w->x + y * w->y + z * w->z) - step->w;
+}
+
+// the accelerometer sample as a unit vector, false while the device is accelerating
+static inline bool gravity_direction(const vec3f* accel, vec3f* out)
+{
+	float norm_sq = accel->x * accel->x + accel->y * accel->y + accel->z * accel->z;
+	if(norm_sq < (FUSION_GRAVITY - FUSION_ACCEL_GATE) * (FUSION_GRAVITY - FUSION_ACCEL_GATE) ||
+	   norm_sq > (FUSION_GRAVITY + FUSION_ACCEL_GATE) * (FUSION_GRAVITY + FUSION_ACCEL_GATE))
+		return false;
+
+	float inv_norm = 1.0f / sqrtf(norm_sq);
+	out->x = accel->x * inv_norm;
+	out->y = accel->y * inv_norm;
+	out->z = accel->z * inv_norm;
+
+	return true;
+}
+
+static void finish_batch(fusion* me, const fusion_sample* samples, int count)
+{
+	// first order integration lets the length creep, normalizing once per batch is plenty
+	oquatf_normalize_me(&me->orient);
+
+	const fusion_sample* last = samples + count - 1;
+	ovec3f_subtract(&last->ang_vel, &me->gyro_bias, &me->ang_vel);
+	me->accel = last->accel;
+	me->mag = last->mag;
+}
+
+static void mahony_update(fusion* me, const fusion_sample* samples, int count)
+{
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+	const quatf no_step = {{ 0, 0, 0, 0 }};
+	quatf* q = &me->orient;
+
+	for(int i = 0; i < count; i++){
+		const fusion_sample* s = samples + i;
+		const bool settling = me->time < FUSION_SETTLE_TIME;
+		const float kp = settling ? FUSION_MAHONY_KP * FUSION_SETTLE_GAIN : FUSION_MAHONY_KP;
+		const float ki = settling ? 0 : FUSION_MAHONY_KI;
+		vec3f w, a;
+
+		ovec3f_subtract(&s->ang_vel, &me->gyro_bias, &w);
+
+		if(use_gravity && gravity_direction(&s->accel, &a)){
+			// predicted gravity direction in the body frame, the second row of the rotation matrix
+			float vx = 2.0f * (q->x * q->y + q->w * q->z);
+			float vy = 1.0f - 2.0f * (q->x * q->x + q->z * q->z);
+			float vz = 2.0f * (q->y * q->z - q->w * q->x);
+
+			// error = a x v
+			float ex = a.y * vz - a.z * vy;
+			float ey = a.z * vx - a.x * vz;
+			float ez = a.x * vy - a.y * vx;
+
+			me->gyro_bias.x -= ki * ex * s->dt;
+			me->gyro_bias.y -= ki * ey * s->dt;
+			me->gyro_bias.z -= ki * ez * s->dt;
+
+			w.x += kp * ex;
+			w.y += kp * ey;
+			w.z += kp * ez;
+		}
+
+		integrate(q, &w, s->dt, &no_step);
+
+		me->iterations += 1;
+		me->time += s->dt;
+	}
+
+	finish_batch(me, samples, count);
+}
+
+static void madgwick_update(fusion* me, const fusion_sample* samples, int count)
+{
+	const bool use_gravity = (me->flags & FF_USE_GRAVITY) != 0;
+	quatf* q = &me->orient;
+
+	for(int i = 0; i < count; i++){
+		const fusion_sample* s = samples + i;
+		quatf step = {{ 0, 0, 0, 0 }};
+		vec3f w, a;
+
+		ovec3f_subtract(&s->ang_vel, &me->gyro_bias, &w);
+
+		if(use_gravity && gravity_direction(&s->accel, &a)){
+			const float x = q->x, y = q->y, z = q->z, qw = q->w;
+
+			// f = v(q) - a, v as in mahony_update
+			float f0 = 2.0f * (x * y + qw * z) - a.x;
+			float f1 = 1.0f - 2.0f * (x * x + z * z) - a.y;
+			float f2 = 2.0f * (y * z - qw * x) - a.z;
+
+			// gradient J^T f
+			step.x = 2.0f * y * f0 - 4.0f * x * f1 - 2.0f * qw * f2;
+			step.y = 2.0f * x * f0 + 2.0f * z * f2;
+			step.z = 2.0f * qw * f0 - 4.0f * z * f1 + 2.0f * y * f2;
+			step.w = 2.0f * z * f0 - 2.0f * x * f2;
+
+			float norm_sq = step.x * step.x + step.y * step.y + step.z * step.z + step.w * step.w;
+			if(norm_sq > 1e-12f){
+				float beta = me->time < FUSION_SETTLE_TIME ? MADGWICK_BETA * FUSION_SETTLE_GAIN : MADGWICK_BETA;
+				float scale = -beta * s->dt / sqrtf(norm_sq);
+				step.x *= scale;
+				step.y *= scale;
+				step.z *= scale;
+				step.w *= scale;
+			}
+		}
+
+		integrate(q, &w, s->dt, &step);
+
+		me->iterations += 1;
+		me->time += s->dt;
+	}
+
+	finish_batch(me, samples, count);
+}
+
+const fusion_engine ofusion_mahony = {
+	"mahony",
+	true,
+	NULL,
+	mahony_update
+};
+
+const fusion_engine ofusion_madgwick = {
+	"madgwick",
+	false,
+	NULL,
+	madgwick_update
+};
@@ -23,4 +23,16 @@ static inline char* _hid_to_unix_path(char* path)
 	return result;
 }
 
+// copies the serial number of a hid_device_info, NULL or empty if unknown, non-ASCII characters become '?'
+static inline void _hid_copy_serial(char* out, const wchar_t* serial)
+{
+	int i = 0;
+
+	if(serial)
+		for(; serial[i] && i < OHMD_STR_SIZE - 1; i++)
+			out[i] = serial[i] > 0 && serial[i] < 0x7f ? (char)serial[i] : '?';
+
+	out[i] = '\0';
+}
+
 #endif
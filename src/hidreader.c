@@ -0,0 +1,88 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* HID Reader Thread Implementation */
+
+
+#include "hidreader.h"
+
+#define READ_TIMEOUT_MS 50 // how long destroy may wait for the thread to notice
+
+struct ohmd_hid_reader {
+	ohmd_context* ctx;
+	ohmd_thread* thread;
+	ohmd_hid_read_fn read;
+	void* handle;
+
+	bool request_quit;
+	uint32_t failed; // set by the thread when reading failed, it stops reading after that
+
+	ohmd_hid_ring ring;
+};
+
+static unsigned int reader_thread(void* arg)
+{
+	ohmd_hid_reader* reader = (ohmd_hid_reader*)arg;
+	unsigned char buffer[OHMD_HID_REPORT_SIZE];
+
+	while(!reader->request_quit){
+		int size = reader->read(reader->handle, buffer, sizeof(buffer), READ_TIMEOUT_MS);
+		if(size < 0){
+			HID_RING_STORE_RELEASE(&reader->failed, 1);
+			break;
+		}
+
+		if(size > 0)
+			ohmd_hid_ring_push(&reader->ring, ohmd_monotonic_get(reader->ctx), buffer, size);
+	}
+
+	return 0;
+}
+
+ohmd_hid_reader* ohmd_hid_reader_create(ohmd_context* ctx, ohmd_hid_read_fn read, void* handle)
+{
+	ohmd_hid_reader* reader = ohmd_alloc(ctx, sizeof(ohmd_hid_reader));
+	if(!reader)
+		return NULL;
+
+	reader->ctx = ctx;
+	reader->read = read;
+	reader->handle = handle;
+
+	reader->thread = ohmd_create_thread(ctx, reader_thread, reader);
+	if(!reader->thread){
+		ohmd_set_error(ctx, "could not create the reader thread");
+		free(reader);
+		return NULL;
+	}
+
+	return reader;
+}
+
+void ohmd_hid_reader_destroy(ohmd_hid_reader* reader)
+{
+	reader->request_quit = true;
+	ohmd_destroy_thread(reader->thread);
+	free(reader);
+}
+
+int ohmd_hid_reader_read(ohmd_hid_reader* reader, unsigned char* data, int size, uint64_t* timestamp)
+{
+	// the flag is set after the last push, so the reports read before the failure are still handed out
+	uint32_t failed = HID_RING_LOAD_ACQUIRE(&reader->failed);
+	int n = ohmd_hid_ring_pop(&reader->ring, data, size, timestamp);
+
+	if(n == 0 && failed)
+		return -1;
+
+	return n;
+}
+
+uint32_t ohmd_hid_reader_dropped(ohmd_hid_reader* reader)
+{
+	return HID_RING_LOAD_ACQUIRE(&reader->ring.dropped);
+}
@@ -0,0 +1,103 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* HID Reader Thread - Internal Interface */
+
+/*
+ * Splits a driver's update into two stages, see OHMD_IDS_READER_THREAD. A reader thread does nothing but drain the
+ * device and stamp each report with the time it was read, the update thread pops the reports and decodes and fuses
+ * them. The kernel only buffers a handful of reports, so a read stage that never waits for fusion is what keeps them
+ * from being dropped when the update thread is preempted.
+ */
+
+#ifndef HIDREADER_H
+#define HIDREADER_H
+
+#include <string.h>
+#include "openhmdi.h"
+
+#define OHMD_HID_REPORT_SIZE 64
+#define OHMD_HID_RING_SIZE 256 // reports, a power of two
+
+typedef struct {
+	uint64_t timestamp; // ohmd_monotonic_get() right after the report was read
+	int size;
+	unsigned char data[OHMD_HID_REPORT_SIZE];
+} ohmd_hid_report;
+
+// single producer, single consumer, the indices are free running and on their own cache lines
+typedef struct {
+	uint32_t write_index; // only written by the reader
+	uint32_t dropped;     // reports thrown away because the ring was full, only written by the reader
+	char pad0[56];
+	uint32_t read_index;  // only written by the consumer
+	char pad1[60];
+	ohmd_hid_report reports[OHMD_HID_RING_SIZE];
+} ohmd_hid_ring;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HID_RING_LOAD_ACQUIRE(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define HID_RING_STORE_RELEASE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire and release semantics
+#define HID_RING_LOAD_ACQUIRE(_p) (*(volatile uint32_t*)(_p))
+#define HID_RING_STORE_RELEASE(_p, _v) (*(volatile uint32_t*)(_p) = (_v))
+#endif
+
+// producer side, returns false and counts the report as dropped if the ring is full
+static inline bool ohmd_hid_ring_push(ohmd_hid_ring* ring, uint64_t timestamp, const unsigned char* data, int size)
+{
+	uint32_t write = ring->write_index;
+
+	if(write - HID_RING_LOAD_ACQUIRE(&ring->read_index) >= OHMD_HID_RING_SIZE){
+		HID_RING_STORE_RELEASE(&ring->dropped, ring->dropped + 1);
+		return false;
+	}
+
+	ohmd_hid_report* report = &ring->reports[write & (OHMD_HID_RING_SIZE - 1)];
+	report->timestamp = timestamp;
+	report->size = size < OHMD_HID_REPORT_SIZE ? size : OHMD_HID_REPORT_SIZE;
+	memcpy(report->data, data, report->size);
+
+	HID_RING_STORE_RELEASE(&ring->write_index, write + 1);
+	return true;
+}
+
+// consumer side, returns the size of the report copied to data, 0 if the ring is empty
+static inline int ohmd_hid_ring_pop(ohmd_hid_ring* ring, unsigned char* data, int size, uint64_t* timestamp)
+{
+	uint32_t read = ring->read_index;
+
+	if(read == HID_RING_LOAD_ACQUIRE(&ring->write_index))
+		return 0;
+
+	const ohmd_hid_report* report = &ring->reports[read & (OHMD_HID_RING_SIZE - 1)];
+	int n = report->size < size ? report->size : size;
+	memcpy(data, report->data, n);
+	if(timestamp)
+		*timestamp = report->timestamp;
+
+	HID_RING_STORE_RELEASE(&ring->read_index, read + 1);
+	return n;
+}
+
+// the read function of the device, hid_read_timeout() behind a cast for hidapi devices
+typedef int (*ohmd_hid_read_fn)(void* handle, unsigned char* data, int size, int timeout_ms);
+
+typedef struct ohmd_hid_reader ohmd_hid_reader;
+
+// starts reading the device on its own thread, NULL if the thread could not be created
+ohmd_hid_reader* ohmd_hid_reader_create(ohmd_context* ctx, ohmd_hid_read_fn read, void* handle);
+// stops the thread, must be called before the device is closed
+void ohmd_hid_reader_destroy(ohmd_hid_reader* reader);
+
+// same contract as hid_read(), the report size, 0 if none is waiting or -1 once reading the device failed
+int ohmd_hid_reader_read(ohmd_hid_reader* reader, unsigned char* data, int size, uint64_t* timestamp);
+// total reports dropped since the reader was created
+uint32_t ohmd_hid_reader_dropped(ohmd_hid_reader* reader);
+
+#endif
@@ -0,0 +1,190 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Shared Memory IMU Sample Ring Implementation */
+
+
+#include <string.h>
+#include "openhmdi.h"
+#include "imuring.h"
+
+#define OHMD_IMU_RING_NAME_SIZE 256
+
+struct ohmd_imu_ring {
+	ohmd_imu_ring_shm* shm;
+	size_t size;
+	uint32_t mask;
+	bool owner;
+	char name[OHMD_IMU_RING_NAME_SIZE];
+};
+
+// by width, the indices are 64 bits and the magic 32
+#if defined(__GNUC__) || defined(__clang__)
+#define RING_LOAD_ACQUIRE_64(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE_64(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#define RING_LOAD_ACQUIRE_32(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE_32(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire and release semantics
+#define RING_LOAD_ACQUIRE_64(_p) (*(volatile uint64_t*)(_p))
+#define RING_STORE_RELEASE_64(_p, _v) (*(volatile uint64_t*)(_p) = (_v))
+#define RING_LOAD_ACQUIRE_32(_p) (*(volatile uint32_t*)(_p))
+#define RING_STORE_RELEASE_32(_p, _v) (*(volatile uint32_t*)(_p) = (_v))
+#endif
+
+// true if name is a ring whose producer has exited, or a region that never became a ring
+static bool ring_abandoned(const char* name)
+{
+	size_t size = 0;
+	ohmd_imu_ring_shm* shm = ohmd_shm_map(name, &size, false);
+	if(!shm)
+		return false;
+
+	bool abandoned = size < sizeof(ohmd_imu_ring_shm) || RING_LOAD_ACQUIRE_32(&shm->magic) != OHMD_IMU_RING_MAGIC ||
+	                 !ohmd_process_alive(shm->producer_pid);
+
+	ohmd_shm_unmap(shm, size);
+	return abandoned;
+}
+
+OHMD_APIENTRYDLL ohmd_imu_ring* OHMD_APIENTRY ohmd_imu_ring_create(const char* name, int capacity)
+{
+	if(!name || strlen(name) >= OHMD_IMU_RING_NAME_SIZE || capacity < 2 || (capacity & (capacity - 1)) != 0)
+		return NULL;
+
+	ohmd_imu_ring* ring = calloc(1, sizeof(ohmd_imu_ring));
+	if(!ring)
+		return NULL;
+
+	ring->size = sizeof(ohmd_imu_ring_shm) + (size_t)capacity * sizeof(ohmd_imu_sample);
+	ring->shm = ohmd_shm_map(name, &ring->size, true);
+	if(!ring->shm && ring_abandoned(name)){
+		// a consumer still attached to the old ring keeps its memory and just sees no new samples
+		ohmd_shm_unlink(name);
+		ring->shm = ohmd_shm_map(name, &ring->size, true);
+	}
+
+	if(!ring->shm){
+		free(ring);
+		return NULL;
+	}
+
+	ring->mask = capacity - 1;
+	ring->owner = true;
+	strcpy(ring->name, name);
+
+	ring->shm->capacity = capacity;
+	ring->shm->sample_size = sizeof(ohmd_imu_sample);
+	ring->shm->version = OHMD_IMU_RING_VERSION;
+	ring->shm->producer_pid = ohmd_process_id();
+	ring->shm->write_index = 0;
+	ring->shm->read_index = 0;
+
+	// consumers check the magic before anything else
+	RING_STORE_RELEASE_32(&ring->shm->magic, OHMD_IMU_RING_MAGIC);
+
+	return ring;
+}
+
+OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_imu_ring_destroy(ohmd_imu_ring* ring)
+{
+	ohmd_shm_unmap(ring->shm, ring->size);
+	if(ring->owner)
+		ohmd_shm_unlink(ring->name);
+	free(ring);
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_imu_ring_push(ohmd_imu_ring* ring, const ohmd_imu_sample* samples, int count)
+{
+	if(!samples || count < 0)
+		return OHMD_S_INVALID_PARAMETER;
+
+	ohmd_imu_ring_shm* shm = ring->shm;
+	uint64_t write = shm->write_index;
+	uint64_t read = RING_LOAD_ACQUIRE_64(&shm->read_index);
+
+	uint64_t space = shm->capacity - (write - read);
+	if((uint64_t)count > space)
+		count = (int)space;
+
+	// copy in up to two chunks, around the end of the ring
+	uint32_t at = (uint32_t)(write & ring->mask);
+	int first = OHMD_MIN(count, (int)(shm->capacity - at));
+
+	memcpy(shm->samples + at, samples, first * sizeof(ohmd_imu_sample));
+	memcpy(shm->samples, samples + first, (count - first) * sizeof(ohmd_imu_sample));
+
+	RING_STORE_RELEASE_64(&shm->write_index, write + count);
+
+	return count;
+}
+
+ohmd_imu_ring* ohmd_imu_ring_attach(ohmd_context* ctx, const char* name)
+{
+	if(strlen(name) >= OHMD_IMU_RING_NAME_SIZE){
+		ohmd_set_error(ctx, "imu ring name too long: %.64s", name);
+		return NULL;
+	}
+
+	size_t size = 0;
+	ohmd_imu_ring_shm* shm = ohmd_shm_map(name, &size, false);
+	if(!shm){
+		ohmd_set_error(ctx, "could not map imu ring %.64s", name);
+		return NULL;
+	}
+
+	if(size < sizeof(ohmd_imu_ring_shm) || RING_LOAD_ACQUIRE_32(&shm->magic) != OHMD_IMU_RING_MAGIC ||
+	   shm->version != OHMD_IMU_RING_VERSION || shm->sample_size != sizeof(ohmd_imu_sample) ||
+	   shm->capacity < 2 || (shm->capacity & (shm->capacity - 1)) != 0 ||
+	   size < sizeof(ohmd_imu_ring_shm) + (size_t)shm->capacity * sizeof(ohmd_imu_sample)){
+		ohmd_set_error(ctx, "%.64s is not a compatible imu ring", name);
+		ohmd_shm_unmap(shm, size);
+		return NULL;
+	}
+
+	ohmd_imu_ring* ring = ohmd_alloc(ctx, sizeof(ohmd_imu_ring));
+	if(!ring){
+		ohmd_shm_unmap(shm, size);
+		return NULL;
+	}
+
+	ring->shm = shm;
+	ring->size = size;
+	ring->mask = shm->capacity - 1;
+	strcpy(ring->name, name);
+
+	return ring;
+}
+
+void ohmd_imu_ring_detach(ohmd_imu_ring* ring)
+{
+	ohmd_imu_ring_destroy(ring);
+}
+
+int ohmd_imu_ring_peek(ohmd_imu_ring* ring, const ohmd_imu_sample** samples)
+{
+	ohmd_imu_ring_shm* shm = ring->shm;
+	uint64_t read = shm->read_index;
+	uint64_t avail = RING_LOAD_ACQUIRE_64(&shm->write_index) - read;
+
+	if(avail == 0)
+		return 0;
+
+	// a misbehaving producer can't make us read outside of the mapping
+	if(avail > ring->mask + 1)
+		avail = ring->mask + 1;
+
+	uint32_t at = (uint32_t)(read & ring->mask);
+	*samples = shm->samples + at;
+
+	return (int)OHMD_MIN(avail, (uint64_t)(ring->mask + 1 - at));
+}
+
+void ohmd_imu_ring_consume(ohmd_imu_ring* ring, int count)
+{
+	RING_STORE_RELEASE_64(&ring->shm->read_index, ring->shm->read_index + count);
+}
@@ -0,0 +1,48 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Shared Memory IMU Sample Ring */
+
+
+#ifndef IMURING_H
+#define IMURING_H
+
+#include <stdint.h>
+#include "openhmd.h"
+
+#define OHMD_IMU_RING_MAGIC 0x52554d49 // "IMUR"
+#define OHMD_IMU_RING_VERSION 1
+
+// Layout of the shared memory region. The producer only writes write_index,
+// the consumer only writes read_index, each index has a cache line of its own.
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;    // power of two
+	uint32_t sample_size; // sizeof(ohmd_imu_sample)
+	int64_t producer_pid; // a ring left behind by a producer that exited can be created again
+	uint8_t pad0[40];
+
+	uint64_t write_index;
+	uint8_t pad1[56];
+
+	uint64_t read_index;
+	uint8_t pad2[56];
+
+	ohmd_imu_sample samples[];
+} ohmd_imu_ring_shm;
+
+// consumer side, used by the external driver
+ohmd_imu_ring* ohmd_imu_ring_attach(ohmd_context* ctx, const char* name);
+void ohmd_imu_ring_detach(ohmd_imu_ring* ring);
+
+// returns the number of contiguous samples ready to be read in place
+int ohmd_imu_ring_peek(ohmd_imu_ring* ring, const ohmd_imu_sample** samples);
+// releases count samples returned by ohmd_imu_ring_peek back to the producer
+void ohmd_imu_ring_consume(ohmd_imu_ring* ring, int count);
+
+#endif
@@ -65,7 +65,7 @@ void oquatf_init_axis(quatf* me, const vec3f* vec, float angle)
 	me->w = cosf(angle / 2.0f);
 }
 
-void oquatf_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
+static void scalar_quat_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
 {
 	quatf q = {{vec->x * me->w + vec->z * me->y - vec->y * me->z,
 	            vec->y * me->w + vec->x * me->z - vec->z * me->x,
@@ -77,7 +77,7 @@ void oquatf_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
 	out_vec->z = me->w * q.z + me->z * q.w + me->x * q.y - me->y * q.x;
 }
 
-void oquatf_mult(const quatf* me, const quatf* q, quatf* out_q)
+static void scalar_quat_mult(const quatf* me, const quatf* q, quatf* out_q)
 {
 	out_q->x = me->w * q->x + me->x * q->w + me->y * q->z - me->z * q->y;
 	out_q->y = me->w * q->y - me->x * q->z + me->y * q->w + me->z * q->x;
@@ -91,9 +91,9 @@ void oquatf_mult_me(quatf* me, const quatf* q)
 	oquatf_mult(&tmp, q, me);
 }
 
-void oquatf_normalize_me(quatf* me)
+static void scalar_quat_normalize(quatf* me)
 {
-	float len = oquatf_get_length(me);
+	float len = sqrtf(me->x * me->x + me->y * me->y + me->z * me->z + me->w * me->w);
 	me->x /= len;
 	me->y /= len;
 	me->z /= len;
@@ -134,12 +134,12 @@ void oquatf_slerp (float fT, const quatf* rkP, const quatf* rkQ, bool shortestPa
 	float fCos =  oquatf_get_dot(rkP, rkQ);
 	quatf rkT;
 
-	// Do we need to invert rotation?
+	// Do we need to invert rotation? -rkQ is the same rotation, the short way round
 	if (fCos < 0.0f && shortestPath)
 	{
 		fCos = -fCos;
-		rkT = *rkQ;
-		oquatf_inverse(&rkT);
+		for(int i = 0; i < 4; i++)
+			rkT.arr[i] = -rkQ->arr[i];
 	}
 	else
 	{
@@ -152,8 +152,8 @@ void oquatf_slerp (float fT, const quatf* rkP, const quatf* rkQ, bool shortestPa
 		float fSin = sqrtf(1 - (fCos*fCos));
 		float fAngle = atan2f(fSin, fCos); 
 		float fInvSin = 1.0f / fSin;
-		float fCoeff0 = sin((1.0f - fT) * fAngle) * fInvSin;
-		float fCoeff1 = sin(fT * fAngle) * fInvSin;
+		float fCoeff0 = sinf((1.0f - fT) * fAngle) * fInvSin;
+		float fCoeff1 = sinf(fT * fAngle) * fInvSin;
 		
 		out_q->x = fCoeff0 * rkP->x + fCoeff1 * rkT.x;
 		out_q->y = fCoeff0 * rkP->y + fCoeff1 * rkT.y;
@@ -332,7 +332,7 @@ void omat4x4f_init_translate(mat4x4f* me, float x, float y, float z)
 	me->m[2][3] = z;
 }
 
-void omat4x4f_transpose(const mat4x4f* m, mat4x4f* o)
+static void scalar_mat4x4_transpose(const mat4x4f* m, mat4x4f* o)
 {
 	o->m[0][0] = m->m[0][0];
 	o->m[1][0] = m->m[0][1];
@@ -355,7 +355,7 @@ void omat4x4f_transpose(const mat4x4f* m, mat4x4f* o)
 	o->m[3][3] = m->m[3][3];
 }
 
-void omat4x4f_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f *o)
+static void scalar_mat4x4_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f *o)
 {
 	for(int i = 0; i < 4; i++){
 		float a0 = l->m[i][0], a1 = l->m[i][1], a2 = l->m[i][2], a3 = l->m[i][3];
@@ -367,30 +367,307 @@ void omat4x4f_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f *o)
 }
 
 
-// filter queue
+// structure of arrays, one element at a time, the tails the SIMD backends leave and the scalar backend
+
+static inline quatf soa_get_quat(const quatf_soa* a, int i)
+{
+	quatf q = {{ a->x[i], a->y[i], a->z[i], a->w[i] }};
+	return q;
+}
+
+static inline void soa_set_quat(const quatf_soa* a, int i, const quatf* q)
+{
+	a->x[i] = q->x;
+	a->y[i] = q->y;
+	a->z[i] = q->z;
+	a->w[i] = q->w;
+}
+
+static void soa_quat_mult_range(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int start, int end)
+{
+	for(int i = start; i < end; i++){
+		quatf a = soa_get_quat(me, i), b = soa_get_quat(q, i), r;
+		scalar_quat_mult(&a, &b, &r);
+		soa_set_quat(out_q, i, &r);
+	}
+}
+
+static void soa_quat_get_rotated_range(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec,
+                                       int start, int end)
+{
+	for(int i = start; i < end; i++){
+		quatf q = soa_get_quat(me, i);
+		vec3f v = {{ vec->x[i], vec->y[i], vec->z[i] }}, r;
+		scalar_quat_get_rotated(&q, &v, &r);
+		out_vec->x[i] = r.x;
+		out_vec->y[i] = r.y;
+		out_vec->z[i] = r.z;
+	}
+}
+
+static void soa_quat_normalize_range(const quatf_soa* me, int start, int end)
+{
+	for(int i = start; i < end; i++){
+		quatf q = soa_get_quat(me, i);
+		scalar_quat_normalize(&q);
+		soa_set_quat(me, i, &q);
+	}
+}
+
+static void soa_quat_get_mat4x4_range(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int start, int end)
+{
+	for(int i = start; i < end; i++){
+		quatf q = soa_get_quat(me, i);
+		vec3f p = {{ 0, 0, 0 }};
+		if(point){
+			p.x = point->x[i];
+			p.y = point->y[i];
+			p.z = point->z[i];
+		}
+		oquatf_get_mat4x4(&q, &p, out[i].m);
+	}
+}
+
+static int scalar_soa_quat_mult(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int count)
+{
+	soa_quat_mult_range(me, q, out_q, 0, count);
+	return count;
+}
 
-void ofq_init(filter_queue* me, int size)
+static int scalar_soa_quat_get_rotated(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec, int count)
+{
+	soa_quat_get_rotated_range(me, vec, out_vec, 0, count);
+	return count;
+}
+
+static int scalar_soa_quat_normalize(const quatf_soa* me, int count)
+{
+	soa_quat_normalize_range(me, 0, count);
+	return count;
+}
+
+static int scalar_soa_quat_get_mat4x4(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int count)
+{
+	soa_quat_get_mat4x4_range(me, point, out, 0, count);
+	return count;
+}
+
+
+// backends
+
+// the reference implementations, the SIMD backends are tested against these
+const omath_backend omath_scalar = {
+	"scalar",
+	scalar_quat_mult,
+	scalar_quat_get_rotated,
+	scalar_quat_normalize,
+	scalar_mat4x4_mult,
+	scalar_mat4x4_transpose,
+	scalar_soa_quat_mult,
+	scalar_soa_quat_get_rotated,
+	scalar_soa_quat_normalize,
+	scalar_soa_quat_get_mat4x4
+};
+
+static const omath_backend* backend = &omath_scalar;
+
+void omath_set_backend(const omath_backend* b)
+{
+	backend = b;
+}
+
+const omath_backend* omath_get_backend(void)
+{
+	return backend;
+}
+
+void oquatf_mult(const quatf* me, const quatf* q, quatf* out_q)
+{
+	backend->quat_mult(me, q, out_q);
+}
+
+void oquatf_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
+{
+	backend->quat_get_rotated(me, vec, out_vec);
+}
+
+void oquatf_normalize_me(quatf* me)
 {
-	memset(me, 0, sizeof(filter_queue));
+	backend->quat_normalize(me);
+}
+
+void omat4x4f_mult(const mat4x4f* left, const mat4x4f* right, mat4x4f* out_mat)
+{
+	backend->mat4x4_mult(left, right, out_mat);
+}
+
+void omat4x4f_transpose(const mat4x4f* me, mat4x4f* out_mat)
+{
+	backend->mat4x4_transpose(me, out_mat);
+}
+
+void oquatf_soa_mult(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int count)
+{
+	int done = backend->soa_quat_mult(me, q, out_q, count);
+	soa_quat_mult_range(me, q, out_q, done, count);
+}
+
+void oquatf_soa_get_rotated(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec, int count)
+{
+	int done = backend->soa_quat_get_rotated(me, vec, out_vec, count);
+	soa_quat_get_rotated_range(me, vec, out_vec, done, count);
+}
+
+void oquatf_soa_normalize_me(const quatf_soa* me, int count)
+{
+	int done = backend->soa_quat_normalize(me, count);
+	soa_quat_normalize_range(me, done, count);
+}
+
+void oquatf_soa_get_mat4x4(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int count)
+{
+	int done = backend->soa_quat_get_mat4x4(me, point, out, count);
+	soa_quat_get_mat4x4_range(me, point, out, done, count);
+}
+
+// bound by the sines, there is nothing for SIMD to win in the few multiplies around them
+void oquatf_soa_slerp(const float* fT, const quatf_soa* rkP, const quatf_soa* rkQ, const quatf_soa* out_q, int count)
+{
+	for(int i = 0; i < count; i++){
+		quatf p = soa_get_quat(rkP, i), q = soa_get_quat(rkQ, i), r;
+		oquatf_slerp(fT[i], &p, &q, true, &r);
+		soa_set_quat(out_q, i, &r);
+	}
+}
+
+
+// streaming statistics
+
+void ostats_init(stats_window* me, vec3f* elems, stats_extrema* extrema, int size)
+{
+	memset(me, 0, sizeof(stats_window));
+	memset(elems, 0, sizeof(vec3f) * size);
+	if(extrema)
+		memset(extrema, 0, sizeof(stats_extrema) * size);
 	me->size = size;
 }
 
-void ofq_add(filter_queue* me, const vec3f* vec)
+// recomputes the sums around the current mean, rounding in the running sums would otherwise pile up
+static void ostats_recenter(stats_window* me, const vec3f* elems)
+{
+	vec3f mean;
+	ostats_get_mean(me, &mean);
+
+	me->shift = mean;
+	me->sum.x = me->sum.y = me->sum.z = 0;
+	me->sum_sq = me->sum;
+
+	for(int i = 0; i < me->count; i++){
+		for(int a = 0; a < 3; a++){
+			float d = elems[i].arr[a] - mean.arr[a];
+			me->sum.arr[a] += d;
+			me->sum_sq.arr[a] += d * d;
+		}
+	}
+}
+
+// the extrema are kept in monotonic queues of window positions per axis, stored as rings across the
+// extrema slots. The front is the current minimum (maximum), every position is pushed and popped once.
+static void ostats_add_extrema(stats_window* me, const vec3f* elems, stats_extrema* ex, const vec3f* vec, bool full)
+{
+	const int size = me->size;
+
+	for(int a = 0; a < 3; a++){
+		float v = vec->arr[a];
+
+		// the position about to be overwritten leaves the window
+		if(full && me->min_len[a] > 0 && ex[me->min_head[a]].min[a] == me->at){
+			me->min_head[a] = (me->min_head[a] + 1) % size;
+			me->min_len[a]--;
+		}
+		if(full && me->max_len[a] > 0 && ex[me->max_head[a]].max[a] == me->at){
+			me->max_head[a] = (me->max_head[a] + 1) % size;
+			me->max_len[a]--;
+		}
+
+		// values that can't be the extreme anymore are dropped from the back
+		while(me->min_len[a] > 0 && elems[ex[(me->min_head[a] + me->min_len[a] - 1) % size].min[a]].arr[a] >= v)
+			me->min_len[a]--;
+		while(me->max_len[a] > 0 && elems[ex[(me->max_head[a] + me->max_len[a] - 1) % size].max[a]].arr[a] <= v)
+			me->max_len[a]--;
+
+		ex[(me->min_head[a] + me->min_len[a]++) % size].min[a] = me->at;
+		ex[(me->max_head[a] + me->max_len[a]++) % size].max[a] = me->at;
+	}
+}
+
+void ostats_add(stats_window* me, vec3f* elems, stats_extrema* extrema, const vec3f* vec)
+{
+	bool full = me->count == me->size;
+	vec3f* slot = elems + me->at;
+	vec3f shift = me->shift, sum = me->sum, sum_sq = me->sum_sq;
+
+	// swaps the oldest value for the new one, until the window is full the slots hold zero and
+	// shift is still zero, so the same arithmetic works while filling up
+	for(int a = 0; a < 3; a++){
+		float d = vec->arr[a] - shift.arr[a];
+		float old = slot->arr[a] - shift.arr[a];
+		sum.arr[a] += d - old;
+		sum_sq.arr[a] += d * d - old * old;
+	}
+
+	me->sum = sum;
+	me->sum_sq = sum_sq;
+
+	if(extrema)
+		ostats_add_extrema(me, elems, extrema, vec, full);
+
+	*slot = *vec;
+
+	if(!full)
+		me->count++;
+
+	if(++me->at == me->size){
+		me->at = 0;
+		ostats_recenter(me, elems);
+	}
+}
+
+void ostats_get_mean(const stats_window* me, vec3f* vec)
 {
-	me->elems[me->at] = *vec;
-	me->at = ((me->at + 1) % me->size);
+	if(me->count == 0){
+		vec->x = vec->y = vec->z = 0;
+		return;
+	}
+
+	float inv_count = 1.0f / (float)me->count;
+	for(int a = 0; a < 3; a++)
+		vec->arr[a] = me->shift.arr[a] + me->sum.arr[a] * inv_count;
 }
 
-void ofq_get_mean(const filter_queue* me, vec3f* vec)
+void ostats_get_variance(const stats_window* me, vec3f* vec)
 {
-	vec->x = vec->y = vec->z = 0;
-	for(int i = 0; i < me->size; i++){
-		vec->x += me->elems[i].x;
-		vec->y += me->elems[i].y;
-		vec->z += me->elems[i].z;
+	if(me->count == 0){
+		vec->x = vec->y = vec->z = 0;
+		return;
 	}
 
-	vec->x /= (float)me->size;
-	vec->y /= (float)me->size;
-	vec->z /= (float)me->size;
+	float inv_count = 1.0f / (float)me->count;
+	for(int a = 0; a < 3; a++){
+		float mean = me->sum.arr[a] * inv_count;
+		float var = me->sum_sq.arr[a] * inv_count - mean * mean;
+		vec->arr[a] = var > 0 ? var : 0;
+	}
+}
+
+void ostats_get_min(const stats_window* me, const vec3f* elems, const stats_extrema* extrema, vec3f* vec)
+{
+	for(int a = 0; a < 3; a++)
+		vec->arr[a] = me->min_len[a] > 0 ? elems[extrema[me->min_head[a]].min[a]].arr[a] : 0;
+}
+
+void ostats_get_max(const stats_window* me, const vec3f* elems, const stats_extrema* extrema, vec3f* vec)
+{
+	for(int a = 0; a < 3; a++)
+		vec->arr[a] = me->max_len[a] > 0 ? elems[extrema[me->max_head[a]].max[a]].arr[a] : 0;
 }
@@ -12,6 +12,7 @@
 #define OMATH_H
 
 #include <math.h>
+#include <stdbool.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -57,6 +58,7 @@ void oquatf_normalize_me(quatf* me);
 float oquatf_get_length(const quatf* me);
 float oquatf_get_dot(const quatf* me, const quatf* q);
 void oquatf_inverse(quatf* me);
+void oquatf_slerp(float fT, const quatf* rkP, const quatf* rkQ, bool shortestPath, quatf* out_q);
 
 void oquatf_get_mat4x4(const quatf* me, const vec3f* point, float mat[4][4]);
 
@@ -76,16 +78,91 @@ void omat4x4f_mult(const mat4x4f* left, const mat4x4f* right, mat4x4f* out_mat);
 void omat4x4f_transpose(const mat4x4f* me, mat4x4f* out_mat);
 
 
-// filter queue
-#define FILTER_QUEUE_MAX_SIZE 256
+// structure of arrays
+// batches of count elements kept in one float array per component, element i of a quaternion batch is
+// (x[i], y[i], z[i], w[i]). The arrays need no particular alignment and an output may be one of the inputs.
+
+typedef struct {
+	float *x, *y, *z, *w;
+} quatf_soa;
+
+typedef struct {
+	float *x, *y, *z;
+} vec3f_soa;
+
+void oquatf_soa_mult(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int count);
+void oquatf_soa_get_rotated(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec, int count);
+void oquatf_soa_normalize_me(const quatf_soa* me, int count);
+// shortest path, fT holds one interpolation factor per element
+void oquatf_soa_slerp(const float* fT, const quatf_soa* rkP, const quatf_soa* rkQ, const quatf_soa* out_q, int count);
+// out holds count matrices as oquatf_get_mat4x4 writes them, point may be NULL for no translation
+void oquatf_soa_get_mat4x4(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int count);
+
+
+// backends
+// the primitives that show up in fusion and the view matrices, implemented once in scalar code and once per
+// instruction set. oquatf_mult, oquatf_get_rotated, oquatf_normalize_me, omat4x4f_mult and omat4x4f_transpose
+// go through the backend picked by omath_init(), results match the scalar backend to within a few ulp.
+
+typedef struct {
+	const char* name;
+	void (*quat_mult)(const quatf* me, const quatf* q, quatf* out_q);
+	void (*quat_get_rotated)(const quatf* me, const vec3f* vec, vec3f* out_vec);
+	void (*quat_normalize)(quatf* me);
+	void (*mat4x4_mult)(const mat4x4f* left, const mat4x4f* right, mat4x4f* out_mat);
+	void (*mat4x4_transpose)(const mat4x4f* me, mat4x4f* out_mat);
+
+	// the batch versions return how many leading elements they did, the rest is left to the scalar code
+	int (*soa_quat_mult)(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int count);
+	int (*soa_quat_get_rotated)(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec, int count);
+	int (*soa_quat_normalize)(const quatf_soa* me, int count);
+	int (*soa_quat_get_mat4x4)(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int count);
+} omath_backend;
+
+extern const omath_backend omath_scalar;
+
+// picks the best backend the CPU supports, OHMD_MATH_BACKEND=<name> in the environment overrides it
+void omath_init(void);
+// the backends this build and CPU can run, best first, the scalar backend is always the last one
+int omath_get_backends(const omath_backend** out, int max);
+void omath_set_backend(const omath_backend* b);
+const omath_backend* omath_get_backend(void);
+
+// keeps vectors and matrices the library owns on 16 byte boundaries, so a SIMD load never splits a cache
+// line. The backends don't require it, the public API hands them the application's float arrays.
+#if defined(_MSC_VER)
+#define OMATH_ALIGNED __declspec(align(16))
+#else
+#define OMATH_ALIGNED __attribute__((aligned(16)))
+#endif
+
+// streaming statistics
+// mean, variance, minimum and maximum of the last size vectors added, each add and query is O(1)
+// (amortized for the minimum and maximum). The element storage is owned by the caller, must hold at
+// least size elements and is passed to every call that reads it, so a stats_window holds no pointers
+// and can be copied along with its storage. extrema is optional storage of size elements for
+// ostats_get_min and ostats_get_max, pass NULL to all calls if they aren't needed.
+
+typedef struct {
+	int min[3], max[3]; // queues of window positions, see ostats_add_extrema
+} stats_extrema;
 
 typedef struct {
 	int at, size;
-	vec3f elems[FILTER_QUEUE_MAX_SIZE];
-} filter_queue;
+	int count; // number of vectors in the window, at most size
+
+	// sums of elems - shift, shift follows the mean so the variance doesn't cancel out
+	vec3f shift, sum, sum_sq;
+
+	int min_head[3], min_len[3];
+	int max_head[3], max_len[3];
+} stats_window;
 
-void ofq_init(filter_queue* me, int size);
-void ofq_add(filter_queue* me, const vec3f* vec);
-void ofq_get_mean(const filter_queue* me, vec3f* vec);
+void ostats_init(stats_window* me, vec3f* elems, stats_extrema* extrema, int size);
+void ostats_add(stats_window* me, vec3f* elems, stats_extrema* extrema, const vec3f* vec);
+void ostats_get_mean(const stats_window* me, vec3f* vec);
+void ostats_get_variance(const stats_window* me, vec3f* vec);
+void ostats_get_min(const stats_window* me, const vec3f* elems, const stats_extrema* extrema, vec3f* vec);
+void ostats_get_max(const stats_window* me, const vec3f* elems, const stats_extrema* extrema, vec3f* vec);
 
 #endif
@@ -0,0 +1,469 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Math - SIMD Backends */
+
+/*
+ * x86 gets an SSE2 backend, which every x86-64 CPU has, and an AVX2 backend using FMA that is picked at runtime.
+ * SSE4 adds nothing these kernels use, dpps is slower than the shuffles. ARM gets a NEON backend when the compiler
+ * targets NEON, which is always the case on AArch64.
+ *
+ * All loads and stores are unaligned, the public API passes the application's float arrays straight through.
+ * Three element vectors are never loaded as four, that could read past the end of a page.
+ *
+ * The structure of arrays kernels are the scalar code with one element per lane, written once below and
+ * instantiated per instruction set. They do the operations in the order of the scalar code, so without fused
+ * multiply adds they give the scalar results bit for bit.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "openhmdi.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OMATH_SSE
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OMATH_TARGET_AVX2
+#else
+#define OMATH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OMATH_NEON
+#include <arm_neon.h>
+#endif
+
+// _v is the vector type, _w the number of lanes, the remaining arguments the load, store and arithmetic
+// intrinsics. Every kernel returns how many elements it did, the scalar code does the rest.
+#define OMATH_SOA_KERNELS(_pre, _attr, _v, _w, _load, _store, _add, _sub, _mul) \
+_attr static int _pre##_soa_quat_mult(const quatf_soa* me, const quatf_soa* q, const quatf_soa* out_q, int count) \
+{ \
+	int i = 0; \
+	for(; i + _w <= count; i += _w){ \
+		_v ax = _load(me->x + i), ay = _load(me->y + i), az = _load(me->z + i), aw = _load(me->w + i); \
+		_v bx = _load(q->x + i), by = _load(q->y + i), bz = _load(q->z + i), bw = _load(q->w + i); \
+		_store(out_q->x + i, _sub(_add(_add(_mul(aw, bx), _mul(ax, bw)), _mul(ay, bz)), _mul(az, by))); \
+		_store(out_q->y + i, _add(_add(_sub(_mul(aw, by), _mul(ax, bz)), _mul(ay, bw)), _mul(az, bx))); \
+		_store(out_q->z + i, _add(_sub(_add(_mul(aw, bz), _mul(ax, by)), _mul(ay, bx)), _mul(az, bw))); \
+		_store(out_q->w + i, _sub(_sub(_sub(_mul(aw, bw), _mul(ax, bx)), _mul(ay, by)), _mul(az, bz))); \
+	} \
+	return i; \
+} \
+\
+_attr static int _pre##_soa_quat_get_rotated(const quatf_soa* me, const vec3f_soa* vec, const vec3f_soa* out_vec, \
+                                             int count) \
+{ \
+	int i = 0; \
+	for(; i + _w <= count; i += _w){ \
+		_v x = _load(me->x + i), y = _load(me->y + i), z = _load(me->z + i), w = _load(me->w + i); \
+		_v vx = _load(vec->x + i), vy = _load(vec->y + i), vz = _load(vec->z + i); \
+		_v qx = _sub(_add(_mul(vx, w), _mul(vz, y)), _mul(vy, z)); \
+		_v qy = _sub(_add(_mul(vy, w), _mul(vx, z)), _mul(vz, x)); \
+		_v qz = _sub(_add(_mul(vz, w), _mul(vy, x)), _mul(vx, y)); \
+		_v qw = _add(_add(_mul(vx, x), _mul(vy, y)), _mul(vz, z)); \
+		_store(out_vec->x + i, _sub(_add(_add(_mul(w, qx), _mul(x, qw)), _mul(y, qz)), _mul(z, qy))); \
+		_store(out_vec->y + i, _sub(_add(_add(_mul(w, qy), _mul(y, qw)), _mul(z, qx)), _mul(x, qz))); \
+		_store(out_vec->z + i, _sub(_add(_add(_mul(w, qz), _mul(z, qw)), _mul(x, qy)), _mul(y, qx))); \
+	} \
+	return i; \
+}
+
+#define OMATH_SOA_NORMALIZE(_pre, _attr, _v, _w, _load, _store, _add, _mul, _div, _sqrt) \
+_attr static int _pre##_soa_quat_normalize(const quatf_soa* me, int count) \
+{ \
+	int i = 0; \
+	for(; i + _w <= count; i += _w){ \
+		_v x = _load(me->x + i), y = _load(me->y + i), z = _load(me->z + i), w = _load(me->w + i); \
+		_v len = _sqrt(_add(_add(_add(_mul(x, x), _mul(y, y)), _mul(z, z)), _mul(w, w))); \
+		_store(me->x + i, _div(x, len)); \
+		_store(me->y + i, _div(y, len)); \
+		_store(me->z + i, _div(z, len)); \
+		_store(me->w + i, _div(w, len)); \
+	} \
+	return i; \
+}
+
+// the rotation part of oquatf_get_mat4x4 one element per lane, _store_rows writes row r of the matrices of the lanes
+#define OMATH_SOA_MAT4X4(_pre, _v, _w, _load, _set1, _add, _sub, _mul, _store_rows) \
+static int _pre##_soa_quat_get_mat4x4(const quatf_soa* me, const vec3f_soa* point, mat4x4f* out, int count) \
+{ \
+	const _v zero = _set1(0), one = _set1(1.0f), two = _set1(2.0f); \
+	int i = 0; \
+	for(; i + _w <= count; i += _w){ \
+		_v x = _load(me->x + i), y = _load(me->y + i), z = _load(me->z + i), w = _load(me->w + i); \
+		_v x2 = _mul(two, x), y2 = _mul(two, y), z2 = _mul(two, z), w2 = _mul(two, w); \
+		_v px = point ? _load(point->x + i) : zero; \
+		_v py = point ? _load(point->y + i) : zero; \
+		_v pz = point ? _load(point->z + i) : zero; \
+		_store_rows(out + i, 0, _sub(_sub(one, _mul(y2, y)), _mul(z2, z)), \
+		            _sub(_mul(x2, y), _mul(w2, z)), _add(_mul(x2, z), _mul(w2, y)), px); \
+		_store_rows(out + i, 1, _add(_mul(x2, y), _mul(w2, z)), \
+		            _sub(_sub(one, _mul(x2, x)), _mul(z2, z)), _sub(_mul(y2, z), _mul(w2, x)), py); \
+		_store_rows(out + i, 2, _sub(_mul(x2, z), _mul(w2, y)), \
+		            _add(_mul(y2, z), _mul(w2, x)), _sub(_sub(one, _mul(x2, x)), _mul(y2, y)), pz); \
+		_store_rows(out + i, 3, zero, zero, zero, one); \
+	} \
+	return i; \
+}
+
+#ifdef OMATH_SSE
+
+#define SSE_SPLAT(_v, _i) _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(_i, _i, _i, _i))
+#define SSE_SWIZZLE(_v, _x, _y, _z, _w) _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(_w, _z, _y, _x))
+
+static inline __m128 sse_load_vec3(const vec3f* v)
+{
+	return _mm_set_ps(0, v->z, v->y, v->x);
+}
+
+static inline void sse_store_vec3(vec3f* out, __m128 v)
+{
+	_mm_storel_pi((__m64*)out->arr, v);
+	_mm_store_ss(out->arr + 2, _mm_movehl_ps(v, v));
+}
+
+// the three terms of a quaternion product that depend on me.x, me.y and me.z, with the signs of the scalar version
+#define QUAT_SIGN_X _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f)
+#define QUAT_SIGN_Y _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f)
+#define QUAT_SIGN_Z _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f)
+
+static inline __m128 sse_quat_mult_v(__m128 a, __m128 b)
+{
+	__m128 bx = _mm_xor_ps(SSE_SWIZZLE(b, 3, 2, 1, 0), QUAT_SIGN_X);
+	__m128 by = _mm_xor_ps(SSE_SWIZZLE(b, 2, 3, 0, 1), QUAT_SIGN_Y);
+	__m128 bz = _mm_xor_ps(SSE_SWIZZLE(b, 1, 0, 3, 2), QUAT_SIGN_Z);
+
+	__m128 r = _mm_mul_ps(SSE_SPLAT(a, 3), b);
+	r = _mm_add_ps(r, _mm_mul_ps(SSE_SPLAT(a, 0), bx));
+	r = _mm_add_ps(r, _mm_mul_ps(SSE_SPLAT(a, 1), by));
+	return _mm_add_ps(r, _mm_mul_ps(SSE_SPLAT(a, 2), bz));
+}
+
+// a x b in the first three lanes, zero in the last one
+static inline __m128 sse_cross(__m128 a, __m128 b)
+{
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, SSE_SWIZZLE(b, 1, 2, 0, 3)), _mm_mul_ps(SSE_SWIZZLE(a, 1, 2, 0, 3), b));
+	return SSE_SWIZZLE(c, 1, 2, 0, 3);
+}
+
+static void sse_quat_mult(const quatf* me, const quatf* q, quatf* out_q)
+{
+	_mm_storeu_ps(out_q->arr, sse_quat_mult_v(_mm_loadu_ps(me->arr), _mm_loadu_ps(q->arr)));
+}
+
+// v + w t + u x t with t = 2 u x v, u being the vector part of the quaternion
+static void sse_quat_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
+{
+	__m128 q = _mm_loadu_ps(me->arr);
+	__m128 v = sse_load_vec3(vec);
+
+	__m128 t = sse_cross(q, v);
+	t = _mm_add_ps(t, t);
+
+	__m128 r = _mm_add_ps(v, _mm_mul_ps(SSE_SPLAT(q, 3), t));
+	sse_store_vec3(out_vec, _mm_add_ps(r, sse_cross(q, t)));
+}
+
+static void sse_quat_normalize(quatf* me)
+{
+	__m128 q = _mm_loadu_ps(me->arr);
+	__m128 sq = _mm_mul_ps(q, q);
+	__m128 sum = _mm_add_ps(sq, SSE_SWIZZLE(sq, 1, 0, 3, 2));
+	sum = _mm_add_ps(sum, SSE_SWIZZLE(sum, 2, 3, 0, 1));
+
+	_mm_storeu_ps(me->arr, _mm_div_ps(q, _mm_sqrt_ps(sum)));
+}
+
+static void sse_mat4x4_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f* o)
+{
+	__m128 r0 = _mm_loadu_ps(r->m[0]), r1 = _mm_loadu_ps(r->m[1]);
+	__m128 r2 = _mm_loadu_ps(r->m[2]), r3 = _mm_loadu_ps(r->m[3]);
+
+	for(int i = 0; i < 4; i++){
+		__m128 row = _mm_loadu_ps(l->m[i]);
+		__m128 acc = _mm_mul_ps(SSE_SPLAT(row, 0), r0);
+		acc = _mm_add_ps(acc, _mm_mul_ps(SSE_SPLAT(row, 1), r1));
+		acc = _mm_add_ps(acc, _mm_mul_ps(SSE_SPLAT(row, 2), r2));
+		acc = _mm_add_ps(acc, _mm_mul_ps(SSE_SPLAT(row, 3), r3));
+		_mm_storeu_ps(o->m[i], acc);
+	}
+}
+
+static void sse_mat4x4_transpose(const mat4x4f* m, mat4x4f* o)
+{
+	__m128 r0 = _mm_loadu_ps(m->m[0]), r1 = _mm_loadu_ps(m->m[1]);
+	__m128 r2 = _mm_loadu_ps(m->m[2]), r3 = _mm_loadu_ps(m->m[3]);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	_mm_storeu_ps(o->m[0], r0);
+	_mm_storeu_ps(o->m[1], r1);
+	_mm_storeu_ps(o->m[2], r2);
+	_mm_storeu_ps(o->m[3], r3);
+}
+
+// four lanes, one per matrix, transposed into four rows
+static inline void sse_store_rows(mat4x4f* out, int r, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+{
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	_mm_storeu_ps(out[0].m[r], c0);
+	_mm_storeu_ps(out[1].m[r], c1);
+	_mm_storeu_ps(out[2].m[r], c2);
+	_mm_storeu_ps(out[3].m[r], c3);
+}
+
+OMATH_SOA_KERNELS(sse, , __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps)
+OMATH_SOA_NORMALIZE(sse, , __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps, _mm_mul_ps, _mm_div_ps, _mm_sqrt_ps)
+OMATH_SOA_MAT4X4(sse, __m128, 4, _mm_loadu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, sse_store_rows)
+
+static const omath_backend omath_sse2 = {
+	"sse2",
+	sse_quat_mult,
+	sse_quat_get_rotated,
+	sse_quat_normalize,
+	sse_mat4x4_mult,
+	sse_mat4x4_transpose,
+	sse_soa_quat_mult,
+	sse_soa_quat_get_rotated,
+	sse_soa_quat_normalize,
+	sse_soa_quat_get_mat4x4
+};
+
+// AVX2 and FMA, the matrix product does two rows per instruction. The quaternion product stays SSE2, in a chain
+// of products like the gyro integration the longer latency of the fused multiply adds makes it slower.
+
+OMATH_TARGET_AVX2 static inline __m128 avx2_cross(__m128 a, __m128 b)
+{
+	__m128 c = _mm_fmsub_ps(a, SSE_SWIZZLE(b, 1, 2, 0, 3), _mm_mul_ps(SSE_SWIZZLE(a, 1, 2, 0, 3), b));
+	return SSE_SWIZZLE(c, 1, 2, 0, 3);
+}
+
+OMATH_TARGET_AVX2 static void avx2_quat_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
+{
+	__m128 q = _mm_loadu_ps(me->arr);
+	__m128 v = sse_load_vec3(vec);
+
+	__m128 t = avx2_cross(q, v);
+	t = _mm_add_ps(t, t);
+
+	__m128 r = _mm_fmadd_ps(SSE_SPLAT(q, 3), t, v);
+	sse_store_vec3(out_vec, _mm_add_ps(r, avx2_cross(q, t)));
+}
+
+OMATH_TARGET_AVX2 static void avx2_mat4x4_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f* o)
+{
+	// every row of r in both halves, two rows of l at a time
+	__m256 r0 = _mm256_broadcast_ps((const __m128*)r->m[0]);
+	__m256 r1 = _mm256_broadcast_ps((const __m128*)r->m[1]);
+	__m256 r2 = _mm256_broadcast_ps((const __m128*)r->m[2]);
+	__m256 r3 = _mm256_broadcast_ps((const __m128*)r->m[3]);
+
+	for(int i = 0; i < 4; i += 2){
+		__m256 rows = _mm256_loadu_ps(l->m[i]);
+		__m256 acc = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), r0);
+		acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0x55), r1, acc);
+		acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0xaa), r2, acc);
+		acc = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0xff), r3, acc);
+		_mm256_storeu_ps(o->m[i], acc);
+	}
+}
+
+// eight lanes, the matrices stay SSE2 since they are bound by the stores
+OMATH_SOA_KERNELS(avx2, OMATH_TARGET_AVX2, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+                  _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps)
+OMATH_SOA_NORMALIZE(avx2, OMATH_TARGET_AVX2, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+                    _mm256_add_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_sqrt_ps)
+
+static const omath_backend omath_avx2 = {
+	"avx2",
+	sse_quat_mult,
+	avx2_quat_get_rotated,
+	sse_quat_normalize,
+	avx2_mat4x4_mult,
+	sse_mat4x4_transpose,
+	avx2_soa_quat_mult,
+	avx2_soa_quat_get_rotated,
+	avx2_soa_quat_normalize,
+	sse_soa_quat_get_mat4x4
+};
+
+static bool cpu_has_avx2_fma(void)
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if(regs[0] < 7)
+		return false;
+
+	// FMA, OSXSAVE and AVX, and the OS saving the YMM registers
+	__cpuid(regs, 1);
+	const int needed = (1 << 12) | (1 << 27) | (1 << 28);
+	if((regs[2] & needed) != needed || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif // OMATH_SSE
+
+#ifdef OMATH_NEON
+
+static inline float32x4_t neon_quat_mult_v(const quatf* me, float32x4_t b)
+{
+	static const float sign_x[4] = { 1, -1, 1, -1 };
+	static const float sign_y[4] = { 1, 1, -1, -1 };
+	static const float sign_z[4] = { -1, 1, 1, -1 };
+
+	float32x4_t b_yxwz = vrev64q_f32(b);
+	float32x4_t b_wzyx = vextq_f32(b_yxwz, b_yxwz, 2);
+	float32x4_t b_zwxy = vextq_f32(b, b, 2);
+
+	float32x4_t r = vmulq_n_f32(b, me->w);
+	r = vmlaq_f32(r, vmulq_n_f32(b_wzyx, me->x), vld1q_f32(sign_x));
+	r = vmlaq_f32(r, vmulq_n_f32(b_zwxy, me->y), vld1q_f32(sign_y));
+	return vmlaq_f32(r, vmulq_n_f32(b_yxwz, me->z), vld1q_f32(sign_z));
+}
+
+static void neon_quat_mult(const quatf* me, const quatf* q, quatf* out_q)
+{
+	vst1q_f32(out_q->arr, neon_quat_mult_v(me, vld1q_f32(q->arr)));
+}
+
+// q (v, 0) q^-1 as two products, NEON has no cheap three lane swizzle for the cross product form
+static void neon_quat_get_rotated(const quatf* me, const vec3f* vec, vec3f* out_vec)
+{
+	const float v[4] = { vec->x, vec->y, vec->z, 0 };
+	const float conj[4] = { -me->x, -me->y, -me->z, me->w };
+	quatf t;
+
+	vst1q_f32(t.arr, neon_quat_mult_v(me, vld1q_f32(v)));
+	float32x4_t r = neon_quat_mult_v(&t, vld1q_f32(conj));
+
+	vst1_f32(out_vec->arr, vget_low_f32(r));
+	out_vec->z = vgetq_lane_f32(r, 2);
+}
+
+static void neon_quat_normalize(quatf* me)
+{
+	float32x4_t q = vld1q_f32(me->arr);
+	float32x4_t sq = vmulq_f32(q, q);
+	float32x2_t sum = vpadd_f32(vget_low_f32(sq), vget_high_f32(sq));
+	sum = vpadd_f32(sum, sum);
+
+	vst1q_f32(me->arr, vmulq_n_f32(q, 1.0f / sqrtf(vget_lane_f32(sum, 0))));
+}
+
+static void neon_mat4x4_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f* o)
+{
+	float32x4_t r0 = vld1q_f32(r->m[0]), r1 = vld1q_f32(r->m[1]);
+	float32x4_t r2 = vld1q_f32(r->m[2]), r3 = vld1q_f32(r->m[3]);
+
+	for(int i = 0; i < 4; i++){
+		float32x4_t acc = vmulq_n_f32(r0, l->m[i][0]);
+		acc = vmlaq_n_f32(acc, r1, l->m[i][1]);
+		acc = vmlaq_n_f32(acc, r2, l->m[i][2]);
+		acc = vmlaq_n_f32(acc, r3, l->m[i][3]);
+		vst1q_f32(o->m[i], acc);
+	}
+}
+
+static void neon_mat4x4_transpose(const mat4x4f* m, mat4x4f* o)
+{
+	// de-interleaving load, val[j] is column j
+	float32x4x4_t cols = vld4q_f32(m->arr);
+
+	vst1q_f32(o->m[0], cols.val[0]);
+	vst1q_f32(o->m[1], cols.val[1]);
+	vst1q_f32(o->m[2], cols.val[2]);
+	vst1q_f32(o->m[3], cols.val[3]);
+}
+
+// four lanes, one per matrix, an interleaving store per lane writes one row
+static inline void neon_store_rows(mat4x4f* out, int r, float32x4_t c0, float32x4_t c1, float32x4_t c2,
+                                   float32x4_t c3)
+{
+	float32x4x4_t rows = {{ c0, c1, c2, c3 }};
+
+	vst4q_lane_f32(out[0].m[r], rows, 0);
+	vst4q_lane_f32(out[1].m[r], rows, 1);
+	vst4q_lane_f32(out[2].m[r], rows, 2);
+	vst4q_lane_f32(out[3].m[r], rows, 3);
+}
+
+OMATH_SOA_KERNELS(neon, , float32x4_t, 4, vld1q_f32, vst1q_f32, vaddq_f32, vsubq_f32, vmulq_f32)
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+OMATH_SOA_NORMALIZE(neon, , float32x4_t, 4, vld1q_f32, vst1q_f32, vaddq_f32, vmulq_f32, vdivq_f32, vsqrtq_f32)
+#else
+// 32 bit NEON has no vector division or square root, normalizing is left to the scalar code
+static int neon_soa_quat_normalize(const quatf_soa* me, int count)
+{
+	return 0;
+}
+#endif
+
+OMATH_SOA_MAT4X4(neon, float32x4_t, 4, vld1q_f32, vdupq_n_f32, vaddq_f32, vsubq_f32, vmulq_f32, neon_store_rows)
+
+static const omath_backend omath_neon = {
+	"neon",
+	neon_quat_mult,
+	neon_quat_get_rotated,
+	neon_quat_normalize,
+	neon_mat4x4_mult,
+	neon_mat4x4_transpose,
+	neon_soa_quat_mult,
+	neon_soa_quat_get_rotated,
+	neon_soa_quat_normalize,
+	neon_soa_quat_get_mat4x4
+};
+
+#endif // OMATH_NEON
+
+int omath_get_backends(const omath_backend** out, int max)
+{
+	int count = 0;
+
+#ifdef OMATH_SSE
+	if(count < max && cpu_has_avx2_fma())
+		out[count++] = &omath_avx2;
+	if(count < max)
+		out[count++] = &omath_sse2;
+#endif
+
+#ifdef OMATH_NEON
+	if(count < max)
+		out[count++] = &omath_neon;
+#endif
+
+	if(count < max)
+		out[count++] = &omath_scalar;
+
+	return count;
+}
+
+void omath_init(void)
+{
+	const omath_backend* backends[8];
+	int count = omath_get_backends(backends, 8);
+	const omath_backend* pick = backends[0];
+
+	const char* name = getenv("OHMD_MATH_BACKEND");
+	if(name){
+		for(int i = 0; i < count; i++)
+			if(strcmp(backends[i]->name, name) == 0)
+				pick = backends[i];
+	}
+
+	omath_set_backend(pick);
+}
@@ -26,6 +26,16 @@ OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create(void)
 	}
 
 	ohmd_monotonic_init(ctx);
+	ofusion_bank_init(&ctx->fusion_bank, ctx->fusion_bank_devices, 256);
+
+	// the math backend is process wide, picked when the first context is created
+	static bool math_ready = false;
+	ohmd_lock_global();
+	if(!math_ready){
+		omath_init();
+		math_ready = true;
+	}
+	ohmd_unlock_global();
 
 #if DRIVER_OCULUS_RIFT
 	ctx->drivers[ctx->num_drivers++] = ohmd_create_oculus_rift_drv(ctx);
@@ -78,40 +88,277 @@ OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create(void)
 	return ctx;
 }
 
+static void ohmd_ctx_free(ohmd_context* ctx)
+{
+	for(int i = 0; i < ctx->num_drivers; i++){
+		ctx->drivers[i]->destroy(ctx->drivers[i]);
+	}
+
+	if(ctx->update_mutex)
+		ohmd_destroy_mutex(ctx->update_mutex);
+
+	free(ctx);
+}
+
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_destroy(ohmd_context* ctx)
 {
 	ctx->update_request_quit = true;
 
+	if(ctx->update_thread){
+		ohmd_destroy_thread(ctx->update_thread);
+		ctx->update_thread = NULL;
+	}
+
+	if(ctx->stream)
+		ohmd_stream_destroy(ctx->stream);
+
+	ohmd_registry_lock();
+
 	for(int i = 0; i < ctx->num_active_devices; i++){
-		ctx->active_devices[i]->close(ctx->active_devices[i]);
+		if(ohmd_registry_close(ctx->active_devices[i]))
+			ctx->num_lent_devices++;
 	}
+	ctx->num_active_devices = 0;
 
-	for(int i = 0; i < ctx->num_drivers; i++){
-		ctx->drivers[i]->destroy(ctx->drivers[i]);
+	// devices still used by other contexts need the drivers of this one, the last of them frees it
+	ctx->destroyed = true;
+	bool free_now = ctx->num_lent_devices == 0;
+
+	ohmd_registry_unlock();
+
+	if(free_now)
+		ohmd_ctx_free(ctx);
+}
+
+void ohmd_ctx_return_device(ohmd_context* ctx)
+{
+	if(--ctx->num_lent_devices == 0 && ctx->destroyed)
+		ohmd_ctx_free(ctx);
+}
+
+// fuses the samples a device with lazy fusion has stored, called with the device locked
+static void ohmd_device_flush_fusion(ohmd_device* device)
+{
+	if(device->sensor_fusion && device->sensor_fusion->pending_count > 0)
+		ofusion_flush(device->sensor_fusion);
+}
+
+// takes the pose of the driver once per ohmd_ctx_update, called with the device locked
+static void ohmd_device_refresh_pose(ohmd_device* device)
+{
+	if(!device->pose_stale)
+		return;
+
+	ohmd_device_flush_fusion(device);
+	device->getf(device, OHMD_POSITION_VECTOR, (float*)&device->position);
+	device->getf(device, OHMD_ROTATION_QUAT, (float*)&device->rotation);
+	device->pose_stale = false;
+}
+
+// fuses the samples the devices in the bank deferred, before anything reads them, called with the update mutex
+// held and no device locked. The update mutex keeps the devices open, the registry lock isn't needed, opening a
+// device holds it for long.
+static void ohmd_ctx_flush_fusion_bank(ohmd_context* ctx)
+{
+	ohmd_device* devices[256];
+	int count = 0;
+
+	if(ctx->fusion_bank.count == 0)
+		return;
+
+	for(int i = 0; i < ctx->num_active_devices; i++){
+		ohmd_device* dev = ctx->active_devices[i];
+		if(dev->settings.fusion_bank && dev->shared && dev->sensor_fusion)
+			devices[count++] = dev;
 	}
 
-	if(ctx->update_thread){
-		ohmd_destroy_thread(ctx->update_thread);
-		ohmd_destroy_mutex(ctx->update_mutex);
+	ohmd_registry_lock_devices(devices, count);
+	ofusion_bank_flush(&ctx->fusion_bank);
+	ohmd_registry_unlock_devices(devices, count);
+}
+
+bool ohmd_device_defer_fusion(ohmd_device* device, int max_pending)
+{
+	fusion* f = device->sensor_fusion;
+	if(!f)
+		return true;
+
+	fusion_sample* old = f->pending;
+	fusion_sample* pending = NULL;
+
+	if(max_pending > 0){
+		pending = ohmd_alloc(device->ctx, sizeof(fusion_sample) * max_pending);
+		if(!pending)
+			return false;
 	}
 
-	free(ctx);
+	ofusion_defer(f, pending, max_pending);
+	free(old);
+
+	return true;
+}
+
+// sends the freshly fused pose of a device to the udp stream, called with the update mutex held
+static void ohmd_stream_publish(ohmd_context* ctx, ohmd_device* dev)
+{
+	quatf rot;
+	vec3f pos;
+	uint32_t controls = 0;
+
+	// the stream is a consumer too, lazy fusion catches up at the rate the stream is fed
+	ohmd_device_flush_fusion(dev);
+
+	if(dev->getf(dev, OHMD_ROTATION_QUAT, rot.arr) != OHMD_S_OK ||
+	   dev->getf(dev, OHMD_POSITION_VECTOR, pos.arr) != OHMD_S_OK)
+		return;
+
+	oquatf_mult_me(&rot, &dev->rotation_correction);
+	for(int i = 0; i < 3; i++)
+		pos.arr[i] += dev->position_correction.arr[i];
+
+	int count = OHMD_MIN(dev->properties.control_count, 32);
+	if(count > 0){
+		float state[64];
+		if(dev->getf(dev, OHMD_CONTROLS_STATE, state) == OHMD_S_OK){
+			for(int i = 0; i < count; i++)
+				if(dev->properties.controls_types[i] == OHMD_DIGITAL && state[i] > 0.5f)
+					controls |= 1u << i;
+		}
+	}
+
+	ohmd_stream_device(ctx->stream, dev, controls, &rot, &pos);
+}
+
+// marks a device as read by the application and resumes it if it was parked, called with the update mutex held
+static void ohmd_device_touch(ohmd_device* device)
+{
+	if(!device->idle_timeout_ticks)
+		return;
+
+	device->last_query = ohmd_monotonic_get(device->ctx);
+
+	if(device->parked){
+		LOGD("resuming idle device");
+		if(device->park)
+			device->park(device, false);
+		device->parked = false;
+	}
+}
+
+// parks a device nobody has read for the idle timeout, returns true if it should not be updated, called with the
+// update mutex held and the device locked
+static bool ohmd_device_idle(ohmd_device* device, uint64_t now)
+{
+	if(!device->idle_timeout_ticks)
+		return false;
+
+	// a query after now was taken is not in the past
+	if(!device->parked && now > device->last_query && now - device->last_query > device->idle_timeout_ticks){
+		LOGD("parking idle device");
+		if(device->park)
+			device->park(device, true);
+		device->parked = true;
+	}
+
+	return device->parked;
 }
 
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_update(ohmd_context* ctx)
 {
+	uint64_t now = ohmd_monotonic_get(ctx);
+	bool updated[256] = { false };
+
 	for(int i = 0; i < ctx->num_active_devices; i++){
 		ohmd_device* dev = ctx->active_devices[i];
-		if(!dev->settings.automatic_update && dev->update)
+		if(dev->settings.automatic_update || !dev->update)
+			continue;
+
+		// queries from other threads resume the device under the same locks
+		ohmd_lock_mutex(ctx->update_mutex);
+		ohmd_registry_lock_device(dev);
+		if(!ohmd_device_idle(dev, now)){
 			dev->update(dev);
+			updated[i] = true;
+		}
+		ohmd_registry_unlock_device(dev);
+		ohmd_unlock_mutex(ctx->update_mutex);
+	}
+
+	ohmd_lock_mutex(ctx->update_mutex);
+	ohmd_ctx_flush_fusion_bank(ctx);
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	for(int i = 0; i < ctx->num_active_devices; i++){
+		ohmd_device* dev = ctx->active_devices[i];
 
 		ohmd_lock_mutex(ctx->update_mutex);
-		dev->getf(dev, OHMD_POSITION_VECTOR, (float*)&dev->position);
-		dev->getf(dev, OHMD_ROTATION_QUAT, (float*)&dev->rotation);
+		ohmd_registry_lock_device(dev);
+		if(updated[i] && ctx->stream)
+			ohmd_stream_publish(ctx, dev);
+		// devices nobody queries until the next update aren't fused for nothing
+		dev->pose_stale = true;
+		ohmd_registry_unlock_device(dev);
 		ohmd_unlock_mutex(ctx->update_mutex);
 	}
 }
 
+static int ohmd_ctx_start_stream(ohmd_context* ctx, const char* address, int port, int decimation, int batch)
+{
+	if(!address || port <= 0 || port > 65535 || decimation < 1){
+		ohmd_set_error(ctx, "invalid stream destination %s:%d (decimation %d)", address ? address : "(null)", port, decimation);
+		return OHMD_S_INVALID_PARAMETER;
+	}
+
+	if(batch < 1 || batch > OHMD_STREAM_MAX_BATCH){
+		ohmd_set_error(ctx, "invalid stream batch %d, must be 1 to %d", batch, OHMD_STREAM_MAX_BATCH);
+		return OHMD_S_INVALID_PARAMETER;
+	}
+
+	ohmd_stream* stream = ohmd_stream_create(ctx, address, port, decimation, batch);
+	if(!stream)
+		return OHMD_S_UNKNOWN_ERROR;
+
+	ohmd_lock_mutex(ctx->update_mutex);
+	ohmd_stream* old = ctx->stream;
+	ctx->stream = stream;
+
+	// poses batched for the old stream are not sent to the new one
+	for(int i = 0; i < ctx->num_active_devices; i++){
+		ctx->active_devices[i]->stream_batch.count = 0;
+		ctx->active_devices[i]->stream_batch.size = 0;
+	}
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	if(old)
+		ohmd_stream_destroy(old);
+
+	return OHMD_S_OK;
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_start(ohmd_context* ctx, const char* address, int port, int decimation)
+{
+	return ohmd_ctx_start_stream(ctx, address, port, decimation, 1);
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_start_batched(ohmd_context* ctx, const char* address, int port, int decimation, int batch)
+{
+	return ohmd_ctx_start_stream(ctx, address, port, decimation, batch);
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_stream_stop(ohmd_context* ctx)
+{
+	ohmd_lock_mutex(ctx->update_mutex);
+	ohmd_stream* old = ctx->stream;
+	ctx->stream = NULL;
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	if(!old)
+		return OHMD_S_INVALID_OPERATION;
+
+	ohmd_stream_destroy(old);
+	return OHMD_S_OK;
+}
+
 OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_ctx_get_error(ohmd_context* ctx)
 {
 	return ctx->error_msg;
@@ -165,6 +412,8 @@ OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_list_gets(ohmd_context* ctx, int
 		return ctx->list.devices[index].product;
 	case OHMD_PATH:
 		return ctx->list.devices[index].path;
+	case OHMD_SERIAL:
+		return ctx->list.devices[index].serial;
 	default:
 		return NULL;
 	}
@@ -197,11 +446,28 @@ static unsigned int ohmd_update_thread(void* arg)
 	{
 		ohmd_lock_mutex(ctx->update_mutex);
 
+		uint64_t now = ohmd_monotonic_get(ctx);
+
 		for(int i = 0; i < ctx->num_active_devices; i++){
-			if(ctx->active_devices[i]->settings.automatic_update && ctx->active_devices[i]->update)
-				ctx->active_devices[i]->update(ctx->active_devices[i]);
+			ohmd_device* dev = ctx->active_devices[i];
+			if(dev->settings.automatic_update && dev->update){
+				ohmd_registry_lock_device(dev);
+				if(ohmd_device_idle(dev, now)){
+					ohmd_registry_unlock_device(dev);
+					continue;
+				}
+
+				dev->update(dev);
+
+				if(ctx->stream)
+					ohmd_stream_publish(ctx, dev);
+				ohmd_registry_unlock_device(dev);
+			}
 		}
 
+		// side by side before a query or the high-water mark fuses them one at a time
+		ohmd_ctx_flush_fusion_bank(ctx);
+
 		ohmd_unlock_mutex(ctx->update_mutex);
 
 		ohmd_sleep(AUTOMATIC_UPDATE_SLEEP);
@@ -220,17 +486,18 @@ static void ohmd_set_up_update_thread(ohmd_context* ctx)
 
 OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context* ctx, int index, ohmd_device_settings* settings)
 {
+	ohmd_registry_lock();
 	ohmd_lock_mutex(ctx->update_mutex);
 
 	if(index >= 0 && index < ctx->list.num_devices){
 
-		ohmd_device_desc* desc = &ctx->list.devices[index];
-		ohmd_driver* driver = (ohmd_driver*)desc->driver_ptr;
-		ohmd_device* device = driver->open_device(driver, desc);
+		// shares the device if it is already open in this or another context
+		ohmd_device* device = ohmd_registry_open(ctx, &ctx->list.devices[index]);
 
 		if (device == NULL) {
 			ohmd_set_error(ctx, "Could not open device with index: %d, check device permissions?", index);
 			ohmd_unlock_mutex(ctx->update_mutex);
+			ohmd_registry_unlock();
 			return NULL;
 		}
 
@@ -239,10 +506,38 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context
 		device->settings = *settings;
 
 		device->ctx = ctx;
+		device->idle_timeout_ticks = ohmd_monotonic_conv(settings->idle_timeout_ms, 1000, ohmd_monotonic_per_sec(ctx));
+		device->last_query = ohmd_monotonic_get(ctx);
+
+		// the fusion of a device shared with another context keeps the settings of the first open
+		if(device->shared && device->sensor_fusion){
+			ohmd_registry_lock_device(device);
+
+			const fusion_engine* engine = ofusion_get_engine(settings->fusion_engine);
+			if(engine && device->sensor_fusion->engine != engine)
+				ofusion_set_engine(device->sensor_fusion, engine);
+
+			if(settings->preintegrate_samples > 0 && settings->preintegrate_samples != device->sensor_fusion->preint.size)
+				ofusion_set_preintegration(device->sensor_fusion, settings->preintegrate_samples);
+
+			if(settings->lazy_fusion_samples > 0 && !device->sensor_fusion->pending &&
+			   !ohmd_device_defer_fusion(device, settings->lazy_fusion_samples))
+				LOGW("could not allocate the lazy fusion buffer, fusing every sample");
+
+			if(settings->fusion_bank){
+				if(!device->sensor_fusion->pending && !ohmd_device_defer_fusion(device, FUSION_BANK_PENDING))
+					LOGW("could not allocate the fusion bank buffer, fusing every sample");
+				else if(!ofusion_bank_add(&ctx->fusion_bank, device->sensor_fusion))
+					LOGW("the fusion bank is full, fusing the device on its own");
+			}
+
+			ohmd_registry_unlock_device(device);
+		}
 		device->active_device_idx = ctx->num_active_devices;
 		ctx->active_devices[ctx->num_active_devices++] = device;
 
 		ohmd_unlock_mutex(ctx->update_mutex);
+		ohmd_registry_unlock();
 
 		if(device->settings.automatic_update)
 			ohmd_set_up_update_thread(ctx);
@@ -251,6 +546,7 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context
 	}
 
 	ohmd_unlock_mutex(ctx->update_mutex);
+	ohmd_registry_unlock();
 
 	ohmd_set_error(ctx, "no device with index: %d", index);
 	return NULL;
@@ -261,21 +557,32 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device(ohmd_context*
 	ohmd_device_settings settings;
 
 	settings.automatic_update = true;
+	settings.idle_timeout_ms = 0;
+	settings.lazy_fusion_samples = 0;
+	settings.fusion_engine = OHMD_FUSION_DEFAULT;
+	settings.reader_thread = false;
+	settings.preintegrate_samples = 0;
+	settings.fusion_bank = false;
 
 	return ohmd_list_open_device_s(ctx, index, &settings);
 }
 
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_close_device(ohmd_device* device)
 {
+	ohmd_registry_lock();
 	ohmd_lock_mutex(device->ctx->update_mutex);
 
 	ohmd_context* ctx = device->ctx;
 	int idx = device->active_device_idx;
 
+	if(device->sensor_fusion)
+		ofusion_bank_remove(&ctx->fusion_bank, device->sensor_fusion);
+
 	memmove(ctx->active_devices + idx, ctx->active_devices + idx + 1,
 		sizeof(ohmd_device*) * (ctx->num_active_devices - idx - 1));
 
-	device->close(device);
+	if(ohmd_registry_close(device))
+		ctx->num_lent_devices++;
 
 	ctx->num_active_devices--;
 
@@ -283,6 +590,7 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_close_device(ohmd_device* device)
 		ctx->active_devices[i]->active_device_idx--;
 
 	ohmd_unlock_mutex(ctx->update_mutex);
+	ohmd_registry_unlock();
 
 	return OHMD_S_OK;
 }
@@ -291,9 +599,9 @@ static int ohmd_device_getf_unp(ohmd_device* device, ohmd_float_value type, floa
 {
 	switch(type){
 	case OHMD_LEFT_EYE_GL_MODELVIEW_MATRIX: {
-			quatf rot = device->rotation;
+			OMATH_ALIGNED quatf rot = device->rotation;
 			oquatf_mult_me(&rot, &device->rotation_correction);
-			mat4x4f central_view, eye_shift, result;
+			OMATH_ALIGNED mat4x4f central_view, eye_shift, result;
 			omat4x4f_init_look_at(&central_view, &rot, &device->position);
 			omat4x4f_init_translate(&eye_shift, +(device->properties.ipd / 2.0f), 0.0f, 0.0f);
 			omat4x4f_mult(&eye_shift, &central_view, &result);
@@ -301,9 +609,9 @@ static int ohmd_device_getf_unp(ohmd_device* device, ohmd_float_value type, floa
 			return OHMD_S_OK;
 		}
 	case OHMD_RIGHT_EYE_GL_MODELVIEW_MATRIX: {
-			quatf rot = device->rotation;
+			OMATH_ALIGNED quatf rot = device->rotation;
 			oquatf_mult_me(&rot, &device->rotation_correction);
-			mat4x4f central_view, eye_shift, result;
+			OMATH_ALIGNED mat4x4f central_view, eye_shift, result;
 			omat4x4f_init_look_at(&central_view, &rot, &device->position);
 			omat4x4f_init_translate(&eye_shift, -(device->properties.ipd / 2.0f), 0.0f, 0.0f);
 			omat4x4f_mult(&eye_shift, &central_view, &result);
@@ -378,6 +686,12 @@ static int ohmd_device_getf_unp(ohmd_device* device, ohmd_float_value type, floa
 		}
 		return OHMD_S_OK;
 	}
+	case OHMD_FUSION_STATE:
+		if(device->sensor_fusion == NULL)
+			return OHMD_S_UNSUPPORTED;
+
+		ofusion_get_state(device->sensor_fusion, out);
+		return OHMD_S_OK;
 	default:
 		return device->getf(device, type, out);
 	}
@@ -386,7 +700,33 @@ static int ohmd_device_getf_unp(ohmd_device* device, ohmd_float_value type, floa
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_getf(ohmd_device* device, ohmd_float_value type, float* out)
 {
 	ohmd_lock_mutex(device->ctx->update_mutex);
+	if(device->settings.fusion_bank)
+		ohmd_ctx_flush_fusion_bank(device->ctx);
+	ohmd_registry_lock_device(device);
+	ohmd_device_touch(device);
+	ohmd_device_flush_fusion(device);
+	ohmd_device_refresh_pose(device);
 	int ret = ohmd_device_getf_unp(device, type, out);
+	ohmd_registry_unlock_device(device);
+	ohmd_unlock_mutex(device->ctx->update_mutex);
+
+	return ret;
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_getf_batch(ohmd_device* device, const ohmd_float_value* types, float* const* outs, int count)
+{
+	int ret = OHMD_S_OK;
+
+	ohmd_lock_mutex(device->ctx->update_mutex);
+	if(device->settings.fusion_bank)
+		ohmd_ctx_flush_fusion_bank(device->ctx);
+	ohmd_registry_lock_device(device);
+	ohmd_device_touch(device);
+	ohmd_device_flush_fusion(device);
+	ohmd_device_refresh_pose(device);
+	for(int i = 0; i < count && ret == OHMD_S_OK; i++)
+		ret = ohmd_device_getf_unp(device, types[i], outs[i]);
+	ohmd_registry_unlock_device(device);
 	ohmd_unlock_mutex(device->ctx->update_mutex);
 
 	return ret;
@@ -408,6 +748,7 @@ static int ohmd_device_setf_unp(ohmd_device* device, ohmd_float_value type, cons
 		{
 			// adjust rotation correction
 			quatf q;
+			ohmd_device_flush_fusion(device);
 			int ret = device->getf(device, OHMD_ROTATION_QUAT, (float*)&q);
 
 			if(ret != 0){
@@ -439,6 +780,18 @@ static int ohmd_device_setf_unp(ohmd_device* device, ohmd_float_value type, cons
 
 			return device->setf(device, type, in);
 		}
+	case OHMD_FUSION_STATE:
+		{
+			if(device->sensor_fusion == NULL)
+				return OHMD_S_UNSUPPORTED;
+
+			if(!ofusion_set_state(device->sensor_fusion, in)){
+				ohmd_set_error(device->ctx, "fusion state has an incompatible version or is corrupt");
+				return OHMD_S_INVALID_PARAMETER;
+			}
+
+			return OHMD_S_OK;
+		}
 	default:
 		return OHMD_S_INVALID_PARAMETER;
 	}
@@ -447,12 +800,104 @@ static int ohmd_device_setf_unp(ohmd_device* device, ohmd_float_value type, cons
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_setf(ohmd_device* device, ohmd_float_value type, const float* in)
 {
 	ohmd_lock_mutex(device->ctx->update_mutex);
+	ohmd_registry_lock_device(device);
 	int ret = ohmd_device_setf_unp(device, type, in);
+	ohmd_registry_unlock_device(device);
 	ohmd_unlock_mutex(device->ctx->update_mutex);
 
 	return ret;
 }
 
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_push_imu_samples(ohmd_device* device, const ohmd_imu_sample* samples, int count)
+{
+	if(device->push_imu_samples == NULL)
+		return OHMD_S_UNSUPPORTED;
+
+	if(count < 0 || (count > 0 && samples == NULL))
+		return OHMD_S_INVALID_PARAMETER;
+
+	ohmd_lock_mutex(device->ctx->update_mutex);
+	ohmd_registry_lock_device(device);
+	int ret = device->push_imu_samples(device, samples, count);
+	ohmd_registry_unlock_device(device);
+	ohmd_unlock_mutex(device->ctx->update_mutex);
+
+	return ret;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EVENT_LOAD_ACQUIRE(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define EVENT_STORE_RELEASE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire and release semantics
+#define EVENT_LOAD_ACQUIRE(_p) (*(volatile uint32_t*)(_p))
+#define EVENT_STORE_RELEASE(_p, _v) (*(volatile uint32_t*)(_p) = (_v))
+#endif
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_poll_control_events(ohmd_device* device, ohmd_control_event* events, int max_events)
+{
+	ohmd_control_event_queue* q = &device->control_events;
+
+	if(max_events < 0 || (max_events > 0 && events == NULL))
+		return OHMD_S_INVALID_PARAMETER;
+
+	// only takes the lock when idle parking is enabled
+	if(device->idle_timeout_ticks){
+		ohmd_lock_mutex(device->ctx->update_mutex);
+		ohmd_registry_lock_device(device);
+		ohmd_device_touch(device);
+		ohmd_registry_unlock_device(device);
+		ohmd_unlock_mutex(device->ctx->update_mutex);
+	}
+
+	uint32_t read = q->read_index;
+	uint32_t write = EVENT_LOAD_ACQUIRE(&q->write_index);
+	int count = 0;
+
+	while(read != write && count < max_events)
+		events[count++] = q->events[read++ & (OHMD_CONTROL_EVENT_QUEUE_SIZE - 1)];
+
+	EVENT_STORE_RELEASE(&q->read_index, read);
+
+	return count;
+}
+
+void ohmd_device_sample_controls(ohmd_device* device)
+{
+	ohmd_control_event_queue* q = &device->control_events;
+	int count = OHMD_MIN(device->properties.control_count, 64);
+	float state[64];
+
+	// devices that share a report, such as controllers, may not be open
+	if(count == 0 || device->getf == NULL || device->getf(device, OHMD_CONTROLS_STATE, state) != 0)
+		return;
+
+	uint64_t now = 0;
+	uint32_t write = q->write_index;
+	uint32_t read = EVENT_LOAD_ACQUIRE(&q->read_index);
+
+	for(int i = 0; i < count; i++){
+		if(state[i] == q->last_state[i])
+			continue;
+
+		if(now == 0)
+			now = ohmd_monotonic_conv(ohmd_monotonic_get(device->ctx), ohmd_monotonic_per_sec(device->ctx), 1000000000);
+
+		// drop the change if the application isn't reading events, the state stays correct
+		if(write - read < OHMD_CONTROL_EVENT_QUEUE_SIZE){
+			ohmd_control_event* ev = &q->events[write++ & (OHMD_CONTROL_EVENT_QUEUE_SIZE - 1)];
+			ev->timestamp_ns = now;
+			ev->control = i;
+			ev->old_value = q->last_state[i];
+			ev->new_value = state[i];
+		}
+
+		q->last_state[i] = state[i];
+	}
+
+	EVENT_STORE_RELEASE(&q->write_index, write);
+}
+
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_geti(ohmd_device* device, ohmd_int_value type, int* out)
 {
 	switch(type){
@@ -501,6 +946,12 @@ static int ohmd_device_set_data_unp(ohmd_device* device, ohmd_data_value type, c
 			device->set_data(device, OHMD_DRIVER_PROPERTIES, in);
 			return OHMD_S_OK;
 
+    case OHMD_EXTERNAL_STREAM_SOURCE:
+			if(device->set_data == NULL)
+				return OHMD_S_UNSUPPORTED;
+
+			return device->set_data(device, OHMD_EXTERNAL_STREAM_SOURCE, in);
+
     default:
       return OHMD_S_INVALID_PARAMETER;
     }
@@ -509,7 +960,9 @@ static int ohmd_device_set_data_unp(ohmd_device* device, ohmd_data_value type, c
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_set_data(ohmd_device* device, ohmd_data_value type, const void* in)
 {
 	ohmd_lock_mutex(device->ctx->update_mutex);
+	ohmd_registry_lock_device(device);
 	int ret = ohmd_device_set_data_unp(device, type, in);
+	ohmd_registry_unlock_device(device);
 	ohmd_unlock_mutex(device->ctx->update_mutex);
 
 	return ret;
@@ -522,6 +975,38 @@ OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device
 		settings->automatic_update = val[0] == 0 ? false : true;
 		return OHMD_S_OK;
 
+	case OHMD_IDS_IDLE_TIMEOUT_MS:
+		if(val[0] < 0)
+			return OHMD_S_INVALID_PARAMETER;
+		settings->idle_timeout_ms = val[0];
+		return OHMD_S_OK;
+
+	case OHMD_IDS_LAZY_FUSION_SAMPLES:
+		if(val[0] < 0)
+			return OHMD_S_INVALID_PARAMETER;
+		settings->lazy_fusion_samples = val[0];
+		return OHMD_S_OK;
+
+	case OHMD_IDS_FUSION_ENGINE:
+		if(val[0] != OHMD_FUSION_DEFAULT && ofusion_get_engine(val[0]) == NULL)
+			return OHMD_S_INVALID_PARAMETER;
+		settings->fusion_engine = val[0];
+		return OHMD_S_OK;
+
+	case OHMD_IDS_READER_THREAD:
+		settings->reader_thread = val[0] == 0 ? false : true;
+		return OHMD_S_OK;
+
+	case OHMD_IDS_PREINTEGRATE_SAMPLES:
+		if(val[0] < 0 || val[0] > FUSION_MAX_PREINTEGRATE)
+			return OHMD_S_INVALID_PARAMETER;
+		settings->preintegrate_samples = val[0];
+		return OHMD_S_OK;
+
+	case OHMD_IDS_FUSION_BANK:
+		settings->fusion_bank = val[0] == 0 ? false : true;
+		return OHMD_S_OK;
+
 	default:
 		return OHMD_S_INVALID_PARAMETER;
 	}
@@ -529,7 +1014,11 @@ OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device
 
 OHMD_APIENTRYDLL ohmd_device_settings* OHMD_APIENTRY ohmd_device_settings_create(ohmd_context* ctx)
 {
-	return ohmd_alloc(ctx, sizeof(ohmd_device_settings));
+	ohmd_device_settings* settings = ohmd_alloc(ctx, sizeof(ohmd_device_settings));
+	if(settings)
+		settings->fusion_engine = OHMD_FUSION_DEFAULT;
+
+	return settings;
 }
 
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_device_settings_destroy(ohmd_device_settings* settings)
@@ -556,7 +1045,7 @@ void ohmd_set_default_device_properties(ohmd_device_properties* props)
 
 void ohmd_calc_default_proj_matrices(ohmd_device_properties* props)
 {
-	mat4x4f proj_base; // base projection matrix
+	OMATH_ALIGNED mat4x4f proj_base; // base projection matrix
 
 	// Calculate where the lens is on each screen,
 	// and with the given value offset the projection matrix.
@@ -574,7 +1063,7 @@ void ohmd_calc_default_proj_matrices(ohmd_device_properties* props)
 	// Setup the two adjusted projection matrices. Each is setup to deal
 	// with the fact that the lens is not in the center of the screen.
 	// These matrices only change of the hardware changes, so static.
-	mat4x4f translate;
+	OMATH_ALIGNED mat4x4f translate;
 
 	omat4x4f_init_translate(&translate, proj_offset, 0, 0);
 	omat4x4f_mult(&translate, &proj_base, &props->proj_left);
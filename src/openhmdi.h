@@ -18,7 +18,9 @@
 
 #include "openhmd.h"
 #include "omath.h"
+#include "fusion.h"
 #include "platform.h"
+#include "stream.h"
 #include "utils.h"
 
 #define OHMD_MAX_DEVICES 16
@@ -33,12 +35,14 @@
 #define OHMD_VERSION_PATCH 0
 
 typedef struct ohmd_driver ohmd_driver;
+typedef struct ohmd_shared_device ohmd_shared_device;
 
 typedef struct {
 	char driver[OHMD_STR_SIZE];
 	char vendor[OHMD_STR_SIZE];
 	char product[OHMD_STR_SIZE];
 	char path[OHMD_STR_SIZE];
+	char serial[OHMD_STR_SIZE];
 	int revision;
 	int id;
 	ohmd_device_flags device_flags;
@@ -86,9 +90,25 @@ typedef struct {
 		float universal_aberration_k[3]; //post-warp per channel scaling [r,g,b]
 } ohmd_device_properties;
 
+#define OHMD_CONTROL_EVENT_QUEUE_SIZE 64 // must be a power of two
+
+// single producer (the driver, while updating), single consumer (ohmd_device_poll_control_events)
+typedef struct {
+	ohmd_control_event events[OHMD_CONTROL_EVENT_QUEUE_SIZE];
+	uint32_t write_index;
+	uint32_t read_index;
+	float last_state[64]; // last values seen by ohmd_device_sample_controls, only touched by the driver
+} ohmd_control_event_queue;
+
 struct ohmd_device_settings
 {
 	bool automatic_update;
+	int idle_timeout_ms;
+	int lazy_fusion_samples;
+	int fusion_engine;
+	bool reader_thread;
+	int preintegrate_samples;
+	bool fusion_bank;
 };
 
 struct ohmd_device {
@@ -101,9 +121,12 @@ struct ohmd_device {
 	int (*setf)(ohmd_device* device, ohmd_float_value type, const float* in);
 	int (*seti)(ohmd_device* device, ohmd_int_value type, const int* in);
 	int (*set_data)(ohmd_device* device, ohmd_data_value type, const void* in);
+	int (*push_imu_samples)(ohmd_device* device, const ohmd_imu_sample* samples, int count);
 
 	void (*update)(ohmd_device* device);
 	void (*close)(ohmd_device* device);
+	// optional, stops or restarts the sensor stream when the device is parked or resumed
+	void (*park)(ohmd_device* device, bool parked);
 
 	ohmd_context* ctx;
 
@@ -111,8 +134,25 @@ struct ohmd_device {
 
 	int active_device_idx; // index into ohmd_device->active_devices[]
 
+	// the pose as of the last ohmd_ctx_update, taken from the driver by the first query after it
 	quatf rotation;
 	vec3f position;
+	bool pose_stale;
+
+	uint32_t stream_count; // updates seen by the udp stream publisher
+	ohmd_stream_batch stream_batch;
+
+	// idle parking, see OHMD_IDS_IDLE_TIMEOUT_MS
+	uint64_t idle_timeout_ticks;
+	uint64_t last_query;
+	bool parked;
+
+	// fusion the driver runs on the host, NULL if the device fuses itself, see OHMD_IDS_LAZY_FUSION_SAMPLES
+	fusion* sensor_fusion;
+
+	ohmd_control_event_queue control_events;
+
+	ohmd_shared_device* shared; // registry entry, NULL for proxies of a device opened elsewhere
 };
 
 
@@ -130,6 +170,16 @@ struct ohmd_context {
 
 	bool update_request_quit;
 
+	ohmd_stream* stream;
+
+	// devices fused together at ohmd_ctx_update(), see OHMD_IDS_FUSION_BANK
+	fusion_bank fusion_bank;
+	fusion* fusion_bank_devices[256];
+
+	// devices closed by this context that are kept open for other contexts, see registry.c
+	int num_lent_devices;
+	bool destroyed;
+
 	uint64_t monotonic_ticks_per_sec;
 
 	char error_msg[OHMD_STR_SIZE];
@@ -145,6 +195,31 @@ void ohmd_calc_default_proj_matrices(ohmd_device_properties* props);
 void ohmd_set_universal_distortion_k(ohmd_device_properties* props, float a, float b, float c, float d);
 void ohmd_set_universal_aberration_k(ohmd_device_properties* props, float r, float g, float b);
 
+// process wide device registry, see registry.c
+// the registry lock must be held for open and close, it is taken before the update mutex of any context
+void ohmd_registry_lock(void);
+void ohmd_registry_unlock(void);
+// opens the device, or a proxy if it is already open in any context
+ohmd_device* ohmd_registry_open(ohmd_context* ctx, ohmd_device_desc* desc);
+// closes the device for its context, returns true if it was kept open for other contexts
+bool ohmd_registry_close(ohmd_device* device);
+// serializes calls into a device with every other context using the same physical device
+void ohmd_registry_lock_device(ohmd_device* device);
+void ohmd_registry_unlock_device(ohmd_device* device);
+// locks every device of the list at once, devices sharing a physical device once, sorts the list to do so
+void ohmd_registry_lock_devices(ohmd_device** devices, int count);
+void ohmd_registry_unlock_devices(ohmd_device** devices, int count);
+// called by the registry when a device closed with ohmd_registry_close has finally been closed
+void ohmd_ctx_return_device(ohmd_context* ctx);
+
+// drivers call this after handling a report that may have changed OHMD_CONTROLS_STATE,
+// compares against the last state and queues a control event for every change
+void ohmd_device_sample_controls(ohmd_device* device);
+
+// starts deferring the sensor fusion of a device until it is queried, keeping at most max_pending samples,
+// or stops it with 0, called with the device locked
+bool ohmd_device_defer_fusion(ohmd_device* device, int max_pending);
+
 // drivers
 ohmd_driver* ohmd_create_dummy_drv(ohmd_context* ctx);
 ohmd_driver* ohmd_create_oculus_rift_drv(ohmd_context* ctx);
@@ -161,6 +236,5 @@ ohmd_driver* ohmd_create_android_drv(ohmd_context* ctx);
 
 #include "log.h"
 #include "omath.h"
-#include "fusion.h"
 
 #endif
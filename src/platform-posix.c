@@ -14,13 +14,24 @@
 #define CLOCK_MONOTONIC (clockid_t)4
 #endif
 
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE
 
 #include <time.h>
 #include <sys/time.h>
 #include <stdio.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "platform.h"
 #include "openhmdi.h"
@@ -173,6 +184,250 @@ void ohmd_unlock_mutex(ohmd_mutex* mutex)
 		pthread_mutex_unlock((pthread_mutex_t*)mutex);
 }
 
+static pthread_mutex_t global_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void ohmd_lock_global(void)
+{
+	pthread_mutex_lock(&global_mutex);
+}
+
+void ohmd_unlock_global(void)
+{
+	pthread_mutex_unlock(&global_mutex);
+}
+
+// udp sockets
+struct ohmd_udp_socket
+{
+	int fd;
+	struct sockaddr_in addr;
+};
+
+static bool is_multicast(const struct sockaddr_in* addr)
+{
+	return IN_MULTICAST(ntohl(addr->sin_addr.s_addr));
+}
+
+static ohmd_udp_socket* udp_open(ohmd_context* ctx, const char* address, int port)
+{
+	ohmd_udp_socket* sock = ohmd_alloc(ctx, sizeof(ohmd_udp_socket));
+	if(!sock)
+		return NULL;
+
+	sock->addr.sin_family = AF_INET;
+	sock->addr.sin_port = htons((uint16_t)port);
+
+	if(inet_pton(AF_INET, address, &sock->addr.sin_addr) != 1){
+		ohmd_set_error(ctx, "invalid IPv4 address: %s", address);
+		free(sock);
+		return NULL;
+	}
+
+	sock->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(sock->fd < 0){
+		ohmd_set_error(ctx, "could not create socket: %s", strerror(errno));
+		free(sock);
+		return NULL;
+	}
+
+	fcntl(sock->fd, F_SETFL, fcntl(sock->fd, F_GETFL, 0) | O_NONBLOCK);
+
+	return sock;
+}
+
+ohmd_udp_socket* ohmd_udp_open_sender(ohmd_context* ctx, const char* address, int port)
+{
+	ohmd_udp_socket* sock = udp_open(ctx, address, port);
+	if(!sock)
+		return NULL;
+
+	int one = 1;
+	setsockopt(sock->fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+
+	if(is_multicast(&sock->addr)){
+		// stay on the local network and let listeners on this host receive it too
+		unsigned char ttl = 1, loop = 1;
+		setsockopt(sock->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+		setsockopt(sock->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+	}
+
+	return sock;
+}
+
+ohmd_udp_socket* ohmd_udp_open_receiver(ohmd_context* ctx, const char* address, int port)
+{
+	ohmd_udp_socket* sock = udp_open(ctx, address, port);
+	if(!sock)
+		return NULL;
+
+	int one = 1;
+	setsockopt(sock->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	struct sockaddr_in bind_addr = sock->addr;
+	if(is_multicast(&sock->addr))
+		bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if(bind(sock->fd, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) != 0){
+		ohmd_set_error(ctx, "could not bind to %s:%d: %s", address, port, strerror(errno));
+		ohmd_udp_close(sock);
+		return NULL;
+	}
+
+	if(is_multicast(&sock->addr)){
+		struct ip_mreq mreq;
+		mreq.imr_multiaddr = sock->addr.sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+		if(setsockopt(sock->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0){
+			ohmd_set_error(ctx, "could not join multicast group %s: %s", address, strerror(errno));
+			ohmd_udp_close(sock);
+			return NULL;
+		}
+	}
+
+	return sock;
+}
+
+void ohmd_udp_close(ohmd_udp_socket* sock)
+{
+	close(sock->fd);
+	free(sock);
+}
+
+int ohmd_udp_send(ohmd_udp_socket* sock, const void* data, int size)
+{
+	return (int)sendto(sock->fd, data, size, 0, (struct sockaddr*)&sock->addr, sizeof(sock->addr));
+}
+
+int ohmd_udp_recv(ohmd_udp_socket* sock, void* data, int size)
+{
+	return (int)recv(sock->fd, data, size, 0);
+}
+
+// shared memory
+void* ohmd_shm_map(const char* name, size_t* size, bool create)
+{
+	int fd = shm_open(name, create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+	if(fd < 0)
+		return NULL;
+
+	if(create){
+		if(ftruncate(fd, *size) != 0){
+			close(fd);
+			shm_unlink(name);
+			return NULL;
+		}
+	}else{
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size <= 0){
+			close(fd);
+			return NULL;
+		}
+		*size = (size_t)st.st_size;
+	}
+
+	void* ptr = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(ptr == MAP_FAILED){
+		if(create)
+			shm_unlink(name);
+		return NULL;
+	}
+
+	return ptr;
+}
+
+void ohmd_shm_unmap(void* ptr, size_t size)
+{
+	munmap(ptr, size);
+}
+
+void ohmd_shm_unlink(const char* name)
+{
+	shm_unlink(name);
+}
+
+// processes
+int64_t ohmd_process_id(void)
+{
+	return (int64_t)getpid();
+}
+
+bool ohmd_process_alive(int64_t pid)
+{
+	// EPERM is a running process of another user
+	return pid > 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+// unix domain sockets
+struct ohmd_unix_socket
+{
+	int fd;
+};
+
+ohmd_unix_socket* ohmd_unix_connect(ohmd_context* ctx, const char* path)
+{
+	struct sockaddr_un addr;
+
+	if(strlen(path) >= sizeof(addr.sun_path)){
+		ohmd_set_error(ctx, "socket path too long: %s", path);
+		return NULL;
+	}
+
+	ohmd_unix_socket* sock = ohmd_alloc(ctx, sizeof(ohmd_unix_socket));
+	if(!sock)
+		return NULL;
+
+	sock->fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if(sock->fd < 0){
+		ohmd_set_error(ctx, "could not create socket: %s", strerror(errno));
+		free(sock);
+		return NULL;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if(connect(sock->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+		ohmd_set_error(ctx, "could not connect to %s: %s", path, strerror(errno));
+		ohmd_unix_close(sock);
+		return NULL;
+	}
+
+	fcntl(sock->fd, F_SETFL, fcntl(sock->fd, F_GETFL, 0) | O_NONBLOCK);
+
+	return sock;
+}
+
+void ohmd_unix_close(ohmd_unix_socket* sock)
+{
+	close(sock->fd);
+	free(sock);
+}
+
+int ohmd_unix_recv(ohmd_unix_socket* sock, void* data, int size)
+{
+	struct iovec iov = { data, (size_t)size };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	ssize_t ret = recvmsg(sock->fd, &msg, 0);
+
+	if(ret < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -1 : 0;
+
+	// the kernel drops the rest of a message that is too large
+	if(msg.msg_flags & MSG_TRUNC)
+		return size + 1;
+
+	// a zero sized message can't be told apart from a hang up, treat it as one
+	return (int)ret;
+}
+
 /// Handling ovr service
 void ohmd_toggle_ovr_service(int state) //State is 0 for Disable, 1 for Enable
 {
@@ -13,6 +13,8 @@
 #define WIN32_LEAN_AND_MEAN
 #define WIN32_EXTRA_LEAN
 
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
 
 #include "platform.h"
@@ -121,6 +123,18 @@ void ohmd_unlock_mutex(ohmd_mutex* mutex)
 		ReleaseMutex(mutex->handle);
 }
 
+static SRWLOCK global_lock = SRWLOCK_INIT;
+
+void ohmd_lock_global(void)
+{
+	AcquireSRWLockExclusive(&global_lock);
+}
+
+void ohmd_unlock_global(void)
+{
+	ReleaseSRWLockExclusive(&global_lock);
+}
+
 int findEndPoint(char* path, int endpoint)
 {
 	char comp[8];
@@ -133,6 +147,218 @@ int findEndPoint(char* path, int endpoint)
 	return 0;
 }
 
+// udp sockets
+struct ohmd_udp_socket
+{
+	SOCKET fd;
+	struct sockaddr_in addr;
+};
+
+static bool is_multicast(const struct sockaddr_in* addr)
+{
+	return IN_MULTICAST(ntohl(addr->sin_addr.s_addr));
+}
+
+// every socket holds a reference on winsock, WSAStartup() and WSACleanup() count them
+static ohmd_udp_socket* udp_open(ohmd_context* ctx, const char* address, int port)
+{
+	WSADATA wsa;
+	if(WSAStartup(MAKEWORD(2, 2), &wsa) != 0){
+		ohmd_set_error(ctx, "could not initialize winsock");
+		return NULL;
+	}
+
+	ohmd_udp_socket* sock = ohmd_alloc(ctx, sizeof(ohmd_udp_socket));
+	if(!sock){
+		WSACleanup();
+		return NULL;
+	}
+
+	// WSAStringToAddressA takes a writable string, and is there on every version unlike inet_pton
+	char ip[64];
+	int addr_size = sizeof(sock->addr);
+	snprintf(ip, sizeof(ip), "%s", address);
+
+	if(WSAStringToAddressA(ip, AF_INET, NULL, (struct sockaddr*)&sock->addr, &addr_size) != 0){
+		ohmd_set_error(ctx, "invalid IPv4 address: %s", address);
+		free(sock);
+		WSACleanup();
+		return NULL;
+	}
+
+	sock->addr.sin_family = AF_INET;
+	sock->addr.sin_port = htons((u_short)port);
+
+	sock->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(sock->fd == INVALID_SOCKET){
+		ohmd_set_error(ctx, "could not create socket: error %d", WSAGetLastError());
+		free(sock);
+		WSACleanup();
+		return NULL;
+	}
+
+	u_long nonblocking = 1;
+	ioctlsocket(sock->fd, FIONBIO, &nonblocking);
+
+	return sock;
+}
+
+ohmd_udp_socket* ohmd_udp_open_sender(ohmd_context* ctx, const char* address, int port)
+{
+	ohmd_udp_socket* sock = udp_open(ctx, address, port);
+	if(!sock)
+		return NULL;
+
+	BOOL one = TRUE;
+	setsockopt(sock->fd, SOL_SOCKET, SO_BROADCAST, (const char*)&one, sizeof(one));
+
+	if(is_multicast(&sock->addr)){
+		// stay on the local network and let listeners on this host receive it too
+		DWORD ttl = 1, loop = 1;
+		setsockopt(sock->fd, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+		setsockopt(sock->fd, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof(loop));
+	}
+
+	return sock;
+}
+
+ohmd_udp_socket* ohmd_udp_open_receiver(ohmd_context* ctx, const char* address, int port)
+{
+	ohmd_udp_socket* sock = udp_open(ctx, address, port);
+	if(!sock)
+		return NULL;
+
+	BOOL one = TRUE;
+	setsockopt(sock->fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+	struct sockaddr_in bind_addr = sock->addr;
+	if(is_multicast(&sock->addr))
+		bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if(bind(sock->fd, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) != 0){
+		ohmd_set_error(ctx, "could not bind to %s:%d: error %d", address, port, WSAGetLastError());
+		ohmd_udp_close(sock);
+		return NULL;
+	}
+
+	if(is_multicast(&sock->addr)){
+		struct ip_mreq mreq;
+		mreq.imr_multiaddr = sock->addr.sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+		if(setsockopt(sock->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) != 0){
+			ohmd_set_error(ctx, "could not join multicast group %s: error %d", address, WSAGetLastError());
+			ohmd_udp_close(sock);
+			return NULL;
+		}
+	}
+
+	return sock;
+}
+
+void ohmd_udp_close(ohmd_udp_socket* sock)
+{
+	closesocket(sock->fd);
+	free(sock);
+	WSACleanup();
+}
+
+int ohmd_udp_send(ohmd_udp_socket* sock, const void* data, int size)
+{
+	return sendto(sock->fd, (const char*)data, size, 0, (const struct sockaddr*)&sock->addr, sizeof(sock->addr));
+}
+
+int ohmd_udp_recv(ohmd_udp_socket* sock, void* data, int size)
+{
+	return recv(sock->fd, (char*)data, size, 0);
+}
+
+// shared memory, a named mapping of the paging file
+void* ohmd_shm_map(const char* name, size_t* size, bool create)
+{
+	HANDLE mapping;
+	if(create){
+		uint64_t bytes = *size;
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, name);
+
+		// an existing mapping is handed back as it is, somebody else owns it
+		if(mapping && GetLastError() == ERROR_ALREADY_EXISTS){
+			CloseHandle(mapping);
+			return NULL;
+		}
+	}else{
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	}
+
+	if(!mapping)
+		return NULL;
+
+	// the view keeps the mapping alive once the handle is closed
+	void* ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, create ? *size : 0);
+	CloseHandle(mapping);
+
+	if(!ptr)
+		return NULL;
+
+	if(!create){
+		// whole pages, at least what the creator asked for
+		MEMORY_BASIC_INFORMATION info;
+		if(VirtualQuery(ptr, &info, sizeof(info)) == 0){
+			UnmapViewOfFile(ptr);
+			return NULL;
+		}
+		*size = info.RegionSize;
+	}
+
+	return ptr;
+}
+
+void ohmd_shm_unmap(void* ptr, size_t size)
+{
+	UnmapViewOfFile(ptr);
+}
+
+void ohmd_shm_unlink(const char* name)
+{
+	// the mapping goes away with its last view, there is no name to remove
+}
+
+// processes
+int64_t ohmd_process_id(void)
+{
+	return (int64_t)GetCurrentProcessId();
+}
+
+bool ohmd_process_alive(int64_t pid)
+{
+	if(pid <= 0)
+		return false;
+
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+	if(!process)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return alive;
+}
+
+// SOCK_SEQPACKET unix domain sockets don't exist on windows, the external driver refuses "unix:" sources
+ohmd_unix_socket* ohmd_unix_connect(ohmd_context* ctx, const char* path)
+{
+	ohmd_set_error(ctx, "unix domain sockets are not supported on this platform");
+	return NULL;
+}
+
+void ohmd_unix_close(ohmd_unix_socket* sock)
+{
+}
+
+int ohmd_unix_recv(ohmd_unix_socket* sock, void* data, int size)
+{
+	return 0;
+}
+
 /// Handling ovr service
 static int _enable_ovr_service = 0;
 
@@ -11,6 +11,9 @@
 #ifndef PLATFORM_H
 #define PLATFORM_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "openhmd.h"
 
 double ohmd_get_tick();
@@ -25,9 +28,48 @@ void ohmd_destroy_mutex(ohmd_mutex* mutex);
 void ohmd_lock_mutex(ohmd_mutex* mutex);
 void ohmd_unlock_mutex(ohmd_mutex* mutex);
 
+// a single statically initialized lock for state that is shared by all contexts in the process
+void ohmd_lock_global(void);
+void ohmd_unlock_global(void);
+
 ohmd_thread* ohmd_create_thread(ohmd_context* ctx, unsigned int (*routine)(void* arg), void* arg);
 void ohmd_destroy_thread(ohmd_thread* thread);
 
+/* UDP sockets, IPv4 only, all calls are non-blocking */
+
+typedef struct ohmd_udp_socket ohmd_udp_socket;
+
+ohmd_udp_socket* ohmd_udp_open_sender(ohmd_context* ctx, const char* address, int port);
+ohmd_udp_socket* ohmd_udp_open_receiver(ohmd_context* ctx, const char* address, int port);
+void ohmd_udp_close(ohmd_udp_socket* sock);
+
+int ohmd_udp_send(ohmd_udp_socket* sock, const void* data, int size);
+int ohmd_udp_recv(ohmd_udp_socket* sock, void* data, int size);
+
+/* Named shared memory, size is the size to create or returns the size found when attaching,
+   creating fails if the name is taken, an existing region is never cleared */
+
+void* ohmd_shm_map(const char* name, size_t* size, bool create);
+void ohmd_shm_unmap(void* ptr, size_t size);
+void ohmd_shm_unlink(const char* name);
+
+/* Processes */
+
+int64_t ohmd_process_id(void);
+// false once the process has exited, ids of 0 or less are never running
+bool ohmd_process_alive(int64_t pid);
+
+/* Connected SOCK_SEQPACKET unix domain sockets, non-blocking */
+
+typedef struct ohmd_unix_socket ohmd_unix_socket;
+
+ohmd_unix_socket* ohmd_unix_connect(ohmd_context* ctx, const char* path);
+void ohmd_unix_close(ohmd_unix_socket* sock);
+
+// returns the message size, more than size if the message didn't fit and was cut off, -1 if no message is pending
+// and 0 once the peer has gone away
+int ohmd_unix_recv(ohmd_unix_socket* sock, void* data, int size);
+
 /* String functions */
 
 int findEndPoint(char* path, int endpoint);
@@ -0,0 +1,444 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Compressed Pose Encoding Implementation */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "posecodec.h"
+
+#define ROTATION_BITS 15
+#define ROTATION_MAX ((1 << ROTATION_BITS) - 1)
+#define ROTATION_RANGE 0.70710678f // the smallest three are within +-sqrt(1/2)
+#define POSITION_LIMIT (1 << 30)   // 107 km either way, positions beyond are clamped
+#define LOG_HEADER_SIZE 24
+#define LOG_BLOCK_SIZE 16
+
+static int put_varint(unsigned char* out, uint64_t v)
+{
+	int n = 0;
+	while(v >= 0x80){
+		out[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	out[n++] = (unsigned char)v;
+	return n;
+}
+
+// returns the bytes read, 0 if the varint doesn't end within size bytes or is longer than ten
+static int get_varint(const unsigned char* in, int size, uint64_t* v)
+{
+	*v = 0;
+	for(int n = 0; n < size && n < 10; n++){
+		*v |= (uint64_t)(in[n] & 0x7f) << (7 * n);
+		if(!(in[n] & 0x80))
+			return n + 1;
+	}
+	return 0;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int32_t quantize_position(float v)
+{
+	float q = v / OHMD_POSE_POSITION_UNIT;
+	if(!(q > -POSITION_LIMIT))
+		return q != q ? 0 : -POSITION_LIMIT; // NaN as the origin
+	if(q > POSITION_LIMIT)
+		return POSITION_LIMIT;
+	return (int32_t)lrintf(q);
+}
+
+void ohmd_pose_pack_rotation(const quatf* rotation, bool flag, unsigned char out[6])
+{
+	quatf q = *rotation;
+	float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	int largest = 0;
+
+	if(!(length > 0)){
+		quatf identity = {{ 0, 0, 0, 1 }};
+		q = identity;
+		length = 1;
+	}
+
+	for(int i = 1; i < 4; i++)
+		if(fabsf(q.arr[i]) > fabsf(q.arr[largest]))
+			largest = i;
+
+	// q and -q are the same rotation, the largest component is left out as a positive one
+	float scale = (q.arr[largest] < 0 ? -1.0f : 1.0f) / length;
+
+	uint64_t bits = (uint64_t)(flag ? 1 : 0) << 47 | (uint64_t)largest << 45;
+	for(int i = 0, shift = 30; i < 4; i++){
+		if(i == largest)
+			continue;
+
+		long quantized = lrintf((q.arr[i] * scale / ROTATION_RANGE * 0.5f + 0.5f) * ROTATION_MAX);
+		quantized = quantized < 0 ? 0 : quantized > ROTATION_MAX ? ROTATION_MAX : quantized;
+		bits |= (uint64_t)quantized << shift;
+		shift -= ROTATION_BITS;
+	}
+
+	for(int i = 0; i < 6; i++)
+		out[i] = (unsigned char)(bits >> (8 * i));
+}
+
+bool ohmd_pose_unpack_rotation(const unsigned char in[6], quatf* rotation)
+{
+	uint64_t bits = 0;
+	for(int i = 0; i < 6; i++)
+		bits |= (uint64_t)in[i] << (8 * i);
+
+	int largest = (int)(bits >> 45) & 3;
+	float sum = 0;
+
+	for(int i = 0, shift = 30; i < 4; i++){
+		if(i == largest)
+			continue;
+
+		uint32_t quantized = (uint32_t)(bits >> shift) & ROTATION_MAX;
+		float v = (float)quantized * (2.0f * ROTATION_RANGE / ROTATION_MAX) - ROTATION_RANGE;
+		rotation->arr[i] = v;
+		sum += v * v;
+		shift -= ROTATION_BITS;
+	}
+
+	rotation->arr[largest] = sum < 1.0f ? sqrtf(1.0f - sum) : 0;
+
+	return (bits >> 47) & 1;
+}
+
+void ohmd_pose_codec_reset(ohmd_pose_codec* codec)
+{
+	memset(codec, 0, sizeof(ohmd_pose_codec));
+}
+
+int ohmd_pose_encode(ohmd_pose_codec* codec, const ohmd_pose* pose, bool key, unsigned char* out)
+{
+	int32_t position[3];
+	int n = 6;
+
+	key = key || !codec->have_key;
+	ohmd_pose_pack_rotation(&pose->rotation, key, out);
+
+	for(int i = 0; i < 3; i++)
+		position[i] = quantize_position(pose->position.arr[i]);
+
+	if(key){
+		n += put_varint(out + n, pose->timestamp_ns);
+		for(int i = 0; i < 3; i++)
+			n += put_varint(out + n, zigzag(position[i]));
+
+		codec->have_key = true;
+		codec->interval_ns = 0;
+	}else{
+		int64_t interval = (int64_t)(pose->timestamp_ns - codec->timestamp_ns);
+		n += put_varint(out + n, zigzag(interval - codec->interval_ns));
+		for(int i = 0; i < 3; i++)
+			n += put_varint(out + n, zigzag((int64_t)position[i] - codec->position[i]));
+
+		codec->interval_ns = interval;
+	}
+
+	codec->timestamp_ns = pose->timestamp_ns;
+	memcpy(codec->position, position, sizeof(position));
+
+	return n;
+}
+
+int ohmd_pose_decode(ohmd_pose_codec* codec, const unsigned char* in, int size, ohmd_pose* pose)
+{
+	uint64_t v[4];
+	int n = 6;
+
+	if(size < 6)
+		return 0;
+
+	for(int i = 0; i < 4; i++){
+		int len = get_varint(in + n, size - n, v + i);
+		if(len == 0)
+			return 0;
+		n += len;
+	}
+
+	bool key = ohmd_pose_unpack_rotation(in, &pose->rotation);
+
+	if(key){
+		codec->have_key = true;
+		codec->interval_ns = 0;
+		codec->timestamp_ns = v[0];
+		for(int i = 0; i < 3; i++)
+			codec->position[i] = (int32_t)unzigzag(v[i + 1]);
+	}else{
+		if(!codec->have_key)
+			return -1;
+
+		codec->interval_ns += unzigzag(v[0]);
+		codec->timestamp_ns += (uint64_t)codec->interval_ns;
+		for(int i = 0; i < 3; i++)
+			codec->position[i] += (int32_t)unzigzag(v[i + 1]);
+	}
+
+	pose->timestamp_ns = codec->timestamp_ns;
+	for(int i = 0; i < 3; i++)
+		pose->position.arr[i] = (float)codec->position[i] * OHMD_POSE_POSITION_UNIT;
+
+	return n;
+}
+
+void ohmd_pose_log_init(ohmd_pose_log* log, int block_poses)
+{
+	memset(log, 0, sizeof(ohmd_pose_log));
+	log->block_poses = block_poses > 0 ? block_poses : 1;
+}
+
+void ohmd_pose_log_free(ohmd_pose_log* log)
+{
+	free(log->data);
+	free(log->blocks);
+	ohmd_pose_log_init(log, log->block_poses);
+}
+
+// returns the buffer with room for needed > 0 items, NULL if it could not grow, the old one is kept then
+static void* reserve(void* buffer, uint32_t* capacity, uint32_t needed, size_t item_size)
+{
+	if(needed <= *capacity)
+		return buffer;
+
+	uint32_t grown = *capacity ? *capacity : 256;
+	while(grown < needed)
+		grown *= 2;
+
+	void* resized = realloc(buffer, (size_t)grown * item_size);
+	if(resized)
+		*capacity = grown;
+
+	return resized;
+}
+
+bool ohmd_pose_log_append(ohmd_pose_log* log, const ohmd_pose* pose)
+{
+	bool key = log->num_blocks == 0 || log->count - log->blocks[log->num_blocks - 1].first >= (uint32_t)log->block_poses;
+
+	unsigned char* data = reserve(log->data, &log->capacity, log->size + OHMD_POSE_MAX_RECORD, 1);
+	if(!data)
+		return false;
+	log->data = data;
+
+	ohmd_pose_block* blocks = reserve(log->blocks, &log->blocks_capacity, log->num_blocks + 1, sizeof(ohmd_pose_block));
+	if(!blocks)
+		return false;
+	log->blocks = blocks;
+
+	if(key){
+		ohmd_pose_block* block = log->blocks + log->num_blocks++;
+		block->timestamp_ns = pose->timestamp_ns;
+		block->offset = log->size;
+		block->first = log->count;
+	}
+
+	log->size += ohmd_pose_encode(&log->encoder, pose, key, log->data + log->size);
+	log->count++;
+
+	return true;
+}
+
+bool ohmd_pose_log_find(const ohmd_pose_log* log, uint64_t timestamp_ns, ohmd_pose* pose)
+{
+	if(log->num_blocks == 0 || timestamp_ns < log->blocks[0].timestamp_ns)
+		return false;
+
+	// the last block starting at or before the time
+	int lo = 0, hi = log->num_blocks - 1;
+	while(lo < hi){
+		int mid = (lo + hi + 1) / 2;
+		if(log->blocks[mid].timestamp_ns <= timestamp_ns)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	uint32_t offset = log->blocks[lo].offset;
+	uint32_t end = lo + 1 < log->num_blocks ? log->blocks[lo + 1].offset : log->size;
+	ohmd_pose_codec decoder;
+	ohmd_pose next;
+
+	// a block that doesn't start with a whole key record has nothing to go on
+	ohmd_pose_codec_reset(&decoder);
+	int n = ohmd_pose_decode(&decoder, log->data + offset, end - offset, pose);
+	if(n <= 0)
+		return false;
+	offset += n;
+
+	while(offset < end){
+		n = ohmd_pose_decode(&decoder, log->data + offset, end - offset, &next);
+		if(n <= 0 || next.timestamp_ns > timestamp_ns)
+			break;
+
+		*pose = next;
+		offset += n;
+	}
+
+	return true;
+}
+
+void ohmd_pose_log_trim(ohmd_pose_log* log, uint64_t timestamp_ns)
+{
+	// a block is over once the next one starts, the last one never is
+	int drop = 0;
+	while(drop + 1 < log->num_blocks && log->blocks[drop + 1].timestamp_ns <= timestamp_ns)
+		drop++;
+
+	if(drop == 0)
+		return;
+
+	uint32_t bytes = log->blocks[drop].offset;
+	memmove(log->data, log->data + bytes, log->size - bytes);
+	log->size -= bytes;
+
+	memmove(log->blocks, log->blocks + drop, sizeof(ohmd_pose_block) * (log->num_blocks - drop));
+	log->num_blocks -= drop;
+	for(int i = 0; i < log->num_blocks; i++)
+		log->blocks[i].offset -= bytes;
+}
+
+uint32_t ohmd_pose_log_count(const ohmd_pose_log* log)
+{
+	return log->num_blocks > 0 ? log->count - log->blocks[0].first : 0;
+}
+
+static void put_u32(unsigned char* out, uint32_t v)
+{
+	for(int i = 0; i < 4; i++)
+		out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char* in)
+{
+	return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+bool ohmd_pose_log_save(const ohmd_pose_log* log, FILE* file)
+{
+	unsigned char header[LOG_HEADER_SIZE];
+
+	put_u32(header, OHMD_POSE_LOG_MAGIC);
+	put_u32(header + 4, OHMD_POSE_LOG_VERSION);
+	put_u32(header + 8, (uint32_t)log->block_poses);
+	put_u32(header + 12, log->count);
+	put_u32(header + 16, (uint32_t)log->num_blocks);
+	put_u32(header + 20, log->size);
+
+	if(fwrite(header, sizeof(header), 1, file) != 1)
+		return false;
+
+	for(int i = 0; i < log->num_blocks; i++){
+		unsigned char block[LOG_BLOCK_SIZE];
+		put_u32(block, (uint32_t)log->blocks[i].timestamp_ns);
+		put_u32(block + 4, (uint32_t)(log->blocks[i].timestamp_ns >> 32));
+		put_u32(block + 8, log->blocks[i].offset);
+		put_u32(block + 12, log->blocks[i].first);
+
+		if(fwrite(block, sizeof(block), 1, file) != 1)
+			return false;
+	}
+
+	return log->size == 0 || fwrite(log->data, log->size, 1, file) == 1;
+}
+
+bool ohmd_pose_log_load(ohmd_pose_log* log, FILE* file)
+{
+	unsigned char header[LOG_HEADER_SIZE];
+
+	if(fread(header, sizeof(header), 1, file) != 1 || get_u32(header) != OHMD_POSE_LOG_MAGIC ||
+	   get_u32(header + 4) != OHMD_POSE_LOG_VERSION)
+		return false;
+
+	ohmd_pose_log loaded;
+	ohmd_pose_log_init(&loaded, (int)get_u32(header + 8));
+	uint32_t count = get_u32(header + 12), num_blocks = get_u32(header + 16), size = get_u32(header + 20);
+
+	if(num_blocks > size || (num_blocks == 0) != (size == 0))
+		goto fail;
+
+	if(num_blocks > 0){
+		loaded.blocks = reserve(NULL, &loaded.blocks_capacity, num_blocks, sizeof(ohmd_pose_block));
+		loaded.data = reserve(NULL, &loaded.capacity, size, 1);
+		if(!loaded.blocks || !loaded.data)
+			goto fail;
+	}
+
+	for(uint32_t i = 0; i < num_blocks; i++){
+		unsigned char block[LOG_BLOCK_SIZE];
+		if(fread(block, sizeof(block), 1, file) != 1)
+			goto fail;
+
+		ohmd_pose_block* b = loaded.blocks + i;
+		b->timestamp_ns = (uint64_t)get_u32(block) | (uint64_t)get_u32(block + 4) << 32;
+		b->offset = get_u32(block + 8);
+		b->first = get_u32(block + 12);
+
+		if(b->offset >= size || b->first >= count || (i == 0 && b->offset != 0) ||
+		   (i > 0 && (b->offset <= b[-1].offset || b->first <= b[-1].first)))
+			goto fail;
+	}
+
+	if(size > 0 && fread(loaded.data, size, 1, file) != 1)
+		goto fail;
+
+	// every block starts with a key record of its time, finding a pose decodes from there
+	for(uint32_t i = 0; i < num_blocks; i++){
+		const ohmd_pose_block* b = loaded.blocks + i;
+		uint32_t end = i + 1 < num_blocks ? b[1].offset : size;
+		ohmd_pose_codec decoder;
+		ohmd_pose pose;
+
+		ohmd_pose_codec_reset(&decoder);
+		if(ohmd_pose_decode(&decoder, loaded.data + b->offset, end - b->offset, &pose) <= 0 ||
+		   pose.timestamp_ns != b->timestamp_ns)
+			goto fail;
+	}
+
+	loaded.size = size;
+	loaded.num_blocks = (int)num_blocks;
+	loaded.count = count;
+
+	// appending carries on from the last record, every record of the last block has to decode for that
+	if(num_blocks > 0){
+		const ohmd_pose_block* last = loaded.blocks + num_blocks - 1;
+		uint32_t offset = last->offset, decoded = 0;
+		ohmd_pose pose;
+
+		while(offset < size){
+			int n = ohmd_pose_decode(&loaded.encoder, loaded.data + offset, size - offset, &pose);
+			if(n <= 0)
+				goto fail;
+			offset += n;
+			decoded++;
+		}
+
+		if(decoded != count - last->first)
+			goto fail;
+	}
+
+	ohmd_pose_log_free(log);
+	*log = loaded;
+	return true;
+
+fail:
+	ohmd_pose_log_free(&loaded);
+	return false;
+}
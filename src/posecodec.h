@@ -0,0 +1,94 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Compressed Pose Encoding - Internal Interface */
+
+/*
+ * A pose is 36 bytes as floats and a timestamp, a record of this encoding is about 11 for a tracked device at 1 kHz.
+ * The rotation is packed as the smallest three components of the quaternion, 15 bits each plus the index of the
+ * largest, within 0.01 degrees. The position is quantized to OHMD_POSE_POSITION_UNIT and stored as the difference
+ * to the previous record, the timestamp as the change of the interval between records, both as zigzag varints.
+ *
+ * A key record stores the timestamp and the position as they are, so decoding can start at any key record. The key
+ * flag is the spare bit of the packed rotation, the records need no framing of their own. A pose log starts a block
+ * with a key record every so many poses and keeps an index of the blocks for finding a pose by time.
+ */
+
+#ifndef POSECODEC_H
+#define POSECODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "omath.h"
+
+#define OHMD_POSE_POSITION_UNIT 0.0001f // meters, positions are rounded to a tenth of a millimeter
+#define OHMD_POSE_MAX_RECORD 31         // bytes, the packed rotation plus four varints at their longest
+#define OHMD_POSE_LOG_MAGIC 0x4c50484f  // "OHPL" in a pose log file
+#define OHMD_POSE_LOG_VERSION 1
+
+typedef struct {
+	uint64_t timestamp_ns;
+	quatf rotation;
+	vec3f position;
+} ohmd_pose;
+
+// what the previous record left for the next one, the encoder and the decoder keep the same
+typedef struct {
+	bool have_key;
+	uint64_t timestamp_ns;
+	int64_t interval_ns;
+	int32_t position[3]; // in OHMD_POSE_POSITION_UNIT
+} ohmd_pose_codec;
+
+// the next record must be a key record
+void ohmd_pose_codec_reset(ohmd_pose_codec* codec);
+
+// writes the record of pose to out, a key record if asked to or if there was none yet, returns its size
+int ohmd_pose_encode(ohmd_pose_codec* codec, const ohmd_pose* pose, bool key, unsigned char* out);
+// reads one record, returns its size, 0 if size bytes don't hold a whole one or -1 if it needs a key record first
+int ohmd_pose_decode(ohmd_pose_codec* codec, const unsigned char* in, int size, ohmd_pose* pose);
+
+// the rotation alone, as in the records, for formats that store the rest as they like
+void ohmd_pose_pack_rotation(const quatf* rotation, bool flag, unsigned char out[6]);
+bool ohmd_pose_unpack_rotation(const unsigned char in[6], quatf* rotation); // returns the flag
+
+typedef struct {
+	uint64_t timestamp_ns; // of the key record that starts the block
+	uint32_t offset;       // of that record in the data
+	uint32_t first;        // number of poses before the block, counting trimmed ones
+} ohmd_pose_block;
+
+// poses in time order, each block_poses of them a block starting with a key record
+typedef struct {
+	unsigned char* data;
+	uint32_t size, capacity;
+	ohmd_pose_block* blocks;
+	int num_blocks;
+	uint32_t blocks_capacity;
+	int block_poses;
+	uint32_t count; // poses appended, counting trimmed ones
+	ohmd_pose_codec encoder;
+} ohmd_pose_log;
+
+void ohmd_pose_log_init(ohmd_pose_log* log, int block_poses);
+void ohmd_pose_log_free(ohmd_pose_log* log);
+// returns false if the log could not grow
+bool ohmd_pose_log_append(ohmd_pose_log* log, const ohmd_pose* pose);
+// the last pose at or before timestamp_ns, false if the log starts after it
+bool ohmd_pose_log_find(const ohmd_pose_log* log, uint64_t timestamp_ns, ohmd_pose* pose);
+// drops the blocks that are over before timestamp_ns, for an in-process history of a bounded length
+void ohmd_pose_log_trim(ohmd_pose_log* log, uint64_t timestamp_ns);
+// the poses still in the log
+uint32_t ohmd_pose_log_count(const ohmd_pose_log* log);
+
+// the file is the header, the block index and the records, little endian
+bool ohmd_pose_log_save(const ohmd_pose_log* log, FILE* file);
+// replaces what the log holds, more poses can be appended afterwards, false if the file isn't a pose log
+bool ohmd_pose_log_load(ohmd_pose_log* log, FILE* file);
+
+#endif
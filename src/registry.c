@@ -0,0 +1,327 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Process Wide Device Registry */
+
+/*
+ * Every device opened by a driver is registered here, keyed by driver, path and id. Opening a device that is
+ * already open, in any context, returns a proxy that forwards to the registered device instead of opening the
+ * hardware a second time. All contexts then share one reader and one fusion state.
+ *
+ * Calls into a registered device are serialized by a lock per physical device (driver and path), since drivers
+ * such as the Rift share state between the ids of one physical device. The lock is always taken last, after
+ * the registry lock and the update mutex of a context, and nothing is locked while holding it. The only exception
+ * is ohmd_registry_lock_devices(), which may hold several. It takes them in the order of their addresses, so two
+ * threads locking overlapping sets never wait for each other.
+ */
+
+#include <string.h>
+#include "openhmdi.h"
+
+typedef struct registry_phys registry_phys;
+
+struct registry_phys {
+	char driver[OHMD_STR_SIZE];
+	char path[OHMD_STR_SIZE];
+	ohmd_mutex* lock;
+	int refs; // shared devices using this lock
+	registry_phys* next;
+};
+
+struct ohmd_shared_device {
+	registry_phys* phys;
+	int id;
+	ohmd_device* device; // opened by the driver, belongs to the context that opened it first
+	int refs;            // the owning context while it has the device open, plus one per proxy
+	bool owner_open;
+	ohmd_shared_device* next;
+};
+
+typedef struct {
+	ohmd_device base;
+	ohmd_shared_device* shared;
+} proxy_device;
+
+static registry_phys* phys_list = NULL;
+static ohmd_shared_device* shared_list = NULL;
+
+void ohmd_registry_lock(void)
+{
+	ohmd_lock_global();
+}
+
+void ohmd_registry_unlock(void)
+{
+	ohmd_unlock_global();
+}
+
+void ohmd_registry_lock_device(ohmd_device* device)
+{
+	if(device->shared)
+		ohmd_lock_mutex(device->shared->phys->lock);
+}
+
+void ohmd_registry_unlock_device(ohmd_device* device)
+{
+	if(device->shared)
+		ohmd_unlock_mutex(device->shared->phys->lock);
+}
+
+static uintptr_t device_phys(ohmd_device* device)
+{
+	return device->shared ? (uintptr_t)device->shared->phys : 0;
+}
+
+static int compare_phys(const void* a, const void* b)
+{
+	uintptr_t x = device_phys(*(ohmd_device* const*)a), y = device_phys(*(ohmd_device* const*)b);
+	return x < y ? -1 : x > y;
+}
+
+void ohmd_registry_lock_devices(ohmd_device** devices, int count)
+{
+	qsort(devices, count, sizeof(ohmd_device*), compare_phys);
+
+	for(int i = 0; i < count; i++){
+		if(device_phys(devices[i]) && (i == 0 || device_phys(devices[i]) != device_phys(devices[i - 1])))
+			ohmd_lock_mutex(devices[i]->shared->phys->lock);
+	}
+}
+
+void ohmd_registry_unlock_devices(ohmd_device** devices, int count)
+{
+	for(int i = count - 1; i >= 0; i--){
+		if(device_phys(devices[i]) && (i == 0 || device_phys(devices[i]) != device_phys(devices[i - 1])))
+			ohmd_unlock_mutex(devices[i]->shared->phys->lock);
+	}
+}
+
+static registry_phys* get_phys(ohmd_context* ctx, ohmd_device_desc* desc)
+{
+	for(registry_phys* phys = phys_list; phys; phys = phys->next){
+		if(strcmp(phys->driver, desc->driver) == 0 && strcmp(phys->path, desc->path) == 0){
+			phys->refs++;
+			return phys;
+		}
+	}
+
+	registry_phys* phys = ohmd_alloc(ctx, sizeof(registry_phys));
+	if(!phys)
+		return NULL;
+
+	phys->lock = ohmd_create_mutex(ctx);
+	if(!phys->lock){
+		free(phys);
+		return NULL;
+	}
+
+	strcpy(phys->driver, desc->driver);
+	strcpy(phys->path, desc->path);
+	phys->refs = 1;
+	phys->next = phys_list;
+	phys_list = phys;
+
+	return phys;
+}
+
+static void put_phys(registry_phys* phys)
+{
+	if(--phys->refs > 0)
+		return;
+
+	for(registry_phys** it = &phys_list; *it; it = &(*it)->next){
+		if(*it == phys){
+			*it = phys->next;
+			break;
+		}
+	}
+
+	ohmd_destroy_mutex(phys->lock);
+	free(phys);
+}
+
+static void put_shared(ohmd_shared_device* shared)
+{
+	if(--shared->refs > 0)
+		return;
+
+	ohmd_device* device = shared->device;
+	ohmd_context* owner = device->ctx;
+	bool lent = !shared->owner_open;
+
+	for(ohmd_shared_device** it = &shared_list; *it; it = &(*it)->next){
+		if(*it == shared){
+			*it = shared->next;
+			break;
+		}
+	}
+
+	ohmd_lock_mutex(shared->phys->lock);
+	ohmd_device_defer_fusion(device, 0);
+	device->close(device);
+	ohmd_unlock_mutex(shared->phys->lock);
+
+	put_phys(shared->phys);
+	free(shared);
+
+	// the owner closed the device earlier but kept it open for the proxies
+	if(lent)
+		ohmd_ctx_return_device(owner);
+}
+
+/* proxies, every call is forwarded to the shared device under the physical device lock */
+
+#define PROXY_FORWARD(_device, _fn, ...) \
+	proxy_device* proxy = (proxy_device*)(_device); \
+	ohmd_device* target = proxy->shared->device; \
+	if(!target->_fn) \
+		return OHMD_S_UNSUPPORTED; \
+	ohmd_lock_mutex(proxy->shared->phys->lock); \
+	int ret = target->_fn(target, __VA_ARGS__); \
+	ohmd_unlock_mutex(proxy->shared->phys->lock); \
+	return ret;
+
+static int proxy_getf(ohmd_device* device, ohmd_float_value type, float* out)
+{
+	proxy_device* proxy = (proxy_device*)device;
+	ohmd_device* target = proxy->shared->device;
+
+	// a query through any context fuses what the owner deferred
+	ohmd_lock_mutex(proxy->shared->phys->lock);
+	if(target->sensor_fusion && target->sensor_fusion->pending_count > 0)
+		ofusion_flush(target->sensor_fusion);
+	int ret = target->getf(target, type, out);
+	ohmd_unlock_mutex(proxy->shared->phys->lock);
+
+	return ret;
+}
+
+static int proxy_setf(ohmd_device* device, ohmd_float_value type, const float* in)
+{
+	PROXY_FORWARD(device, setf, type, in);
+}
+
+static int proxy_seti(ohmd_device* device, ohmd_int_value type, const int* in)
+{
+	PROXY_FORWARD(device, seti, type, in);
+}
+
+static int proxy_set_data(ohmd_device* device, ohmd_data_value type, const void* in)
+{
+	PROXY_FORWARD(device, set_data, type, in);
+}
+
+static int proxy_push_imu_samples(ohmd_device* device, const ohmd_imu_sample* samples, int count)
+{
+	PROXY_FORWARD(device, push_imu_samples, samples, count);
+}
+
+static void proxy_update(ohmd_device* device)
+{
+	proxy_device* proxy = (proxy_device*)device;
+	ohmd_device* target = proxy->shared->device;
+
+	// whichever context updates first drains the reports, the others find nothing new
+	if(target->update){
+		ohmd_lock_mutex(proxy->shared->phys->lock);
+		target->update(target);
+		ohmd_unlock_mutex(proxy->shared->phys->lock);
+	}
+
+	// every proxy has its own event queue, filled at the rate the proxy is updated
+	ohmd_device_sample_controls(device);
+}
+
+static void proxy_close(ohmd_device* device)
+{
+	proxy_device* proxy = (proxy_device*)device;
+
+	put_shared(proxy->shared);
+	free(proxy);
+}
+
+static ohmd_device* create_proxy(ohmd_context* ctx, ohmd_shared_device* shared)
+{
+	proxy_device* proxy = ohmd_alloc(ctx, sizeof(proxy_device));
+	if(!proxy)
+		return NULL;
+
+	ohmd_lock_mutex(shared->phys->lock);
+	proxy->base.properties = shared->device->properties;
+	ohmd_unlock_mutex(shared->phys->lock);
+
+	proxy->base.getf = proxy_getf;
+	proxy->base.setf = proxy_setf;
+	proxy->base.seti = proxy_seti;
+	proxy->base.set_data = proxy_set_data;
+	proxy->base.push_imu_samples = shared->device->push_imu_samples ? proxy_push_imu_samples : NULL;
+	proxy->base.update = proxy_update;
+	proxy->base.close = proxy_close;
+
+	proxy->shared = shared;
+	shared->refs++;
+
+	return &proxy->base;
+}
+
+ohmd_device* ohmd_registry_open(ohmd_context* ctx, ohmd_device_desc* desc)
+{
+	for(ohmd_shared_device* shared = shared_list; shared; shared = shared->next){
+		if(shared->id == desc->id && strcmp(shared->phys->driver, desc->driver) == 0 &&
+		   strcmp(shared->phys->path, desc->path) == 0)
+			return create_proxy(ctx, shared);
+	}
+
+	ohmd_shared_device* shared = ohmd_alloc(ctx, sizeof(ohmd_shared_device));
+	if(!shared)
+		return NULL;
+
+	shared->phys = get_phys(ctx, desc);
+	if(!shared->phys){
+		free(shared);
+		return NULL;
+	}
+
+	ohmd_driver* driver = (ohmd_driver*)desc->driver_ptr;
+	ohmd_device* device = driver->open_device(driver, desc);
+	if(!device){
+		put_phys(shared->phys);
+		free(shared);
+		return NULL;
+	}
+
+	shared->id = desc->id;
+	shared->device = device;
+	shared->refs = 1;
+	shared->owner_open = true;
+	shared->next = shared_list;
+	shared_list = shared;
+
+	device->shared = shared;
+
+	return device;
+}
+
+bool ohmd_registry_close(ohmd_device* device)
+{
+	ohmd_shared_device* shared = device->shared;
+
+	// proxies release their reference in their close function
+	if(!shared){
+		device->close(device);
+		return false;
+	}
+
+	// keep the device open for the proxies of other contexts, the owner gets it back once they are done
+	bool lent = shared->refs > 1;
+	if(lent)
+		shared->owner_open = false;
+
+	put_shared(shared);
+
+	return lent;
+}
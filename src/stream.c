@@ -0,0 +1,261 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* UDP Pose Streaming Implementation */
+
+
+#include <string.h>
+#include "openhmdi.h"
+#include "stream.h"
+
+struct ohmd_stream {
+	ohmd_context* ctx;
+	ohmd_udp_socket* sock;
+	int decimation;
+	int batch;
+};
+
+struct ohmd_stream_receiver {
+	ohmd_udp_socket* sock;
+	int device_id; // -1 accepts every device
+	bool have_sequence[OHMD_STREAM_MAX_DEVICES];
+	uint32_t last_sequence[OHMD_STREAM_MAX_DEVICES]; // every device counts on its own
+
+	// the batch being handed out
+	ohmd_stream_packet batch;
+	int batch_offset, batch_size;
+	ohmd_pose_codec batch_codec;
+};
+
+static uint64_t timestamp_ns(ohmd_context* ctx)
+{
+	return ohmd_monotonic_conv(ohmd_monotonic_get(ctx), ohmd_monotonic_per_sec(ctx), 1000000000);
+}
+
+static bool host_is_big_endian(void)
+{
+	const uint16_t one = 1;
+	return *(const uint8_t*)&one == 0;
+}
+
+static void swap_bytes(void* data, int width, int count)
+{
+	unsigned char* p = data;
+	for(int i = 0; i < count; i++, p += width){
+		for(int j = 0; j < width / 2; j++){
+			unsigned char t = p[j];
+			p[j] = p[width - 1 - j];
+			p[width - 1 - j] = t;
+		}
+	}
+}
+
+// from host to wire order and back again, nothing to do on little endian hosts, batches are bytes already
+static void swap_packet_order(ohmd_stream_packet* pkt)
+{
+	if(!host_is_big_endian())
+		return;
+
+	swap_bytes(&pkt->magic, 4, 1);
+	swap_bytes(&pkt->device_id, 2, 1);
+	swap_bytes(&pkt->sequence, 4, 1);
+	swap_bytes(&pkt->controls, 4, 1);
+	swap_bytes(&pkt->timestamp_ns, 8, 1);
+
+	if(pkt->type == OHMD_STREAM_POSE)
+		swap_bytes(&pkt->payload.pose, 4, 7);
+}
+
+ohmd_stream* ohmd_stream_create(ohmd_context* ctx, const char* address, int port, int decimation, int batch)
+{
+	ohmd_stream* stream = ohmd_alloc(ctx, sizeof(ohmd_stream));
+	if(!stream)
+		return NULL;
+
+	stream->sock = ohmd_udp_open_sender(ctx, address, port);
+	if(!stream->sock){
+		free(stream);
+		return NULL;
+	}
+
+	stream->ctx = ctx;
+	stream->decimation = decimation > 0 ? decimation : 1;
+	stream->batch = OHMD_MAX(1, OHMD_MIN(batch, OHMD_STREAM_MAX_BATCH));
+
+	return stream;
+}
+
+void ohmd_stream_destroy(ohmd_stream* stream)
+{
+	ohmd_udp_close(stream->sock);
+	free(stream);
+}
+
+static void send_batch(ohmd_stream* stream, ohmd_device* device, uint32_t sequence, uint32_t controls)
+{
+	ohmd_stream_batch* batch = &device->stream_batch;
+	ohmd_stream_packet pkt;
+
+	pkt.magic = OHMD_STREAM_MAGIC;
+	pkt.version = OHMD_STREAM_VERSION;
+	pkt.type = OHMD_STREAM_POSE_BATCH;
+	pkt.device_id = (uint16_t)device->active_device_idx;
+	pkt.sequence = sequence;
+	pkt.controls = controls;
+	pkt.timestamp_ns = timestamp_ns(stream->ctx);
+	memcpy(pkt.payload.batch, batch->records, batch->size);
+
+	swap_packet_order(&pkt);
+	ohmd_udp_send(stream->sock, &pkt, OHMD_STREAM_HEADER_SIZE + batch->size);
+
+	batch->count = 0;
+	batch->size = 0;
+}
+
+void ohmd_stream_device(ohmd_stream* stream, ohmd_device* device, uint32_t controls, const quatf* rotation, const vec3f* position)
+{
+	uint32_t count = device->stream_count++;
+	if(count % stream->decimation != 0)
+		return;
+
+	if(stream->batch > 1){
+		ohmd_stream_batch* batch = &device->stream_batch;
+		ohmd_pose pose = { timestamp_ns(stream->ctx), *rotation, *position };
+
+		// every datagram starts with a key record, a lost one doesn't take the next ones with it
+		batch->size += ohmd_pose_encode(&batch->codec, &pose, batch->count == 0, batch->records + batch->size);
+		if(++batch->count == stream->batch)
+			send_batch(stream, device, count / stream->decimation / stream->batch, controls);
+		return;
+	}
+
+	ohmd_stream_packet pkt;
+
+	pkt.magic = OHMD_STREAM_MAGIC;
+	pkt.version = OHMD_STREAM_VERSION;
+	pkt.type = OHMD_STREAM_POSE;
+	pkt.device_id = (uint16_t)device->active_device_idx;
+	pkt.sequence = count / stream->decimation;
+	pkt.controls = controls;
+	pkt.timestamp_ns = timestamp_ns(stream->ctx);
+	memcpy(pkt.payload.pose.rotation, rotation->arr, sizeof(pkt.payload.pose.rotation));
+	memcpy(pkt.payload.pose.position, position->arr, sizeof(pkt.payload.pose.position));
+
+	// a full socket buffer drops the pose, the next one supersedes it anyway
+	swap_packet_order(&pkt);
+	ohmd_udp_send(stream->sock, &pkt, OHMD_STREAM_POSE_SIZE);
+}
+
+ohmd_stream_receiver* ohmd_stream_receiver_create(ohmd_context* ctx, const char* address)
+{
+	char ip[64];
+	int port = 0, device_id = -1;
+
+	const char* colon = strchr(address, ':');
+	if(!colon || colon - address >= (int)sizeof(ip)){
+		ohmd_set_error(ctx, "stream source must be given as ip:port[:device], got: %s", address);
+		return NULL;
+	}
+
+	memcpy(ip, address, colon - address);
+	ip[colon - address] = '\0';
+
+	if(sscanf(colon + 1, "%d:%d", &port, &device_id) < 1 || port <= 0 || port > 65535){
+		ohmd_set_error(ctx, "invalid port in stream source: %s", address);
+		return NULL;
+	}
+
+	ohmd_stream_receiver* recv = ohmd_alloc(ctx, sizeof(ohmd_stream_receiver));
+	if(!recv)
+		return NULL;
+
+	recv->sock = ohmd_udp_open_receiver(ctx, ip, port);
+	if(!recv->sock){
+		free(recv);
+		return NULL;
+	}
+
+	recv->device_id = device_id;
+
+	return recv;
+}
+
+void ohmd_stream_receiver_destroy(ohmd_stream_receiver* recv)
+{
+	ohmd_udp_close(recv->sock);
+	free(recv);
+}
+
+// the next pose of the batch being handed out as a pose packet, false once the batch is done
+static bool next_batch_pose(ohmd_stream_receiver* recv, ohmd_stream_packet* pkt)
+{
+	ohmd_pose pose;
+	int n = ohmd_pose_decode(&recv->batch_codec, recv->batch.payload.batch + recv->batch_offset,
+	                         recv->batch_size - recv->batch_offset, &pose);
+
+	if(n <= 0){
+		recv->batch_size = 0;
+		return false;
+	}
+
+	recv->batch_offset += n;
+
+	memcpy(pkt, &recv->batch, OHMD_STREAM_HEADER_SIZE);
+	pkt->type = OHMD_STREAM_POSE;
+	pkt->timestamp_ns = pose.timestamp_ns;
+	memcpy(pkt->payload.pose.rotation, pose.rotation.arr, sizeof(pkt->payload.pose.rotation));
+	memcpy(pkt->payload.pose.position, pose.position.arr, sizeof(pkt->payload.pose.position));
+
+	return true;
+}
+
+bool ohmd_stream_receiver_next(ohmd_stream_receiver* recv, ohmd_stream_packet* pkt)
+{
+	int size;
+
+	if(recv->batch_size > 0 && next_batch_pose(recv, pkt))
+		return true;
+
+	while((size = ohmd_udp_recv(recv->sock, pkt, sizeof(ohmd_stream_packet))) > 0){
+		if(size < OHMD_STREAM_HEADER_SIZE)
+			continue;
+
+		swap_packet_order(pkt);
+		if(pkt->magic != OHMD_STREAM_MAGIC || pkt->version != OHMD_STREAM_VERSION)
+			continue;
+
+		if(pkt->device_id >= OHMD_STREAM_MAX_DEVICES || (recv->device_id >= 0 && pkt->device_id != recv->device_id))
+			continue;
+
+		if((pkt->type == OHMD_STREAM_POSE && size < OHMD_STREAM_POSE_SIZE) ||
+		   (pkt->type != OHMD_STREAM_POSE && pkt->type != OHMD_STREAM_POSE_BATCH))
+			continue;
+
+		// drop reordered and duplicated datagrams, a large step back means the sender restarted
+		int32_t step = (int32_t)(pkt->sequence - recv->last_sequence[pkt->device_id]);
+		if(recv->have_sequence[pkt->device_id] && step <= 0 && step > -1000)
+			continue;
+
+		recv->have_sequence[pkt->device_id] = true;
+		recv->last_sequence[pkt->device_id] = pkt->sequence;
+
+		if(pkt->type == OHMD_STREAM_POSE_BATCH){
+			memcpy(&recv->batch, pkt, size);
+			recv->batch_offset = 0;
+			recv->batch_size = size - OHMD_STREAM_HEADER_SIZE;
+			ohmd_pose_codec_reset(&recv->batch_codec);
+
+			if(next_batch_pose(recv, pkt))
+				return true;
+			continue;
+		}
+
+		return true;
+	}
+
+	return false;
+}
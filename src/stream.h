@@ -0,0 +1,79 @@
+// Copyright 2013, Fredrik Hultin.
+// Copyright 2013, Jakob Bornecrantz.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* UDP Pose Streaming */
+
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "openhmd.h"
+#include "omath.h"
+#include "posecodec.h"
+
+#define OHMD_STREAM_MAGIC 0x534d484f // "OHMS" on the wire
+#define OHMD_STREAM_VERSION 1
+
+typedef enum {
+	OHMD_STREAM_POSE = 0,
+	OHMD_STREAM_POSE_BATCH = 1,
+} ohmd_stream_type;
+
+#define OHMD_STREAM_MAX_BATCH 32
+#define OHMD_STREAM_MAX_DEVICES 256 // device ids are indices into the active devices of the sender
+
+// Wire format, little endian whatever the host, only the header and the payload of
+// the given type are sent (52 bytes for poses).
+// A batch is the records of up to OHMD_STREAM_MAX_BATCH poses as in posecodec.h, the first of them
+// a key record, with the controls of the last pose and its sequence counting batches.
+typedef struct {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t type;
+	uint16_t device_id;
+	uint32_t sequence;
+	uint32_t controls;      // bit n is set while digital control n is pressed
+	uint64_t timestamp_ns;  // host monotonic time when the packet was created
+	union {
+		struct {
+			float rotation[4];
+			float position[3];
+		} pose;
+		unsigned char batch[OHMD_STREAM_MAX_BATCH * OHMD_POSE_MAX_RECORD];
+	} payload;
+} ohmd_stream_packet;
+
+#define OHMD_STREAM_HEADER_SIZE 24
+#define OHMD_STREAM_POSE_SIZE (OHMD_STREAM_HEADER_SIZE + 7 * 4)
+
+typedef struct ohmd_stream ohmd_stream;
+
+// poses of a device waiting for the next datagram of a batched stream
+typedef struct {
+	ohmd_pose_codec codec;
+	int count, size;
+	unsigned char records[OHMD_STREAM_MAX_BATCH * OHMD_POSE_MAX_RECORD];
+} ohmd_stream_batch;
+
+// publisher, a batch of 1 sends every pose on its own
+ohmd_stream* ohmd_stream_create(ohmd_context* ctx, const char* address, int port, int decimation, int batch);
+void ohmd_stream_destroy(ohmd_stream* stream);
+void ohmd_stream_device(ohmd_stream* stream, ohmd_device* device, uint32_t controls, const quatf* rotation, const vec3f* position);
+
+// receiver, address is "ip:port[:device_id]", every device is accepted without a device_id
+// and its packets are put in order on their own
+typedef struct ohmd_stream_receiver ohmd_stream_receiver;
+
+ohmd_stream_receiver* ohmd_stream_receiver_create(ohmd_context* ctx, const char* address);
+void ohmd_stream_receiver_destroy(ohmd_stream_receiver* recv);
+// returns true and fills packet with the next packet for the selected device, false when drained,
+// batches are handed out as one OHMD_STREAM_POSE packet per pose with the time of the pose
+bool ohmd_stream_receiver_next(ohmd_stream_receiver* recv, ohmd_stream_packet* packet);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - Internal Interface */
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "openhmdi.h"
+
+double bench_now(void);
+void bench_report(const char* what, double count, double seconds, const char* unit);
+
+// synthetic imu data
+void bench_imu_sample(unsigned int* seed, vec3f* gyro, vec3f* accel, vec3f* mag);
+
+// math backend benchmarks
+void bench_omath_backends();
+void bench_omath_soa();
+
+// fusion benchmarks
+void bench_fusion_single();
+void bench_fusion_many_devices();
+void bench_fusion_batch();
+void bench_fusion_engines();
+void bench_fusion_preintegration();
+void bench_fusion_drift();
+void bench_fusion_bank();
+
+// pose encoding benchmarks
+void bench_pose_encoding();
+
+// external driver benchmarks
+void bench_external_ingest();
+
+// streaming benchmarks
+void bench_stream_loopback_latency();
+
+// hid reader benchmarks
+void bench_hid_reader_contention();
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - External Sensor Ingestion */
+
+#include <string.h>
+#include "benchmarks.h"
+
+#define SAMPLES 1000000
+#define BATCH_MAX 256
+
+static ohmd_device* open_external(ohmd_context* ctx)
+{
+	int num_devices = ohmd_ctx_probe(ctx);
+
+	for(int i = 0; i < num_devices; i++)
+		if(strcmp(ohmd_list_gets(ctx, i, OHMD_PRODUCT), "External Device") == 0)
+			return ohmd_list_open_device(ctx, i);
+
+	return NULL;
+}
+
+void bench_external_ingest()
+{
+	static ohmd_imu_sample samples[BATCH_MAX];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < BATCH_MAX; i++){
+		vec3f gyro, accel, mag;
+		bench_imu_sample(&seed, &gyro, &accel, &mag);
+		memcpy(samples[i].gyro, gyro.arr, sizeof(gyro.arr));
+		memcpy(samples[i].accel, accel.arr, sizeof(accel.arr));
+		memcpy(samples[i].mag, mag.arr, sizeof(mag.arr));
+	}
+
+	ohmd_context* ctx = ohmd_ctx_create();
+	ohmd_device* dev = open_external(ctx);
+	if(!dev){
+		printf("   external driver not available\n");
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	// one setf per sample, a 1 kHz sample clock
+	double start = bench_now();
+	for(int i = 0; i < SAMPLES; i++){
+		const ohmd_imu_sample* s = samples + (i % BATCH_MAX);
+		float in[10] = { 0.001f, s->gyro[0], s->gyro[1], s->gyro[2], s->accel[0], s->accel[1], s->accel[2],
+		                 s->mag[0], s->mag[1], s->mag[2] };
+		ohmd_device_setf(dev, OHMD_EXTERNAL_SENSOR_FUSION, in);
+	}
+	double end = bench_now();
+
+	bench_report("setf(OHMD_EXTERNAL_SENSOR_FUSION)", SAMPLES, end - start, "samples");
+
+	uint64_t ts = 0;
+	int batch_sizes[] = { 1, 4, 16, 64, 256 };
+
+	for(int b = 0; b < (int)(sizeof(batch_sizes) / sizeof(batch_sizes[0])); b++){
+		int batch = batch_sizes[b];
+		char what[64];
+
+		start = bench_now();
+		for(int i = 0; i < SAMPLES; i += batch){
+			for(int j = 0; j < batch; j++)
+				samples[j].timestamp_ns = (ts += 1000000);
+			ohmd_device_push_imu_samples(dev, samples, batch);
+		}
+		end = bench_now();
+
+		snprintf(what, sizeof(what), "ohmd_device_push_imu_samples, batch %d", batch);
+		bench_report(what, SAMPLES, end - start, "samples");
+	}
+
+	ohmd_ctx_destroy(ctx);
+}
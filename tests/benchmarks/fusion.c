@@ -0,0 +1,341 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - Sensor Fusion */
+
+#include "benchmarks.h"
+
+#define SAMPLES 2000000
+#define DEVICES 48
+
+// the engine benchmark runs a few headsets and controllers with four samples per report
+#define ENGINE_DEVICES 8
+#define ENGINE_REPORT 4
+
+void bench_fusion_single()
+{
+	static vec3f gyro[1024], accel[1024], mag[1024];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < 1024; i++)
+		bench_imu_sample(&seed, gyro + i, accel + i, mag + i);
+
+	fusion f;
+	ofusion_init(&f);
+
+	printf("   sizeof(fusion): %d bytes\n", (int)sizeof(fusion));
+
+	double start = bench_now();
+	for(int i = 0; i < SAMPLES; i++)
+		ofusion_update(&f, 0.001f, gyro + (i & 1023), accel + (i & 1023), mag + (i & 1023));
+	double end = bench_now();
+
+	bench_report("ofusion_update, one device", SAMPLES, end - start, "samples");
+}
+
+void bench_fusion_many_devices()
+{
+	static vec3f gyro[1024], accel[1024], mag[1024];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < 1024; i++)
+		bench_imu_sample(&seed, gyro + i, accel + i, mag + i);
+
+	fusion* f = calloc(DEVICES, sizeof(fusion));
+	for(int d = 0; d < DEVICES; d++)
+		ofusion_init(f + d);
+
+	printf("   %d devices: %d bytes of fusion state\n", DEVICES, (int)(DEVICES * sizeof(fusion)));
+
+	// interleave the devices like the update thread does, one report each
+	double start = bench_now();
+	for(int i = 0; i < SAMPLES; i++)
+		ofusion_update(f + (i % DEVICES), 0.001f, gyro + (i & 1023), accel + (i & 1023), mag + (i & 1023));
+	double end = bench_now();
+
+	bench_report("ofusion_update, round robin", SAMPLES, end - start, "samples");
+
+	free(f);
+}
+
+static void bench_fusion_reports(int report_size)
+{
+	static fusion_sample samples[1024];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < 1024; i++){
+		bench_imu_sample(&seed, &samples[i].ang_vel, &samples[i].accel, &samples[i].mag);
+		samples[i].dt = 0.001f;
+	}
+
+	fusion f;
+	char what[64];
+
+	// the old driver loop, one call per sample of a report
+	ofusion_init(&f);
+	double start = bench_now();
+	for(int i = 0; i < SAMPLES; i += report_size)
+		for(int j = 0; j < report_size; j++){
+			const fusion_sample* s = samples + ((i + j) & 1023);
+			ofusion_update(&f, s->dt, &s->ang_vel, &s->accel, &s->mag);
+		}
+	double end = bench_now();
+
+	snprintf(what, sizeof(what), "ofusion_update, %d per report", report_size);
+	bench_report(what, SAMPLES, end - start, "samples");
+
+	ofusion_init(&f);
+	start = bench_now();
+	for(int i = 0; i < SAMPLES; i += report_size)
+		ofusion_update_batch(&f, samples + (i & 1023), report_size);
+	end = bench_now();
+
+	snprintf(what, sizeof(what), "ofusion_update_batch, %d per report", report_size);
+	bench_report(what, SAMPLES, end - start, "samples");
+}
+
+void bench_fusion_batch()
+{
+	// psvr, rift and wmr reports, and a burst pushed by an external source
+	bench_fusion_reports(2);
+	bench_fusion_reports(3);
+	bench_fusion_reports(4);
+	bench_fusion_reports(32);
+}
+
+static void bench_engine(const fusion_engine* engine, int preintegrate)
+{
+	static fusion_sample samples[1024];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < 1024; i++){
+		bench_imu_sample(&seed, &samples[i].ang_vel, &samples[i].accel, &samples[i].mag);
+		samples[i].dt = 0.001f;
+	}
+
+	fusion* f = calloc(ENGINE_DEVICES, sizeof(fusion));
+	for(int d = 0; d < ENGINE_DEVICES; d++){
+		ofusion_init(f + d);
+		ofusion_set_engine(f + d, engine);
+		ofusion_set_preintegration(f + d, preintegrate);
+	}
+
+	// one report of each device in turn, like the update thread
+	double start = bench_now();
+	for(int i = 0; i < SAMPLES; i += ENGINE_REPORT)
+		ofusion_update_batch(f + ((i / ENGINE_REPORT) % ENGINE_DEVICES), samples + (i & 1023), ENGINE_REPORT);
+	double end = bench_now();
+
+	char what[64];
+	if(preintegrate > 1)
+		snprintf(what, sizeof(what), "%s, %d devices, %d per step", engine->name, ENGINE_DEVICES, preintegrate);
+	else
+		snprintf(what, sizeof(what), "%s, %d devices", engine->name, ENGINE_DEVICES);
+	bench_report(what, SAMPLES, end - start, "samples");
+	printf("   %-44s %12.1f kHz per device on one core\n", "", SAMPLES / (end - start) / ENGINE_DEVICES / 1000.0);
+
+	free(f);
+}
+
+void bench_fusion_engines()
+{
+	printf("   engine state in fusion: %d bytes, eskf %d, fixed %d\n", (int)sizeof(((fusion*)0)->state),
+	       (int)sizeof(fusion_eskf_state), (int)sizeof(fusion_fixed_state));
+
+	bench_engine(&ofusion_complementary, 0);
+	bench_engine(&ofusion_eskf, 0);
+	bench_engine(&ofusion_mahony, 0);
+	bench_engine(&ofusion_madgwick, 0);
+	bench_engine(&ofusion_fixed, 0);
+}
+
+void bench_fusion_preintegration()
+{
+	// a whole report per fused step
+	bench_engine(&ofusion_complementary, ENGINE_REPORT);
+	bench_engine(&ofusion_eskf, ENGINE_REPORT);
+	bench_engine(&ofusion_mahony, ENGINE_REPORT);
+	bench_engine(&ofusion_madgwick, ENGINE_REPORT);
+}
+
+#define DRIFT_RATE 1000
+#define DRIFT_SECONDS 120
+
+static float drift_noise(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 24) - 0.5f;
+}
+
+// angle between the up vectors of two orientations
+static float tilt_error(const quatf* truth, const quatf* estimate)
+{
+	vec3f up = {{ 0, 1.0f, 0 }}, a;
+	quatf inv = {{ -truth->x, -truth->y, -truth->z, truth->w }}, rel;
+
+	// bring the estimate into the frame of the truth and look at where it thinks up is
+	oquatf_mult(estimate, &inv, &rel);
+	oquatf_get_rotated(&rel, &up, &a);
+
+	return ovec3f_get_angle(&a, &up);
+}
+
+void bench_fusion_drift()
+{
+	// a recorded session replayed at 1 kHz: a head looking around, with gyro bias, gyro and accelerometer
+	// noise and short bursts of linear acceleration. The same samples are fed to every engine.
+	const int count = DRIFT_RATE * DRIFT_SECONDS;
+	fusion_sample* samples = malloc(sizeof(fusion_sample) * count);
+	quatf* truth = malloc(sizeof(quatf) * count);
+	unsigned int seed = 3;
+
+	quatf orient = {{ 0, 0, 0, 1.0f }};
+	const float dt = 1.0f / DRIFT_RATE;
+	const vec3f bias = {{ 0.004f, -0.003f, 0.002f }}, up = {{ 0, 1.0f, 0 }};
+
+	for(int i = 0; i < count; i++){
+		float t = i * dt;
+		vec3f w = {{ 0.6f * sinf(0.7f * t), 1.2f * sinf(0.31f * t + 1.0f), 0.4f * cosf(1.3f * t) }};
+
+		vec3f axis = w;
+		float length = ovec3f_get_length(&axis);
+		ovec3f_normalize_me(&axis);
+		quatf delta;
+		oquatf_init_axis(&delta, &axis, length * dt);
+		oquatf_mult_me(&orient, &delta);
+		oquatf_normalize_me(&orient);
+		truth[i] = orient;
+
+		quatf inv = {{ -orient.x, -orient.y, -orient.z, orient.w }};
+		vec3f gravity;
+		oquatf_get_rotated(&inv, &up, &gravity);
+
+		// walking around for half a second every ten seconds
+		float shake = fmodf(t, 10.0f) < 0.5f ? 3.0f : 0.0f;
+
+		fusion_sample* s = samples + i;
+		s->dt = dt;
+		for(int j = 0; j < 3; j++){
+			s->ang_vel.arr[j] = w.arr[j] + bias.arr[j] + drift_noise(&seed) * 0.02f;
+			s->accel.arr[j] = gravity.arr[j] * 9.81f + drift_noise(&seed) * (0.2f + shake);
+			s->mag.arr[j] = 0;
+		}
+	}
+
+	const fusion_engine* engines[4] = { &ofusion_complementary, &ofusion_eskf, &ofusion_mahony, &ofusion_madgwick };
+
+	for(int e = 0; e < 4; e++){
+		fusion f;
+		ofusion_init(&f);
+		ofusion_set_engine(&f, engines[e]);
+
+		float max_error = 0, sum_error = 0;
+		int measured = 0;
+
+		double start = bench_now();
+		for(int i = 0; i < count; i += ENGINE_REPORT){
+			ofusion_update_batch(&f, samples + i, ENGINE_REPORT);
+
+			// skip the first seconds while the filters settle
+			if(i >= 5 * DRIFT_RATE){
+				float error = tilt_error(truth + i + ENGINE_REPORT - 1, &f.orient);
+				if(error > max_error)
+					max_error = error;
+				sum_error += error;
+				measured++;
+			}
+		}
+		double end = bench_now();
+
+		printf("   %-44s %8.3f deg mean %8.3f deg max tilt error  (%.1f ns per sample)\n", engines[e]->name,
+		       RAD_TO_DEG(sum_error / measured), RAD_TO_DEG(max_error), (end - start) * 1e9 / count);
+	}
+
+	free(samples);
+	free(truth);
+}
+
+// a 1 kHz tracker read at 90 Hz, the samples each device has waiting when the bank is flushed
+#define BANK_FRAME_SAMPLES 11
+#define BANK_SAMPLES 1000000
+
+static double bench_bank_run(fusion* f, fusion_sample* pending, fusion_bank* bank, int devices,
+                             const fusion_sample* samples)
+{
+	int frames = BANK_SAMPLES / (devices * BANK_FRAME_SAMPLES);
+	double fused = 0;
+
+	for(int d = 0; d < devices; d++){
+		ofusion_init(f + d);
+		ofusion_defer(f + d, pending + d * FUSION_BANK_PENDING, FUSION_BANK_PENDING);
+		ofusion_set_engine(f + d, &ofusion_mahony);
+		if(bank)
+			ofusion_bank_add(bank, f + d);
+	}
+
+	// only the flush is timed, queueing the samples costs the same either way
+	for(int frame = 0; frame < frames; frame++){
+		for(int d = 0; d < devices; d++)
+			ofusion_update_batch(f + d, samples + ((frame * 7 + d * 37) & 511), BANK_FRAME_SAMPLES);
+
+		double start = bench_now();
+		if(bank){
+			ofusion_bank_flush(bank);
+		}else{
+			for(int d = 0; d < devices; d++)
+				ofusion_flush(f + d);
+		}
+		fused += bench_now() - start;
+	}
+
+	return fused / ((double)frames * devices * BANK_FRAME_SAMPLES);
+}
+
+void bench_fusion_bank()
+{
+	static fusion_sample samples[1024];
+	unsigned int seed = 1;
+
+	for(int i = 0; i < 1024; i++){
+		bench_imu_sample(&seed, &samples[i].ang_vel, &samples[i].accel, &samples[i].mag);
+		samples[i].dt = 0.001f;
+	}
+
+	// the widest backend, its kernel fuses eight or four devices at once
+	const omath_backend* old = omath_get_backend();
+	const omath_backend* widest;
+	omath_get_backends(&widest, 1);
+
+	fusion* f = calloc(256, sizeof(fusion));
+	fusion_sample* pending = calloc(256 * FUSION_BANK_PENDING, sizeof(fusion_sample));
+	fusion* members[256];
+	fusion_bank bank;
+
+	printf("   %-10s %14s %14s %14s   ns per sample\n", "devices", "on their own", "bank, scalar", "bank, simd");
+
+	for(int devices = 1; devices <= 256; devices *= 2){
+		double own, scalar, simd;
+
+		own = bench_bank_run(f, pending, NULL, devices, samples);
+
+		omath_set_backend(&omath_scalar);
+		ofusion_bank_init(&bank, members, devices);
+		scalar = bench_bank_run(f, pending, &bank, devices, samples);
+
+		omath_set_backend(widest);
+		ofusion_bank_init(&bank, members, devices);
+		simd = bench_bank_run(f, pending, &bank, devices, samples);
+
+		printf("   %-10d %14.1f %14.1f %14.1f\n", devices, own * 1e9, scalar * 1e9, simd * 1e9);
+	}
+
+	printf("   simd kernel: %s\n", ofusion_bank_kernel());
+	omath_set_backend(old);
+
+	free(pending);
+	free(f);
+}
@@ -0,0 +1,276 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - HID Reader Thread */
+
+/*
+ * A simulated 2 kHz device with a kernel queue as deep as the one of hidraw, read either on the update thread like
+ * the drivers do by default or by a reader thread feeding the update thread through an ohmd_hid_ring, as with
+ * OHMD_IDS_READER_THREAD. Busy threads compete for the CPU, and in the last runs the update thread also stalls now
+ * and then, as it does while the application holds the update lock or another device is slow. The reader loop is the one of src/hidreader.c, the
+ * library's own thread functions are not exported to the benchmarks.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "benchmarks.h"
+#include "hidreader.h"
+
+#define REPORT_PERIOD_NS 500000 // 2 kHz
+#define KERNEL_QUEUE 64         // reports hidraw buffers per open file
+#define RUN_NS 1000000000ull
+#define MAX_REPORTS 4096
+#define SAMPLES_PER_REPORT 4
+#define HOGS 2
+#define STALL_EVERY_NS 250000000ull
+#define STALL_NS 40000000ull
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint64_t sent[KERNEL_QUEUE];
+	unsigned head, tail;
+	int produced, kernel_dropped;
+
+	// read side latency, recorded by whichever thread reads the device
+	double read_latency[MAX_REPORTS];
+	int reads;
+
+	// from the device to fused, recorded by the update thread
+	double fuse_latency[MAX_REPORTS];
+	int fused;
+
+	ohmd_hid_ring ring;
+	bool pipelined;
+	bool stalls;
+	volatile bool quit;
+} sim_device;
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+	struct timespec t = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+	nanosleep(&t, NULL);
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double d = *(const double*)a - *(const double*)b;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+// the device and the kernel, reports arrive on time and are dropped when the queue is full
+static void* device_thread(void* arg)
+{
+	sim_device* dev = (sim_device*)arg;
+	uint64_t start = now_ns(), next = start;
+
+	while(next - start < RUN_NS){
+		uint64_t now = now_ns();
+		if(now < next){
+			sleep_ns(next - now);
+			continue;
+		}
+
+		pthread_mutex_lock(&dev->lock);
+		for(; next <= now && next - start < RUN_NS; next += REPORT_PERIOD_NS){
+			dev->produced++;
+			if(dev->tail - dev->head == KERNEL_QUEUE)
+				dev->kernel_dropped++;
+			else
+				dev->sent[dev->tail++ % KERNEL_QUEUE] = next;
+		}
+		pthread_cond_signal(&dev->cond);
+		pthread_mutex_unlock(&dev->lock);
+	}
+
+	// let the consumers drain what is left
+	sleep_ns(20000000);
+	dev->quit = true;
+
+	return NULL;
+}
+
+// hid_read_timeout() of the simulated device, the report carries the time it was sent
+static int sim_read(void* handle, unsigned char* data, int size, int timeout_ms)
+{
+	sim_device* dev = (sim_device*)handle;
+
+	pthread_mutex_lock(&dev->lock);
+
+	if(dev->head == dev->tail && timeout_ms > 0){
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_nsec += timeout_ms * 1000000l;
+		until.tv_sec += until.tv_nsec / 1000000000l;
+		until.tv_nsec %= 1000000000l;
+		pthread_cond_timedwait(&dev->cond, &dev->lock, &until);
+	}
+
+	if(dev->head == dev->tail){
+		pthread_mutex_unlock(&dev->lock);
+		return 0;
+	}
+
+	uint64_t sent = dev->sent[dev->head++ % KERNEL_QUEUE];
+	pthread_mutex_unlock(&dev->lock);
+
+	if(dev->reads < MAX_REPORTS)
+		dev->read_latency[dev->reads++] = (double)(now_ns() - sent) / 1000.0;
+
+	memset(data, 0x5a, size);
+	memcpy(data, &sent, sizeof(sent));
+	return size;
+}
+
+// the stage after the read, roughly what the nolo driver does with a report
+static void decode_and_fuse(sim_device* dev, fusion* f, unsigned char* data)
+{
+	uint32_t words[14], key = 0x9e3779b9;
+	uint64_t sent;
+
+	memcpy(words, data + 8, sizeof(words));
+
+	// stands in for nolo_decrypt_data, a few rounds over the payload
+	for(int round = 0; round < 16; round++)
+		for(int i = 0; i < 14; i++)
+			words[i] = (words[i] ^ key) * 2654435761u + (words[(i + 1) % 14] >> 5);
+
+	for(int i = 0; i < SAMPLES_PER_REPORT; i++){
+		vec3f gyro = {{ (words[i] & 0xff) * 1e-4f, 0, 0 }}, accel = {{ 0, 9.81f, 0 }}, mag = {{ 0, 0, 0 }};
+		ofusion_update(f, 1.0f / (2000 * SAMPLES_PER_REPORT), &gyro, &accel, &mag);
+	}
+
+	memcpy(&sent, data, sizeof(sent));
+	if(dev->fused < MAX_REPORTS)
+		dev->fuse_latency[dev->fused++] = (double)(now_ns() - sent) / 1000.0;
+}
+
+// the loop of src/hidreader.c
+static void* reader_thread(void* arg)
+{
+	sim_device* dev = (sim_device*)arg;
+	unsigned char buffer[OHMD_HID_REPORT_SIZE];
+
+	while(!dev->quit){
+		int size = sim_read(dev, buffer, sizeof(buffer), 50);
+		if(size > 0)
+			ohmd_hid_ring_push(&dev->ring, now_ns(), buffer, size);
+	}
+
+	return NULL;
+}
+
+// the automatic update thread, it sleeps 1 ms between updates
+static void* update_thread(void* arg)
+{
+	sim_device* dev = (sim_device*)arg;
+	unsigned char buffer[OHMD_HID_REPORT_SIZE];
+	uint64_t next_stall = now_ns() + STALL_EVERY_NS;
+	fusion f;
+
+	ofusion_init(&f);
+	ofusion_set_engine(&f, &ofusion_eskf);
+
+	while(!dev->quit){
+		if(dev->stalls && now_ns() >= next_stall){
+			sleep_ns(STALL_NS);
+			next_stall += STALL_EVERY_NS;
+		}
+
+		if(dev->pipelined){
+			while(ohmd_hid_ring_pop(&dev->ring, buffer, sizeof(buffer), NULL) > 0)
+				decode_and_fuse(dev, &f, buffer);
+		}else{
+			while(sim_read(dev, buffer, sizeof(buffer), 0) > 0)
+				decode_and_fuse(dev, &f, buffer);
+		}
+
+		sleep_ns(1000000);
+	}
+
+	return NULL;
+}
+
+static void* hog_thread(void* arg)
+{
+	sim_device* dev = (sim_device*)arg;
+	volatile uint32_t x = 0;
+
+	while(!dev->quit)
+		x = x * 1664525u + 1013904223u;
+
+	return NULL;
+}
+
+static void print_latency(const char* what, double* latency, int count)
+{
+	if(count == 0){
+		printf("   %-32s no reports\n", what);
+		return;
+	}
+
+	qsort(latency, count, sizeof(double), compare_double);
+	printf("   %-32s p50 %7.1f us, p99 %7.1f us, max %7.1f us\n", what,
+	       latency[count / 2], latency[count * 99 / 100], latency[count - 1]);
+}
+
+static void run(bool pipelined, int hogs, bool stalls)
+{
+	static sim_device dev;
+	pthread_t device, update, reader, hog[HOGS];
+
+	memset(&dev, 0, sizeof(dev));
+	pthread_mutex_init(&dev.lock, NULL);
+	pthread_cond_init(&dev.cond, NULL);
+	dev.pipelined = pipelined;
+	dev.stalls = stalls;
+
+	for(int i = 0; i < hogs; i++)
+		pthread_create(&hog[i], NULL, hog_thread, &dev);
+
+	pthread_create(&update, NULL, update_thread, &dev);
+	if(pipelined)
+		pthread_create(&reader, NULL, reader_thread, &dev);
+	pthread_create(&device, NULL, device_thread, &dev);
+
+	pthread_join(device, NULL);
+	pthread_join(update, NULL);
+	if(pipelined)
+		pthread_join(reader, NULL);
+	for(int i = 0; i < hogs; i++)
+		pthread_join(hog[i], NULL);
+
+	pthread_cond_destroy(&dev.cond);
+	pthread_mutex_destroy(&dev.lock);
+
+	printf("   %s, %d busy threads%s\n", pipelined ? "reader thread" : "read on the update thread", hogs,
+	       stalls ? ", update stalls" : "");
+	print_latency("device to read", dev.read_latency, dev.reads);
+	print_latency("device to fused", dev.fuse_latency, dev.fused);
+	printf("   %-32s %d of %d in the kernel queue, %u in the ring\n", "dropped",
+	       dev.kernel_dropped, dev.produced, dev.ring.dropped);
+}
+
+void bench_hid_reader_contention()
+{
+	run(false, 0, false);
+	run(true, 0, false);
+	run(false, HOGS, false);
+	run(true, HOGS, false);
+	run(false, HOGS, true);
+	run(true, HOGS, true);
+}
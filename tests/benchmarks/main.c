@@ -0,0 +1,69 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - Main */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <string.h>
+#include <time.h>
+#include "benchmarks.h"
+
+double bench_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+void bench_report(const char* what, double count, double seconds, const char* unit)
+{
+	printf("   %-44s %12.0f %s/s  (%.1f ns each)\n", what, count / seconds, unit, seconds * 1e9 / count);
+}
+
+static float bench_rand(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 24) - 0.5f;
+}
+
+void bench_imu_sample(unsigned int* seed, vec3f* gyro, vec3f* accel, vec3f* mag)
+{
+	// a device held roughly level with some hand jitter
+	gyro->x = bench_rand(seed) * 0.2f;
+	gyro->y = bench_rand(seed) * 0.2f;
+	gyro->z = bench_rand(seed) * 0.2f;
+
+	accel->x = bench_rand(seed) * 0.4f;
+	accel->y = 9.81f + bench_rand(seed) * 0.4f;
+	accel->z = bench_rand(seed) * 0.4f;
+
+	mag->x = 0.3f;
+	mag->y = -0.1f;
+	mag->z = 0.2f;
+}
+
+#define Bench(_b) printf(#_b "\n"); _b(); printf("\n");
+
+int main()
+{
+	Bench(bench_omath_backends);
+	Bench(bench_omath_soa);
+	Bench(bench_fusion_single);
+	Bench(bench_fusion_many_devices);
+	Bench(bench_fusion_batch);
+	Bench(bench_fusion_engines);
+	Bench(bench_fusion_preintegration);
+	Bench(bench_fusion_drift);
+	Bench(bench_fusion_bank);
+	Bench(bench_pose_encoding);
+	Bench(bench_external_ingest);
+	Bench(bench_stream_loopback_latency);
+	Bench(bench_hid_reader_contention);
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - Math Backends */
+
+#include "benchmarks.h"
+
+#define CALLS 4000000
+
+// keeps the compiler from dropping the loops
+static volatile float sink;
+
+#define INPUTS 64
+
+static void bench_backend(const omath_backend* be)
+{
+	static quatf q[INPUTS];
+	static vec3f v[INPUTS], vout[INPUTS];
+	static mat4x4f a[INPUTS], b[INPUTS], c[INPUTS];
+	char what[64];
+
+	for(int i = 0; i < INPUTS; i++){
+		vec3f axis = {{ 0.1f * i, 1.0f, -0.05f * i }};
+		oquatf_init_axis(q + i, &axis, 0.01f * i);
+		v[i].x = 0.1f * i;
+		v[i].y = 9.81f;
+		v[i].z = -0.2f;
+		for(int j = 0; j < 16; j++){
+			a[i].arr[j] = (float)(i + j) * 0.1f;
+			b[i].arr[j] = 1.0f - (float)(i - j) * 0.05f;
+		}
+	}
+
+	omath_set_backend(be);
+
+	// a chain of products like the gyro integration, each call depends on the previous one
+	quatf orient = {{ 0, 0, 0, 1.0f }};
+	double start = bench_now();
+	for(int i = 0; i < CALLS; i++)
+		oquatf_mult_me(&orient, q + (i & (INPUTS - 1)));
+	double end = bench_now();
+	sink = orient.w;
+	snprintf(what, sizeof(what), "%s oquatf_mult_me", be->name);
+	bench_report(what, CALLS, end - start, "calls");
+
+	start = bench_now();
+	for(int i = 0; i < CALLS; i++)
+		oquatf_get_rotated(q + (i & (INPUTS - 1)), v + (i & (INPUTS - 1)), vout + (i & (INPUTS - 1)));
+	end = bench_now();
+	sink = vout[3].y;
+	snprintf(what, sizeof(what), "%s oquatf_get_rotated", be->name);
+	bench_report(what, CALLS, end - start, "calls");
+
+	start = bench_now();
+	for(int i = 0; i < CALLS; i++)
+		oquatf_normalize_me(q + (i & (INPUTS - 1)));
+	end = bench_now();
+	sink = q[5].w;
+	snprintf(what, sizeof(what), "%s oquatf_normalize_me", be->name);
+	bench_report(what, CALLS, end - start, "calls");
+
+	start = bench_now();
+	for(int i = 0; i < CALLS; i++)
+		omat4x4f_mult(a + (i & (INPUTS - 1)), b + (i & (INPUTS - 1)), c + (i & (INPUTS - 1)));
+	end = bench_now();
+	sink = c[7].arr[3];
+	snprintf(what, sizeof(what), "%s omat4x4f_mult", be->name);
+	bench_report(what, CALLS, end - start, "calls");
+
+	start = bench_now();
+	for(int i = 0; i < CALLS; i++)
+		omat4x4f_transpose(a + (i & (INPUTS - 1)), c + (i & (INPUTS - 1)));
+	end = bench_now();
+	sink = c[7].arr[3];
+	snprintf(what, sizeof(what), "%s omat4x4f_transpose", be->name);
+	bench_report(what, CALLS, end - start, "calls");
+
+	// what it means for fusion
+	static fusion_sample samples[1024];
+	unsigned int seed = 1;
+	for(int i = 0; i < 1024; i++){
+		bench_imu_sample(&seed, &samples[i].ang_vel, &samples[i].accel, &samples[i].mag);
+		samples[i].dt = 0.001f;
+	}
+
+	fusion f;
+	ofusion_init(&f);
+	start = bench_now();
+	for(int i = 0; i < CALLS; i += 4)
+		ofusion_update_batch(&f, samples + (i & 1023), 4);
+	end = bench_now();
+	snprintf(what, sizeof(what), "%s complementary fusion", be->name);
+	bench_report(what, CALLS, end - start, "samples");
+}
+
+void bench_omath_backends()
+{
+	const omath_backend* backends[8];
+	const omath_backend* old = omath_get_backend();
+	int count = omath_get_backends(backends, 8);
+
+	for(int i = 0; i < count; i++)
+		bench_backend(backends[i]);
+
+	omath_set_backend(old);
+}
+
+#define POSES 1024
+#define POSE_ROUNDS (CALLS / POSES)
+
+// post processing recorded poses, one call per pose through the scalar API against one call per batch
+static void bench_soa(const omath_backend* be)
+{
+	static quatf q[POSES], q2[POSES], qout[POSES];
+	static vec3f v[POSES], vout[POSES];
+	static mat4x4f m[POSES];
+	static float sa[4][POSES], sb[4][POSES], sr[4][POSES], sv[3][POSES], svr[3][POSES], t[POSES];
+	quatf_soa qa = { sa[0], sa[1], sa[2], sa[3] }, qb = { sb[0], sb[1], sb[2], sb[3] };
+	quatf_soa qr = { sr[0], sr[1], sr[2], sr[3] };
+	vec3f_soa va = { sv[0], sv[1], sv[2] }, vr = { svr[0], svr[1], svr[2] };
+	char what[64];
+
+	for(int i = 0; i < POSES; i++){
+		vec3f axis = {{ 0.1f * i, 1.0f, -0.05f * i }};
+		oquatf_init_axis(q + i, &axis, 0.01f * i);
+		oquatf_init_axis(q2 + i, &axis, -0.02f * i);
+		v[i].x = 0.1f * i;
+		v[i].y = 9.81f;
+		v[i].z = -0.2f;
+		t[i] = (float)i / POSES;
+
+		for(int j = 0; j < 4; j++){
+			sa[j][i] = q[i].arr[j];
+			sb[j][i] = q2[i].arr[j];
+		}
+		for(int j = 0; j < 3; j++)
+			sv[j][i] = v[i].arr[j];
+	}
+
+	omath_set_backend(be);
+
+	double start = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		for(int i = 0; i < POSES; i++)
+			oquatf_mult(q + i, q2 + i, qout + i);
+	double mid = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		oquatf_soa_mult(&qa, &qb, &qr, POSES);
+	double end = bench_now();
+	sink = qout[3].w + sr[3][3];
+	snprintf(what, sizeof(what), "%s oquatf_mult", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, mid - start, "poses");
+	snprintf(what, sizeof(what), "%s oquatf_soa_mult", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, end - mid, "poses");
+
+	start = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		for(int i = 0; i < POSES; i++)
+			oquatf_get_rotated(q + i, v + i, vout + i);
+	mid = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		oquatf_soa_get_rotated(&qa, &va, &vr, POSES);
+	end = bench_now();
+	sink = vout[3].y + svr[1][3];
+	snprintf(what, sizeof(what), "%s oquatf_get_rotated", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, mid - start, "poses");
+	snprintf(what, sizeof(what), "%s oquatf_soa_get_rotated", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, end - mid, "poses");
+
+	start = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		for(int i = 0; i < POSES; i++)
+			oquatf_normalize_me(q + i);
+	mid = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		oquatf_soa_normalize_me(&qa, POSES);
+	end = bench_now();
+	sink = q[5].w + sa[3][5];
+	snprintf(what, sizeof(what), "%s oquatf_normalize_me", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, mid - start, "poses");
+	snprintf(what, sizeof(what), "%s oquatf_soa_normalize_me", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, end - mid, "poses");
+
+	start = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		for(int i = 0; i < POSES; i++)
+			oquatf_get_mat4x4(q + i, v + i, m[i].m);
+	mid = bench_now();
+	for(int r = 0; r < POSE_ROUNDS; r++)
+		oquatf_soa_get_mat4x4(&qa, &va, m, POSES);
+	end = bench_now();
+	sink = m[7].arr[3];
+	snprintf(what, sizeof(what), "%s oquatf_get_mat4x4", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, mid - start, "poses");
+	snprintf(what, sizeof(what), "%s oquatf_soa_get_mat4x4", be->name);
+	bench_report(what, POSE_ROUNDS * POSES, end - mid, "poses");
+
+	// the same loop either way, shows what the gathering costs next to the sines
+	const int slerp_rounds = POSE_ROUNDS / 8;
+	start = bench_now();
+	for(int r = 0; r < slerp_rounds; r++)
+		for(int i = 0; i < POSES; i++)
+			oquatf_slerp(t[i], q + i, q2 + i, true, qout + i);
+	mid = bench_now();
+	for(int r = 0; r < slerp_rounds; r++)
+		oquatf_soa_slerp(t, &qa, &qb, &qr, POSES);
+	end = bench_now();
+	sink = qout[3].w + sr[3][3];
+	snprintf(what, sizeof(what), "%s oquatf_slerp", be->name);
+	bench_report(what, slerp_rounds * POSES, mid - start, "poses");
+	snprintf(what, sizeof(what), "%s oquatf_soa_slerp", be->name);
+	bench_report(what, slerp_rounds * POSES, end - mid, "poses");
+}
+
+void bench_omath_soa()
+{
+	const omath_backend* backends[8];
+	const omath_backend* old = omath_get_backend();
+	int count = omath_get_backends(backends, 8);
+
+	for(int i = 0; i < count; i++)
+		bench_soa(backends[i]);
+
+	omath_set_backend(old);
+}
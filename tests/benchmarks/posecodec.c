@@ -0,0 +1,116 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - Compressed Pose Encoding */
+
+#include <string.h>
+#include "benchmarks.h"
+#include "posecodec.h"
+
+#define POSES 600000 // ten minutes at 1 kHz
+#define LOOKUPS 200000
+#define BLOCK_POSES 256
+
+// a tracked hand at 1 kHz, or one lying on the table, timestamps from a host clock with some jitter
+static void make_poses(ohmd_pose* poses, int count, bool moving)
+{
+	unsigned int seed = 9;
+	vec3f gyro, accel, mag;
+
+	for(int i = 0; i < count; i++){
+		float t = moving ? i * 0.001f : 0;
+		vec3f axis = {{ sinf(0.3f * t), cosf(0.2f * t), 0.3f }};
+		ovec3f_normalize_me(&axis);
+
+		bench_imu_sample(&seed, &gyro, &accel, &mag);
+		poses[i].timestamp_ns = 5000000000ull + i * 1000000ull + (uint64_t)((gyro.x + 0.5f) * 50000);
+		oquatf_init_axis(&poses[i].rotation, &axis, 2.0f * sinf(0.9f * t) + 0.1f);
+		poses[i].position.x = 0.3f * sinf(1.7f * t) + 0.0002f * accel.x;
+		poses[i].position.y = 1.2f + 0.15f * cosf(2.3f * t) + 0.0002f * accel.z;
+		poses[i].position.z = -0.3f + 0.2f * sinf(0.8f * t) + 0.0002f * gyro.y;
+	}
+}
+
+static void bench_pose_log(const char* what, bool moving)
+{
+	ohmd_pose* poses = calloc(POSES, sizeof(ohmd_pose));
+	ohmd_pose_log log;
+	ohmd_pose pose;
+	char line[64];
+
+	make_poses(poses, POSES, moving);
+	ohmd_pose_log_init(&log, BLOCK_POSES);
+
+	double start = bench_now();
+	for(int i = 0; i < POSES; i++)
+		ohmd_pose_log_append(&log, poses + i);
+	double end = bench_now();
+
+	printf("   %s: %.2f bytes per pose, %.1f%% of the floats, %.1f%% of a stream packet\n", what,
+	       (double)log.size / POSES, 100.0 * log.size / (POSES * 36.0), 100.0 * log.size / (POSES * (double)OHMD_STREAM_POSE_SIZE));
+	printf("   %-44s %12.1f kB, %d blocks\n", "ten minutes of one device", log.size / 1024.0, log.num_blocks);
+
+	snprintf(line, sizeof(line), "encode, %s", what);
+	bench_report(line, POSES, end - start, "poses");
+
+	// the whole log in order
+	ohmd_pose_codec decoder;
+	float checksum = 0;
+	ohmd_pose_codec_reset(&decoder);
+
+	start = bench_now();
+	for(uint32_t offset = 0; offset < log.size;){
+		offset += ohmd_pose_decode(&decoder, log.data + offset, log.size - offset, &pose);
+		checksum += pose.position.x;
+	}
+	end = bench_now();
+
+	snprintf(line, sizeof(line), "decode, %s", what);
+	bench_report(line, POSES, end - start, "poses");
+	printf("   %-44s %12.1f MB/s of floats\n", "", POSES * 36.0 / (end - start) / 1e6);
+
+	// a pose by time, anywhere in the ten minutes
+	unsigned int seed = 4;
+	uint64_t span = poses[POSES - 1].timestamp_ns - poses[0].timestamp_ns;
+
+	start = bench_now();
+	for(int i = 0; i < LOOKUPS; i++){
+		seed = seed * 1664525u + 1013904223u;
+		ohmd_pose_log_find(&log, poses[0].timestamp_ns + (uint64_t)((double)seed / 4294967296.0 * span), &pose);
+		checksum += pose.position.y;
+	}
+	end = bench_now();
+
+	snprintf(line, sizeof(line), "find by time, %s", what);
+	bench_report(line, LOOKUPS, end - start, "lookups");
+
+	// the largest error, so the compression is not bought with accuracy
+	float worst_rotation = 0, worst_position = 0;
+	ohmd_pose_codec_reset(&decoder);
+	for(uint32_t offset = 0, i = 0; offset < log.size; i++){
+		offset += ohmd_pose_decode(&decoder, log.data + offset, log.size - offset, &pose);
+
+		quatf diff, inverse = pose.rotation;
+		oquatf_inverse(&inverse);
+		oquatf_mult(&inverse, &poses[i].rotation, &diff);
+		worst_rotation = OHMD_MAX(worst_rotation, 2.0f * sqrtf(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z));
+
+		for(int j = 0; j < 3; j++)
+			worst_position = OHMD_MAX(worst_position, fabsf(pose.position.arr[j] - poses[i].position.arr[j]));
+	}
+	printf("   %-44s %12.4f deg, %.3f mm (checksum %.0f)\n", "largest error", worst_rotation * 180.0f / (float)M_PI,
+	       worst_position * 1000.0f, checksum);
+
+	ohmd_pose_log_free(&log);
+	free(poses);
+}
+
+void bench_pose_encoding()
+{
+	bench_pose_log("moving", true);
+	bench_pose_log("at rest", false);
+}
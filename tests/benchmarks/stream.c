@@ -0,0 +1,88 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Benchmarks - UDP Pose Streaming */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "benchmarks.h"
+#include "stream.h"
+
+#define PACKETS 2000
+#define PORT 45732
+
+static int compare_double(const void* a, const void* b)
+{
+	double d = *(const double*)a - *(const double*)b;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+void bench_stream_loopback_latency()
+{
+	static double latency[PACKETS];
+
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	struct timeval timeout = { 1, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+		printf("   could not bind to port %d, skipping\n", PORT);
+		close(fd);
+		return;
+	}
+
+	ohmd_context* ctx = ohmd_ctx_create();
+	int num_devices = ohmd_ctx_probe(ctx);
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+
+	if(!hmd || ohmd_ctx_stream_start(ctx, "127.0.0.1", PORT, 1) != OHMD_S_OK){
+		printf("   could not start streaming: %s\n", ohmd_ctx_get_error(ctx));
+		ohmd_ctx_destroy(ctx);
+		close(fd);
+		return;
+	}
+
+	// from the update thread right after fusion to the receiving process
+	int count = 0;
+	while(count < PACKETS){
+		ohmd_stream_packet pkt;
+		if(recv(fd, &pkt, sizeof(pkt), 0) < OHMD_STREAM_POSE_SIZE)
+			break;
+
+		double now = bench_now();
+		latency[count++] = (now - (double)pkt.timestamp_ns / 1e9) * 1e6;
+	}
+
+	ohmd_ctx_destroy(ctx);
+	close(fd);
+
+	if(count == 0){
+		printf("   no packets received\n");
+		return;
+	}
+
+	qsort(latency, count, sizeof(double), compare_double);
+
+	double sum = 0;
+	for(int i = 0; i < count; i++)
+		sum += latency[i];
+
+	printf("   %d poses over loopback, latency in us: mean %.1f, p50 %.1f, p99 %.1f, max %.1f\n",
+		count, sum / count, latency[count / 2], latency[count * 99 / 100], latency[count - 1]);
+}
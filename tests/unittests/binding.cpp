@@ -0,0 +1,79 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - C++ binding */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "openhmd.hpp"
+
+// tests.h pulls in the internal interface, which is C only
+#define TAssert(_v) if(!(_v)){ printf("\ntest failed: %s @ %s:%d\n", __func__, __FILE__, __LINE__); exit(1); }
+
+static_assert(std::is_same<openhmd::Rotation::type, openhmd::quatf>::value, "");
+static_assert(openhmd::LeftEyeView::count == 16, "");
+static_assert(!std::is_copy_constructible<openhmd::device>::value, "");
+static_assert(std::is_nothrow_move_constructible<openhmd::device>::value, "");
+
+extern "C" void test_cpp_binding()
+{
+	openhmd::context ctx;
+	int num_devices = ctx.probe();
+	TAssert(num_devices > 0);
+
+	int index = -1;
+	for(int i = 0; i < num_devices; i++)
+		if(ctx.list_gets(i, OHMD_PRODUCT) == "HMD Null Device")
+			index = i;
+	TAssert(index >= 0);
+	TAssert(ctx.list_get<openhmd::DeviceClass>(index) == OHMD_DEVICE_CLASS_HMD);
+
+	openhmd::device hmd = ctx.open(index, ctx.settings().automatic_update(false));
+	TAssert(hmd);
+
+	float c_rot[4];
+	ohmd_device_getf(hmd.get(), OHMD_ROTATION_QUAT, c_rot);
+	openhmd::quatf rot = hmd.get<openhmd::Rotation>();
+	TAssert(rot.x == c_rot[0] && rot.y == c_rot[1] && rot.z == c_rot[2] && rot.w == c_rot[3]);
+	TAssert(hmd.get<openhmd::ScreenHorizontalResolution>() == 1280);
+
+	hmd.set<openhmd::EyeIpd>(.07f);
+	TAssert(std::fabs(hmd.get<openhmd::EyeIpd>() - .07f) < .0001f);
+
+	float c_view[16], c_proj[16];
+	ohmd_device_getf(hmd.get(), OHMD_LEFT_EYE_GL_MODELVIEW_MATRIX, c_view);
+	ohmd_device_getf(hmd.get(), OHMD_LEFT_EYE_GL_PROJECTION_MATRIX, c_proj);
+
+	auto [view, proj, pos] = hmd.get<openhmd::LeftEyeView, openhmd::LeftEyeProjection, openhmd::Position>();
+	for(int i = 0; i < 16; i++)
+		TAssert(view.m[i] == c_view[i] && proj.m[i] == c_proj[i]);
+	TAssert(pos.x == 0.0f && pos.y == 0.0f && pos.z == 0.0f);
+
+	std::vector<float> state(hmd.get<openhmd::ControlCount>());
+	TAssert(hmd.controls_state(state) == 2 && state[1] == 1.0f);
+
+	ctx.update();
+	ohmd_control_event events[8];
+	TAssert(hmd.poll_control_events(events) == 2);
+
+	bool threw = false;
+	try {
+		ohmd_imu_sample samples[1] = {};
+		hmd.push_imu_samples(samples);
+	} catch(const openhmd::error& e) {
+		threw = e.status() == OHMD_S_UNSUPPORTED;
+	}
+	TAssert(threw);
+
+	openhmd::device moved = std::move(hmd);
+	TAssert(!hmd && moved);
+	moved.reset();
+	TAssert(!moved);
+}
@@ -0,0 +1,591 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - Sensor Fusion Tests */
+
+#include <string.h>
+#include "tests.h"
+
+#define NUM_SAMPLES 6000
+
+static float rand_unit(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 24) - 0.5f;
+}
+
+// a device that is turned around slowly and then held still, so the gravity correction kicks in
+static void make_samples(fusion_sample* samples, int count)
+{
+	unsigned int seed = 7;
+
+	for(int i = 0; i < count; i++){
+		fusion_sample* s = samples + i;
+		float turn = i < count / 2 ? 0.5f : 0.0f;
+
+		s->dt = 0.001f;
+		s->ang_vel.x = rand_unit(&seed) * 0.01f;
+		s->ang_vel.y = turn + rand_unit(&seed) * 0.01f;
+		s->ang_vel.z = rand_unit(&seed) * 0.01f;
+		s->accel.x = 1.0f + rand_unit(&seed) * 0.05f;
+		s->accel.y = 9.8f + rand_unit(&seed) * 0.05f;
+		s->accel.z = rand_unit(&seed) * 0.05f;
+		s->mag.x = s->mag.y = s->mag.z = 0;
+	}
+}
+
+static bool quatf_eq(quatf q1, quatf q2, float t)
+{
+	for(int i = 0; i < 4; i++)
+		if(!float_eq(q1.arr[i], q2.arr[i], t)){
+			printf("\nquat.arr[%d] == %f, expected %f\n", i, q1.arr[i], q2.arr[i]);
+			return false;
+		}
+
+	return true;
+}
+
+void test_ofusion_update_batch()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	make_samples(samples, NUM_SAMPLES);
+
+	fusion single, batch;
+	ofusion_init(&single);
+	ofusion_init(&batch);
+
+	for(int i = 0; i < NUM_SAMPLES; i++)
+		ofusion_update(&single, samples[i].dt, &samples[i].ang_vel, &samples[i].accel, &samples[i].mag);
+
+	// reports of four samples, like the WMR sends them
+	for(int i = 0; i < NUM_SAMPLES; i += 4)
+		ofusion_update_batch(&batch, samples + i, 4);
+
+	TAssert(batch.iterations == single.iterations);
+	TAssert(float_eq(batch.time, single.time, .0001f));
+	TAssert(float_eq(oquatf_get_length(&batch.orient), 1.0f, .0001f));
+	TAssert(quatf_eq(batch.orient, single.orient, .001f));
+	TAssert(vec3f_eq(batch.ang_vel, single.ang_vel, .0001f));
+
+	// an empty batch changes nothing
+	quatf before = batch.orient;
+	ofusion_update_batch(&batch, samples, 0);
+	TAssert(memcmp(&batch.orient, &before, sizeof(quatf)) == 0);
+}
+
+void test_ofusion_defer()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	make_samples(samples, NUM_SAMPLES);
+
+	fusion eager, lazy;
+	fusion_sample pending[100];
+	ofusion_init(&eager);
+	ofusion_init(&lazy);
+	ofusion_defer(&lazy, pending, 100);
+
+	ofusion_update_batch(&eager, samples, 30);
+	ofusion_update_batch(&lazy, samples, 30);
+	TAssert(lazy.pending_count == 30 && lazy.iterations == 0);
+
+	// crossing the high-water mark fuses what fits and keeps the rest
+	ofusion_update_batch(&eager, samples + 30, 90);
+	ofusion_update_batch(&lazy, samples + 30, 90);
+	TAssert(lazy.pending_count == 20 && lazy.iterations == 100);
+
+	ofusion_flush(&lazy);
+	TAssert(lazy.pending_count == 0 && lazy.iterations == 120);
+	TAssert(quatf_eq(lazy.orient, eager.orient, .001f));
+
+	// turning deferral off fuses the rest
+	ofusion_update_batch(&lazy, samples + 120, 10);
+	ofusion_defer(&lazy, NULL, 0);
+	TAssert(lazy.pending == NULL && lazy.iterations == 130);
+}
+
+void test_ofusion_eskf()
+{
+	// held still, tilted 0.3 rad around z, with a gyro bias
+	quatf tilt;
+	vec3f z_axis = {{ 0, 0, 1 }}, up = {{ 0, 1, 0 }};
+	oquatf_init_axis(&tilt, &z_axis, 0.3f);
+
+	quatf inv = {{ -tilt.x, -tilt.y, -tilt.z, tilt.w }};
+	vec3f gravity_body;
+	oquatf_get_rotated(&inv, &up, &gravity_body);
+
+	vec3f bias = {{ 0.01f, -0.02f, 0.005f }};
+
+	fusion f;
+	ofusion_init(&f);
+	ofusion_set_engine(&f, &ofusion_eskf);
+	TAssert(f.engine == &ofusion_eskf);
+
+	fusion_sample s;
+	s.dt = 0.001f;
+	s.ang_vel = bias;
+	s.accel.x = gravity_body.x * 9.81f;
+	s.accel.y = gravity_body.y * 9.81f;
+	s.accel.z = gravity_body.z * 9.81f;
+	s.mag.x = s.mag.y = s.mag.z = 0;
+
+	for(int i = 0; i < 5000; i++)
+		ofusion_update_batch(&f, &s, 1);
+
+	// the tilt is found within a few seconds
+	vec3f up_est;
+	oquatf_get_rotated(&f.orient, &gravity_body, &up_est);
+	TAssert(vec3f_eq(up_est, up, .01f));
+
+	// the bias is learned, apart from the part around gravity which the accelerometer can't see
+	vec3f bias_err;
+	ovec3f_subtract(&bias, &f.gyro_bias, &bias_err);
+	float along = ovec3f_get_dot(&bias_err, &gravity_body);
+	vec3f across = {{ bias_err.x - along * gravity_body.x, bias_err.y - along * gravity_body.y, bias_err.z - along * gravity_body.z }};
+	TAssert(ovec3f_get_length(&across) < .002f);
+
+	// and the covariance stays sane
+	for(int i = 0; i < FUSION_ESKF_STATES; i++){
+		TAssert(f.state.eskf.P[i][i] > 0);
+		for(int j = 0; j < FUSION_ESKF_STATES; j++)
+			TAssert(f.state.eskf.P[i][j] == f.state.eskf.P[j][i]);
+	}
+
+	// switching engines keeps the orientation
+	quatf before = f.orient;
+	ofusion_set_engine(&f, &ofusion_complementary);
+	TAssert(quatf_eq(f.orient, before, 0.0001f));
+	TAssert(ofusion_get_engine(OHMD_FUSION_ESKF) == &ofusion_eskf);
+	TAssert(ofusion_get_engine(-1) == NULL);
+}
+
+// runs an engine on a device held still, tilted 0.3 rad around z, and returns how far off its idea of up is
+static float still_tilt_error_params(fusion* f, const fusion_engine* engine, const fusion_params* params,
+                                    const vec3f* bias, int count)
+{
+	quatf tilt;
+	vec3f z_axis = {{ 0, 0, 1 }}, up = {{ 0, 1, 0 }};
+	oquatf_init_axis(&tilt, &z_axis, 0.3f);
+
+	quatf inv = {{ -tilt.x, -tilt.y, -tilt.z, tilt.w }};
+	vec3f gravity_body;
+	oquatf_get_rotated(&inv, &up, &gravity_body);
+
+	// the engine on its own, without the background bias estimation
+	ofusion_init(f);
+	f->flags &= ~FF_ESTIMATE_BIAS;
+	ofusion_set_engine(f, engine);
+	ofusion_set_params(f, params);
+
+	fusion_sample s[4];
+	for(int i = 0; i < 4; i++){
+		s[i].dt = 0.01f;
+		s[i].ang_vel = *bias;
+		s[i].accel.x = gravity_body.x * 9.81f;
+		s[i].accel.y = gravity_body.y * 9.81f;
+		s[i].accel.z = gravity_body.z * 9.81f;
+		s[i].mag.x = s[i].mag.y = s[i].mag.z = 0;
+	}
+
+	for(int i = 0; i < count; i += 4)
+		ofusion_update_batch(f, s, 4);
+
+	vec3f up_est, diff;
+	oquatf_get_rotated(&f->orient, &gravity_body, &up_est);
+	ovec3f_subtract(&up_est, &up, &diff);
+
+	return ovec3f_get_length(&diff);
+}
+
+static float still_tilt_error(fusion* f, const fusion_engine* engine, const vec3f* bias, int count)
+{
+	return still_tilt_error_params(f, engine, &ofusion_default_params, bias, count);
+}
+
+void test_ofusion_mahony_madgwick()
+{
+	fusion f;
+	vec3f no_bias = {{ 0, 0, 0 }}, bias = {{ 0.01f, 0, 0.02f }};
+
+	TAssert(ofusion_get_engine(OHMD_FUSION_MAHONY) == &ofusion_mahony);
+	TAssert(ofusion_get_engine(OHMD_FUSION_MADGWICK) == &ofusion_madgwick);
+
+	// both find the tilt within 20 seconds
+	TAssert(still_tilt_error(&f, &ofusion_mahony, &no_bias, 2000) < .01f);
+	TAssert(still_tilt_error(&f, &ofusion_madgwick, &no_bias, 2000) < .01f);
+
+	// the integral term of mahony learns a bias across gravity, the tilt axes here
+	TAssert(still_tilt_error(&f, &ofusion_mahony, &bias, 40000) < .01f);
+	TAssert(float_eq(f.gyro_bias.x, bias.x, .001f));
+	TAssert(float_eq(f.gyro_bias.z, bias.z, .001f));
+
+	// without gravity the first order integration follows the gyro, 1 rad/s around y for one second
+	vec3f y_axis = {{ 0, 1, 0 }};
+	quatf expected;
+	oquatf_init_axis(&expected, &y_axis, 1.0f);
+
+	const fusion_engine* engines[2] = { &ofusion_mahony, &ofusion_madgwick };
+	for(int e = 0; e < 2; e++){
+		ofusion_init(&f);
+		ofusion_set_engine(&f, engines[e]);
+		f.flags = 0;
+
+		fusion_sample s = { 0.001f, {{ 0, 1, 0 }}, {{ 0, 0, 0 }}, {{ 0, 0, 0 }} };
+		for(int i = 0; i < 1000; i++)
+			ofusion_update_batch(&f, &s, 1);
+
+		TAssert(quatf_eq(f.orient, expected, .001f));
+		TAssert(float_eq(oquatf_get_length(&f.orient), 1.0f, .0001f));
+	}
+}
+
+void test_ofusion_params()
+{
+	fusion f;
+	vec3f no_bias = {{ 0, 0, 0 }};
+
+	ofusion_init(&f);
+	TAssert(memcmp(&f.params, &ofusion_default_params, sizeof(fusion_params)) == 0);
+	TAssert(f.accel_stats.size == ofusion_default_params.window_size);
+
+	fusion_params p = ofusion_default_params;
+	p.window_size = FUSION_WINDOW_SIZE + 1;
+	TAssert(!ofusion_set_params(&f, &p));
+	p.window_size = 0;
+	TAssert(!ofusion_set_params(&f, &p));
+	p = ofusion_default_params;
+	p.grav_gain = -1.0f;
+	TAssert(!ofusion_set_params(&f, &p));
+	TAssert(memcmp(&f.params, &ofusion_default_params, sizeof(fusion_params)) == 0);
+
+	// larger windows take storage from the caller, which has to fit the window
+	vec3f window[40];
+	p = ofusion_default_params;
+	p.window_size = 40;
+	TAssert(ofusion_set_window(&f, window, 40));
+	TAssert(ofusion_set_params(&f, &p));
+	TAssert(f.accel_stats.size == 40 && f.accel_stats.count == 0);
+	TAssert(!ofusion_set_window(&f, NULL, 0));
+
+	// fusion holds no pointers into itself, a copy fuses on its own
+	static fusion_sample samples[NUM_SAMPLES];
+	make_samples(samples, NUM_SAMPLES);
+
+	fusion ref, copy;
+	ofusion_init(&ref);
+	ofusion_init(&f);
+	ofusion_update_batch(&ref, samples, NUM_SAMPLES / 2);
+	ofusion_update_batch(&f, samples, NUM_SAMPLES / 2);
+	copy = f;
+	for(int i = NUM_SAMPLES / 2; i < NUM_SAMPLES; i += 4){
+		ofusion_update_batch(&ref, samples + i, 4);
+		ofusion_update_batch(&f, samples + i, 4);
+		ofusion_update_batch(&copy, samples + i, 4);
+	}
+	TAssert(memcmp(&f.orient, &ref.orient, sizeof(quatf)) == 0 && memcmp(&copy.orient, &ref.orient, sizeof(quatf)) == 0);
+
+	// the complementary filter corrects the tilt of a device held still with the defaults, but not when the
+	// device has to be level for longer than the recording
+	TAssert(still_tilt_error(&f, &ofusion_complementary, &no_bias, 2000) < .01f);
+
+	p = ofusion_default_params;
+	p.level_samples = 100000;
+	TAssert(still_tilt_error_params(&f, &ofusion_complementary, &p, &no_bias, 2000) > .2f);
+}
+
+void test_ofusion_preintegration()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	fusion f, ref, plain;
+
+	ofusion_init(&f);
+	TAssert(!ofusion_set_preintegration(&f, -1));
+	TAssert(!ofusion_set_preintegration(&f, FUSION_MAX_PREINTEGRATE + 1));
+
+	// coning, the angular velocity turns around z at 10 Hz, without gravity so only the gyro path is compared
+	for(int i = 0; i < NUM_SAMPLES; i++){
+		float t = i * 0.001f;
+		samples[i].dt = 0.001f;
+		samples[i].ang_vel.x = 1.5f * cosf(2.0f * (float)M_PI * 10.0f * t);
+		samples[i].ang_vel.y = 1.5f * sinf(2.0f * (float)M_PI * 10.0f * t);
+		samples[i].ang_vel.z = 0.3f;
+		samples[i].accel.x = samples[i].accel.z = 0;
+		samples[i].accel.y = 9.81f;
+		samples[i].mag.x = samples[i].mag.y = samples[i].mag.z = 0;
+	}
+
+	ofusion_init(&ref);
+	ofusion_init(&plain);
+	ref.flags = f.flags = plain.flags = 0;
+	TAssert(ofusion_set_preintegration(&f, 4));
+
+	for(int i = 0; i < NUM_SAMPLES; i += 4){
+		ofusion_update_batch(&ref, samples + i, 4);
+		ofusion_update_batch(&f, samples + i, 4);
+
+		// the mean angular velocity of the four samples, what pre-integration without coning compensation fuses
+		fusion_sample mean = samples[i];
+		mean.dt = 0;
+		mean.ang_vel.x = mean.ang_vel.y = mean.ang_vel.z = 0;
+		for(int j = 0; j < 4; j++){
+			mean.dt += samples[i + j].dt;
+			for(int k = 0; k < 3; k++)
+				mean.ang_vel.arr[k] += samples[i + j].ang_vel.arr[k] * 0.25f;
+		}
+		ofusion_update_batch(&plain, &mean, 1);
+	}
+
+	TAssert(f.iterations == ref.iterations / 4);
+	TAssert(float_eq(f.time, ref.time, .005f));
+
+	float coned = 0, unconed = 0;
+	for(int k = 0; k < 4; k++){
+		coned += fabsf(f.orient.arr[k] - ref.orient.arr[k]);
+		unconed += fabsf(plain.orient.arr[k] - ref.orient.arr[k]);
+	}
+	TAssert(quatf_eq(f.orient, ref.orient, .001f));
+	TAssert(coned < unconed * 0.1f);
+
+	// a partial step waits for the rest of its samples, changing the size fuses it
+	ofusion_init(&f);
+	TAssert(ofusion_set_preintegration(&f, 4));
+	ofusion_update_batch(&f, samples, 10);
+	TAssert(f.iterations == 2 && f.preint.count == 2);
+	TAssert(ofusion_set_preintegration(&f, 0));
+	TAssert(f.iterations == 3 && f.preint.count == 0);
+	TAssert(float_eq(f.time, 0.010f, .00001f));
+
+	// the accelerometer mean is taken in the body frame at the end of the step, for a device turning about z
+	// at 2 rad/s the plain mean of eight samples would be 0.07 m/s^2 off in x
+	ofusion_init(&f);
+	f.flags = 0;
+	TAssert(ofusion_set_preintegration(&f, 8));
+	for(int i = 0; i < 8; i++){
+		float angle = 2.0f * (i + 1) * 0.001f;
+		samples[i].dt = 0.001f;
+		samples[i].ang_vel.x = samples[i].ang_vel.y = 0;
+		samples[i].ang_vel.z = 2.0f;
+		samples[i].accel.x = 9.81f * sinf(angle);
+		samples[i].accel.y = 9.81f * cosf(angle);
+		samples[i].accel.z = 0;
+	}
+	ofusion_update_batch(&f, samples, 8);
+	TAssert(f.iterations == 1);
+	TAssert(vec3f_eq(f.accel, samples[7].accel, .005f));
+}
+
+void test_ofusion_fixed()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	make_samples(samples, NUM_SAMPLES);
+
+	fusion fixed, ref;
+	vec3f no_bias = {{ 0, 0, 0 }};
+
+	TAssert(ofusion_get_engine(OHMD_FUSION_FIXED) == &ofusion_fixed);
+
+	// the gyro path follows the float one, the table lookups and rounding stay far below a milliradian
+	ofusion_init(&fixed);
+	ofusion_init(&ref);
+	ofusion_set_engine(&fixed, &ofusion_fixed);
+	fixed.flags = ref.flags = 0;
+
+	for(int i = 0; i < NUM_SAMPLES; i += 4){
+		ofusion_update_batch(&fixed, samples + i, 4);
+		ofusion_update_batch(&ref, samples + i, 4);
+	}
+
+	TAssert(fixed.iterations == ref.iterations);
+	TAssert(float_eq(fixed.time, ref.time, .005f)); // the float path rounds the sum of every dt
+	TAssert(float_eq(oquatf_get_length(&fixed.orient), 1.0f, .0001f));
+	TAssert(quatf_eq(fixed.orient, ref.orient, .001f));
+	TAssert(vec3f_eq(fixed.ang_vel, ref.ang_vel, .0001f));
+
+	// and so does the gravity correction
+	TAssert(still_tilt_error(&fixed, &ofusion_fixed, &no_bias, 2000) < .01f);
+
+	// the orientation carries over both ways
+	quatf before = fixed.orient;
+	ofusion_set_engine(&fixed, &ofusion_complementary);
+	ofusion_set_engine(&fixed, &ofusion_fixed);
+	ofusion_update_batch(&fixed, samples + NUM_SAMPLES - 1, 1);
+	TAssert(quatf_eq(fixed.orient, before, .001f));
+}
+
+static void make_still_samples(fusion_sample* samples, int count, const vec3f* bias, float gyro_noise)
+{
+	unsigned int seed = 11;
+
+	for(int i = 0; i < count; i++){
+		fusion_sample* s = samples + i;
+		s->dt = 0.001f;
+		s->ang_vel.x = bias->x + rand_unit(&seed) * gyro_noise;
+		s->ang_vel.y = bias->y + rand_unit(&seed) * gyro_noise;
+		s->ang_vel.z = bias->z + rand_unit(&seed) * gyro_noise;
+		s->accel.x = rand_unit(&seed) * 0.05f;
+		s->accel.y = 9.81f + rand_unit(&seed) * 0.05f;
+		s->accel.z = rand_unit(&seed) * 0.05f;
+		s->mag.x = s->mag.y = s->mag.z = 0;
+	}
+}
+
+void test_ofusion_bias()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	vec3f bias = {{ 0.012f, -0.009f, 0.006f }}, zero = {{ 0, 0, 0 }};
+	fusion f;
+
+	// fusion runs from the first sample, the bias is there after the first second at rest
+	make_still_samples(samples, NUM_SAMPLES, &bias, 0.01f);
+	ofusion_init(&f);
+	ofusion_update_batch(&f, samples, 900);
+	TAssert(f.iterations == 900 && !(f.flags & FF_GYRO_BIAS_VALID));
+	ofusion_update_batch(&f, samples + 900, 200);
+	TAssert(f.flags & FF_GYRO_BIAS_VALID);
+	TAssert(vec3f_eq(f.gyro_bias, bias, .001f));
+
+	ofusion_update_batch(&f, samples + 1100, NUM_SAMPLES - 1100);
+	TAssert(vec3f_eq(f.gyro_bias, bias, .0002f));
+
+	// a restored bias is refined slowly, ten seconds at rest take it two thirds of the way
+	vec3f restored = {{ 0.022f, -0.009f, 0.006f }};
+	ofusion_init(&f);
+	f.gyro_bias = restored;
+	f.flags |= FF_GYRO_BIAS_VALID;
+	for(int i = 0; i < 10000; i += 2000)
+		ofusion_update_batch(&f, samples, 2000);
+	TAssert(f.gyro_bias.x > .014f && f.gyro_bias.x < .017f);
+
+	// moving or turning steadily is not at rest
+	make_still_samples(samples, NUM_SAMPLES, &zero, 0.5f);
+	ofusion_init(&f);
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID));
+
+	vec3f turn = {{ 0, 0.5f, 0 }};
+	make_still_samples(samples, NUM_SAMPLES, &turn, 0.01f);
+	ofusion_init(&f);
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID) && vec3f_eq(f.gyro_bias, zero, .00001f));
+
+	// a slow pan of 3 degrees per second neither, nor a still half second before some of it
+	vec3f pan = {{ 0, 0.05f, 0 }};
+	make_still_samples(samples, NUM_SAMPLES, &pan, 0.01f);
+	ofusion_init(&f);
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID));
+
+	make_still_samples(samples, 500, &bias, 0.01f);
+	ofusion_init(&f);
+	for(int i = 0; i < 4; i++){
+		ofusion_update_batch(&f, samples, 500);
+		ofusion_update_batch(&f, samples + 500, 300);
+	}
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID));
+
+	// and it can be turned off
+	make_still_samples(samples, NUM_SAMPLES, &bias, 0.01f);
+	ofusion_init(&f);
+	f.flags &= ~FF_ESTIMATE_BIAS;
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID) && vec3f_eq(f.gyro_bias, zero, .00001f));
+
+	// it is left to engines that learn the bias from gravity, and takes over when they can't
+	ofusion_init(&f);
+	ofusion_set_engine(&f, &ofusion_mahony);
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert(!(f.flags & FF_GYRO_BIAS_VALID));
+
+	ofusion_init(&f);
+	ofusion_set_engine(&f, &ofusion_mahony);
+	f.flags &= ~FF_USE_GRAVITY;
+	ofusion_update_batch(&f, samples, NUM_SAMPLES);
+	TAssert((f.flags & FF_GYRO_BIAS_VALID) && vec3f_eq(f.gyro_bias, bias, .0002f));
+}
+
+// more devices than lanes and not a multiple of them, so every kernel runs a partial group
+#define BANK_DEVICES 11
+
+void test_ofusion_bank()
+{
+	static fusion_sample samples[NUM_SAMPLES];
+	static fusion_sample pending[2][BANK_DEVICES][FUSION_BANK_PENDING];
+	make_samples(samples, NUM_SAMPLES);
+
+	const omath_backend* backends[8];
+	const omath_backend* old = omath_get_backend();
+	int num_backends = omath_get_backends(backends, 8);
+
+	for(int be = 0; be < num_backends; be++){
+		fusion banked[BANK_DEVICES], ref[BANK_DEVICES];
+		fusion* members[BANK_DEVICES];
+		fusion_bank bank;
+
+		omath_set_backend(backends[be]);
+		ofusion_bank_init(&bank, members, BANK_DEVICES);
+
+		for(int j = 0; j < BANK_DEVICES; j++){
+			ofusion_init(&banked[j]);
+			ofusion_init(&ref[j]);
+			ofusion_defer(&banked[j], pending[0][j], FUSION_BANK_PENDING);
+			ofusion_defer(&ref[j], pending[1][j], FUSION_BANK_PENDING);
+			ofusion_set_engine(&ref[j], &ofusion_mahony);
+			TAssert(ofusion_bank_add(&bank, &banked[j]));
+			TAssert(banked[j].engine == &ofusion_mahony);
+		}
+
+		// every device waits on a different number of samples, the filter and the bias estimator run as on their own
+		for(int round = 0, first = 0; round < 20; round++){
+			for(int j = 0; j < BANK_DEVICES; j++){
+				int count = 20 + 4 * j;
+				ofusion_update_batch(&banked[j], samples + first + j * 37, count);
+				ofusion_update_batch(&ref[j], samples + first + j * 37, count);
+			}
+			first += 60;
+
+			ofusion_bank_flush(&bank);
+			for(int j = 0; j < BANK_DEVICES; j++)
+				ofusion_flush(&ref[j]);
+		}
+
+		for(int j = 0; j < BANK_DEVICES; j++){
+			TAssert(banked[j].pending_count == 0);
+			TAssert(banked[j].iterations == ref[j].iterations);
+			TAssert(float_eq(banked[j].time, ref[j].time, .0001f));
+			TAssert(quatf_eq(banked[j].orient, ref[j].orient, .0005f));
+			TAssert(vec3f_eq(banked[j].gyro_bias, ref[j].gyro_bias, .0001f));
+			TAssert(vec3f_eq(banked[j].ang_vel, ref[j].ang_vel, .0001f));
+		}
+
+		// a device that switched engines is flushed on its own, one without samples is left alone
+		ofusion_set_engine(&banked[0], &ofusion_complementary);
+		ofusion_update_batch(&banked[0], samples, 10);
+		int iterations = banked[1].iterations;
+		ofusion_bank_flush(&bank);
+		TAssert(banked[0].pending_count == 0 && banked[0].engine == &ofusion_complementary);
+		TAssert(banked[1].iterations == iterations);
+	}
+
+	omath_set_backend(old);
+
+	// adding twice is a no-op, a full bank refuses, removing frees the slot
+	fusion extra[3];
+	fusion* members[2];
+	fusion_bank bank;
+	ofusion_bank_init(&bank, members, 2);
+	for(int j = 0; j < 3; j++)
+		ofusion_init(&extra[j]);
+
+	TAssert(ofusion_bank_add(&bank, &extra[0]) && ofusion_bank_add(&bank, &extra[0]) && bank.count == 1);
+	TAssert(ofusion_bank_add(&bank, &extra[1]) && bank.count == 2);
+	TAssert(!ofusion_bank_add(&bank, &extra[2]) && extra[2].engine != &ofusion_mahony);
+	ofusion_bank_remove(&bank, &extra[0]);
+	TAssert(bank.count == 1 && members[0] == &extra[1]);
+	TAssert(ofusion_bank_add(&bank, &extra[2]) && bank.count == 2);
+
+	TAssert(ofusion_bank_kernel() != NULL);
+}
@@ -0,0 +1,77 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - HID Report Ring Tests */
+
+#include "tests.h"
+#include "hidreader.h"
+
+static void fill_report(unsigned char* data, uint32_t n)
+{
+	for(int i = 0; i < OHMD_HID_REPORT_SIZE; i++)
+		data[i] = (unsigned char)(n * 7 + i);
+}
+
+void test_ohmd_hid_ring()
+{
+	static ohmd_hid_ring ring;
+	unsigned char in[OHMD_HID_REPORT_SIZE], out[OHMD_HID_REPORT_SIZE];
+	uint64_t timestamp;
+	uint32_t pushed = 0, popped = 0;
+
+	memset(&ring, 0, sizeof(ring));
+	TAssert(ohmd_hid_ring_pop(&ring, out, sizeof(out), &timestamp) == 0);
+
+	// interleaved pushes and pops across many wraps of the indices, in order and intact
+	for(int round = 0; round < 1000; round++){
+		int burst = 1 + round % 37;
+
+		for(int i = 0; i < burst; i++, pushed++){
+			fill_report(in, pushed);
+			TAssert(ohmd_hid_ring_push(&ring, 1000 + pushed, in, 1 + pushed % OHMD_HID_REPORT_SIZE));
+		}
+
+		for(int i = 0; i < burst - round % 2; i++, popped++){
+			int size = ohmd_hid_ring_pop(&ring, out, sizeof(out), &timestamp);
+			TAssert(size == 1 + (int)(popped % OHMD_HID_REPORT_SIZE));
+			TAssert(timestamp == 1000 + popped);
+			fill_report(in, popped);
+			TAssert(memcmp(in, out, size) == 0);
+		}
+
+		// drain the backlog the odd rounds leave before it fills the ring
+		while(pushed - popped > OHMD_HID_RING_SIZE / 2){
+			TAssert(ohmd_hid_ring_pop(&ring, out, sizeof(out), NULL) > 0);
+			popped++;
+		}
+	}
+
+	while(ohmd_hid_ring_pop(&ring, out, sizeof(out), NULL) > 0)
+		popped++;
+	TAssert(popped == pushed);
+	TAssert(ring.dropped == 0);
+
+	// a full ring drops the new reports and keeps the old ones
+	for(int i = 0; i < OHMD_HID_RING_SIZE; i++){
+		fill_report(in, i);
+		TAssert(ohmd_hid_ring_push(&ring, i, in, OHMD_HID_REPORT_SIZE));
+	}
+
+	TAssert(!ohmd_hid_ring_push(&ring, 0, in, OHMD_HID_REPORT_SIZE));
+	TAssert(!ohmd_hid_ring_push(&ring, 0, in, OHMD_HID_REPORT_SIZE));
+	TAssert(ring.dropped == 2);
+
+	TAssert(ohmd_hid_ring_pop(&ring, out, sizeof(out), &timestamp) == OHMD_HID_REPORT_SIZE);
+	TAssert(timestamp == 0);
+
+	// space again after a pop, oversized reports are cut to the report size
+	TAssert(ohmd_hid_ring_push(&ring, 0, in, OHMD_HID_REPORT_SIZE + 16));
+
+	// the consumer's buffer limits the copy
+	TAssert(ohmd_hid_ring_pop(&ring, out, 8, &timestamp) == 8);
+	TAssert(timestamp == 1);
+}
@@ -7,9 +7,16 @@
 
 /* Unit Tests - High-level functions */
 
+#include <string.h>
 #include "tests.h"
 #include "openhmd.h"
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 void test_highlevel_open_close_device()
 {
 	ohmd_context* ctx = ohmd_ctx_create();
@@ -67,3 +74,596 @@ void test_highlevel_open_close_many_devices()
 	
 	ohmd_ctx_destroy(ctx);	
 }
+
+void test_highlevel_stream_loopback()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 1);
+
+	// the dummy left controller sits at x = -0.5
+	int left = -1, ext = -1;
+	for(int i = 0; i < num_devices; i++){
+		int flags = 0;
+		ohmd_list_geti(ctx, i, OHMD_DEVICE_FLAGS, &flags);
+		if((flags & OHMD_DEVICE_FLAGS_NULL_DEVICE) && (flags & OHMD_DEVICE_FLAGS_LEFT_CONTROLLER))
+			left = i;
+		if(strcmp(ohmd_list_gets(ctx, i, OHMD_PRODUCT), "External Device") == 0)
+			ext = i;
+	}
+	TAssert(left >= 0);
+
+	if(ext < 0){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_device* external = ohmd_list_open_device(ctx, ext);
+	TAssert(external);
+
+	if(ohmd_device_set_data(external, OHMD_EXTERNAL_STREAM_SOURCE, "127.0.0.1:45731:1") != OHMD_S_OK){
+		// no udp support on this platform
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_device* controller = ohmd_list_open_device(ctx, left);
+	TAssert(controller);
+
+	TAssert(ohmd_ctx_stream_start(ctx, "127.0.0.1", 45731, 2) == OHMD_S_OK);
+
+	float pos[3] = {0, 0, 0};
+	for(int i = 0; i < 200 && pos[0] == 0; i++){
+		ohmd_sleep(.005);
+		ohmd_ctx_update(ctx);
+		ohmd_device_getf(external, OHMD_POSITION_VECTOR, pos);
+	}
+
+	TAssert(float_eq(pos[0], -.5f, .0001f));
+
+	TAssert(ohmd_ctx_stream_stop(ctx) == OHMD_S_OK);
+	TAssert(ohmd_ctx_stream_stop(ctx) != OHMD_S_OK);
+
+	// and again with eight compressed poses per datagram
+	TAssert(ohmd_device_set_data(external, OHMD_EXTERNAL_STREAM_SOURCE, "127.0.0.1:45731:1") == OHMD_S_OK);
+	TAssert(ohmd_ctx_stream_start_batched(ctx, "127.0.0.1", 45731, 1, 0) == OHMD_S_INVALID_PARAMETER);
+	TAssert(ohmd_ctx_stream_start_batched(ctx, "127.0.0.1", 45731, 1, 33) == OHMD_S_INVALID_PARAMETER);
+	TAssert(ohmd_ctx_stream_start_batched(ctx, "127.0.0.1", 45731, 1, 8) == OHMD_S_OK);
+
+	pos[0] = 0;
+	for(int i = 0; i < 200 && pos[0] == 0; i++){
+		ohmd_sleep(.005);
+		ohmd_ctx_update(ctx);
+		ohmd_device_getf(external, OHMD_POSITION_VECTOR, pos);
+	}
+
+	TAssert(float_eq(pos[0], -.5f, .0001f));
+	TAssert(ohmd_ctx_stream_stop(ctx) == OHMD_S_OK);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_stream_devices()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	ohmd_context* ctx_recv = ohmd_ctx_create();
+	TAssert(ctx && ctx_recv);
+
+	// the dummy controllers sit at x = -0.5 and 0.5 and are streamed as devices 0 and 1
+	int num_devices = ohmd_ctx_probe(ctx);
+	int left = -1, right = -1;
+	for(int i = 0; i < num_devices; i++){
+		int flags = 0;
+		ohmd_list_geti(ctx, i, OHMD_DEVICE_FLAGS, &flags);
+		if((flags & OHMD_DEVICE_FLAGS_NULL_DEVICE) && (flags & OHMD_DEVICE_FLAGS_LEFT_CONTROLLER))
+			left = i;
+		if((flags & OHMD_DEVICE_FLAGS_NULL_DEVICE) && (flags & OHMD_DEVICE_FLAGS_RIGHT_CONTROLLER))
+			right = i;
+	}
+	TAssert(left >= 0 && right >= 0);
+
+	int num_recv = ohmd_ctx_probe(ctx_recv);
+	int ext = -1;
+	for(int i = 0; i < num_recv; i++)
+		if(strcmp(ohmd_list_gets(ctx_recv, i, OHMD_PRODUCT), "External Device") == 0)
+			ext = i;
+
+	if(ext < 0){
+		// external driver not built
+		ohmd_ctx_destroy(ctx_recv);
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_device* external = ohmd_list_open_device(ctx_recv, ext);
+	TAssert(external);
+
+	if(ohmd_device_set_data(external, OHMD_EXTERNAL_STREAM_SOURCE, "127.0.0.1:45732") != OHMD_S_OK){
+		// no udp support on this platform
+		ohmd_ctx_destroy(ctx_recv);
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	TAssert(ohmd_list_open_device(ctx, left) && ohmd_list_open_device(ctx, right));
+	TAssert(ohmd_ctx_stream_start(ctx, "127.0.0.1", 45732, 1) == OHMD_S_OK);
+
+	// both devices count their sequences from the same start, a receiver of every device takes the second one too
+	float pos[3] = {0, 0, 0};
+	for(int i = 0; i < 200 && pos[0] != .5f; i++){
+		ohmd_sleep(.005);
+		ohmd_ctx_update(ctx_recv);
+		ohmd_device_getf(external, OHMD_POSITION_VECTOR, pos);
+	}
+
+	TAssert(float_eq(pos[0], .5f, .0001f));
+
+	// and a receiver of one device only takes that one
+	TAssert(ohmd_device_set_data(external, OHMD_EXTERNAL_STREAM_SOURCE, "127.0.0.1:45732:0") == OHMD_S_OK);
+
+	for(int i = 0; i < 200 && pos[0] != -.5f; i++){
+		ohmd_sleep(.005);
+		ohmd_ctx_update(ctx_recv);
+		ohmd_device_getf(external, OHMD_POSITION_VECTOR, pos);
+	}
+
+	for(int i = 0; i < 10; i++){
+		ohmd_sleep(.005);
+		ohmd_ctx_update(ctx_recv);
+		ohmd_device_getf(external, OHMD_POSITION_VECTOR, pos);
+		TAssert(float_eq(pos[0], -.5f, .0001f));
+	}
+
+	TAssert(ohmd_ctx_stream_stop(ctx) == OHMD_S_OK);
+
+	ohmd_ctx_destroy(ctx_recv);
+	ohmd_ctx_destroy(ctx);
+}
+
+// the external device without automatic updates, configure adds the settings of the test unless it is NULL,
+// NULL only if the external driver isn't built
+static ohmd_device* open_external(ohmd_context* ctx, void (*configure)(ohmd_device_settings* settings))
+{
+	int num_devices = ohmd_ctx_probe(ctx);
+	for(int i = 0; i < num_devices; i++){
+		if(strcmp(ohmd_list_gets(ctx, i, OHMD_PRODUCT), "External Device") == 0){
+			ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+			int auto_update = 0;
+			ohmd_device_settings_seti(settings, OHMD_IDS_AUTOMATIC_UPDATE, &auto_update);
+			if(configure)
+				configure(settings);
+
+			ohmd_device* dev = ohmd_list_open_device_s(ctx, i, settings);
+			ohmd_device_settings_destroy(settings);
+			TAssert(dev);
+			return dev;
+		}
+	}
+
+	return NULL;
+}
+
+// level, turning at rate rad/s around y, 10 ms apart
+static void make_samples(ohmd_imu_sample* samples, int count, uint64_t start_ns, float rate)
+{
+	for(int i = 0; i < count; i++){
+		ohmd_imu_sample s = { start_ns + i * 10000000ull, { 0, rate, 0 }, { 0, 9.81f, 0 }, { 0, 0, 0 } };
+		samples[i] = s;
+	}
+}
+
+// the orientation after turning around y for the given time at 1 rad/s
+static bool turned(ohmd_device* dev, float seconds, float tolerance)
+{
+	float q[4];
+	ohmd_device_getf(dev, OHMD_ROTATION_QUAT, q);
+	return float_eq(q[0], 0, tolerance) && float_eq(q[1], sinf(seconds / 2), tolerance) &&
+	       float_eq(q[2], 0, tolerance) && float_eq(q[3], cosf(seconds / 2), tolerance);
+}
+
+void test_highlevel_push_imu_samples()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, NULL);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_imu_sample samples[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+
+	// split in two batches, the repeated sample must be skipped
+	TAssert(ohmd_device_push_imu_samples(dev, samples, 51) == OHMD_S_OK);
+	TAssert(ohmd_device_push_imu_samples(dev, samples + 50, 51) == OHMD_S_OK);
+
+	ohmd_ctx_update(ctx);
+	TAssert(turned(dev, 1, .001f));
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_imu_ring()
+{
+	ohmd_imu_ring* ring = ohmd_imu_ring_create("/openhmd-unittest-ring", 64);
+	if(!ring){
+		// no shared memory on this platform
+		return;
+	}
+
+	// the name is taken while the ring is in use
+	TAssert(ohmd_imu_ring_create("/openhmd-unittest-ring", 64) == NULL);
+
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, NULL);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		ohmd_imu_ring_destroy(ring);
+		return;
+	}
+
+	TAssert(ohmd_device_set_data(dev, OHMD_EXTERNAL_STREAM_SOURCE, "shm:/openhmd-unittest-ring-missing") != OHMD_S_OK);
+	TAssert(ohmd_device_set_data(dev, OHMD_EXTERNAL_STREAM_SOURCE, "shm:/openhmd-unittest-ring") == OHMD_S_OK);
+
+	// one second, more samples than the ring holds so it wraps
+	ohmd_imu_sample samples[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+
+	TAssert(ohmd_imu_ring_push(ring, samples, -1) == OHMD_S_INVALID_PARAMETER);
+	TAssert(ohmd_imu_ring_push(ring, NULL, 1) == OHMD_S_INVALID_PARAMETER);
+	TAssert(ohmd_imu_ring_push(ring, samples, 50) == 50);
+	TAssert(ohmd_imu_ring_push(ring, samples + 50, 51) == 14);
+	ohmd_ctx_update(ctx);
+	TAssert(ohmd_imu_ring_push(ring, samples + 64, 37) == 37);
+	ohmd_ctx_update(ctx);
+	TAssert(turned(dev, 1, .001f));
+
+	TAssert(ohmd_device_set_data(dev, OHMD_EXTERNAL_STREAM_SOURCE, NULL) == OHMD_S_OK);
+
+	ohmd_ctx_destroy(ctx);
+	ohmd_imu_ring_destroy(ring);
+}
+
+void test_highlevel_imu_socket()
+{
+#ifndef _WIN32
+	const char* path = "/tmp/openhmd-unittest.sock";
+
+	int listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	TAssert(listener >= 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	unlink(path);
+	TAssert(bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(listener, 1) == 0);
+
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, NULL);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		close(listener);
+		unlink(path);
+		return;
+	}
+
+	TAssert(ohmd_device_set_data(dev, OHMD_EXTERNAL_STREAM_SOURCE, "unix:/tmp/openhmd-unittest.sock") == OHMD_S_OK);
+
+	int conn = accept(listener, NULL, NULL);
+	TAssert(conn >= 0);
+
+	ohmd_imu_sample samples[101], fast[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+	make_samples(fast, 101, 5000000000ull, 5);
+
+	// part of a sample and more samples than a message may hold are dropped, they would turn the device too fast
+	TAssert(send(conn, fast, sizeof(ohmd_imu_sample) * 5 / 2, 0) > 0);
+	TAssert(send(conn, fast, sizeof(fast), 0) > 0);
+
+	TAssert(send(conn, samples, sizeof(ohmd_imu_sample) * 51, 0) > 0);
+	TAssert(send(conn, samples + 51, sizeof(ohmd_imu_sample) * 50, 0) > 0);
+
+	ohmd_ctx_update(ctx);
+	TAssert(turned(dev, 1, .001f));
+
+	// the source is dropped once the producer hangs up
+	close(conn);
+	ohmd_ctx_update(ctx);
+
+	ohmd_ctx_destroy(ctx);
+	close(listener);
+	unlink(path);
+#endif
+}
+
+void test_highlevel_control_events()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+	int auto_update = 0;
+	ohmd_device_settings_seti(settings, OHMD_IDS_AUTOMATIC_UPDATE, &auto_update);
+
+	// dummy device, controls are .1 and 1
+	ohmd_device* hmd = ohmd_list_open_device_s(ctx, num_devices - 1, settings);
+	TAssert(hmd);
+	ohmd_device_settings_destroy(settings);
+
+	ohmd_control_event events[4];
+	TAssert(ohmd_device_poll_control_events(hmd, events, 4) == 0);
+
+	ohmd_ctx_update(ctx);
+	ohmd_ctx_update(ctx);
+
+	// only one event per change, read in two goes
+	TAssert(ohmd_device_poll_control_events(hmd, events, 1) == 1);
+	TAssert(ohmd_device_poll_control_events(hmd, events + 1, 4) == 1);
+	TAssert(events[0].control == 0);
+	TAssert(float_eq(events[0].old_value, 0, .0001f));
+	TAssert(float_eq(events[0].new_value, .1f, .0001f));
+	TAssert(events[1].control == 1);
+	TAssert(float_eq(events[1].new_value, 1, .0001f));
+	TAssert(events[0].timestamp_ns > 0 && events[0].timestamp_ns == events[1].timestamp_ns);
+
+	TAssert(ohmd_device_poll_control_events(hmd, events, 4) == 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_shared_device()
+{
+	ohmd_context* ctx_a = ohmd_ctx_create();
+	ohmd_context* ctx_b = ohmd_ctx_create();
+	TAssert(ctx_a && ctx_b);
+
+	ohmd_device* dev_a = open_external(ctx_a, NULL);
+	if(!dev_a){
+		// external driver not built
+		ohmd_ctx_destroy(ctx_a);
+		ohmd_ctx_destroy(ctx_b);
+		return;
+	}
+
+	ohmd_device* dev_b = open_external(ctx_b, NULL);
+	TAssert(dev_b && dev_b != dev_a);
+
+	// half a second, fused once and seen by both contexts
+	ohmd_imu_sample samples[51];
+	make_samples(samples, 51, 1000000000ull, 1);
+	TAssert(ohmd_device_push_imu_samples(dev_a, samples, 51) == OHMD_S_OK);
+
+	float qa[4], qb[4];
+	ohmd_ctx_update(ctx_a);
+	ohmd_ctx_update(ctx_b);
+	ohmd_device_getf(dev_a, OHMD_ROTATION_QUAT, qa);
+	ohmd_device_getf(dev_b, OHMD_ROTATION_QUAT, qb);
+	TAssert(turned(dev_a, .5f, .001f));
+	for(int i = 0; i < 4; i++)
+		TAssert(qa[i] == qb[i]);
+
+	// the device outlives the context that opened it while the other one still uses it
+	ohmd_ctx_destroy(ctx_a);
+
+	for(int i = 0; i < 51; i++)
+		samples[i].timestamp_ns += 500000000ull;
+	TAssert(ohmd_device_push_imu_samples(dev_b, samples + 1, 50) == OHMD_S_OK);
+
+	ohmd_ctx_update(ctx_b);
+	TAssert(turned(dev_b, 1, .001f));
+
+	ohmd_ctx_destroy(ctx_b);
+}
+
+void test_highlevel_idle_parking()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+	int auto_update = 0, idle_ms = 5, bad_idle_ms = -1;
+	ohmd_device_settings_seti(settings, OHMD_IDS_AUTOMATIC_UPDATE, &auto_update);
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_IDLE_TIMEOUT_MS, &bad_idle_ms) != OHMD_S_OK);
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_IDLE_TIMEOUT_MS, &idle_ms) == OHMD_S_OK);
+
+	// dummy device, reports its controls on the first update it gets
+	ohmd_device* hmd = ohmd_list_open_device_s(ctx, num_devices - 1, settings);
+	TAssert(hmd);
+	ohmd_device_settings_destroy(settings);
+
+	ohmd_control_event events[4];
+
+	// parked before the first update
+	ohmd_sleep(.02);
+	ohmd_ctx_update(ctx);
+	TAssert(ohmd_device_poll_control_events(hmd, events, 4) == 0);
+
+	// the poll above resumed it
+	ohmd_ctx_update(ctx);
+	TAssert(ohmd_device_poll_control_events(hmd, events, 4) == 2);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+static void configure_lazy(ohmd_device_settings* settings)
+{
+	int lazy = 16, bad_lazy = -1;
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_LAZY_FUSION_SAMPLES, &bad_lazy) != OHMD_S_OK);
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_LAZY_FUSION_SAMPLES, &lazy) == OHMD_S_OK);
+}
+
+void test_highlevel_lazy_fusion()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, configure_lazy);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_imu_sample samples[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+
+	// below the high-water mark, up to it and past it, the query fuses the rest with the same result as fusing
+	// every sample
+	TAssert(ohmd_device_push_imu_samples(dev, samples, 11) == OHMD_S_OK);
+	TAssert(ohmd_device_push_imu_samples(dev, samples + 11, 5) == OHMD_S_OK);
+	TAssert(ohmd_device_push_imu_samples(dev, samples + 16, 85) == OHMD_S_OK);
+
+	ohmd_ctx_update(ctx);
+	TAssert(turned(dev, 1, .001f));
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_fusion_state()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, NULL);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	// devices without a serial number report an empty one
+	TAssert(ohmd_list_gets(ctx, 0, OHMD_SERIAL) != NULL);
+
+	// two seconds at rest with a gyro bias, the device drifts until the bias is measured
+	ohmd_imu_sample samples[201];
+	make_samples(samples, 201, 1000000000ull, .02f);
+	TAssert(ohmd_device_push_imu_samples(dev, samples, 201) == OHMD_S_OK);
+
+	float state[OHMD_FUSION_STATE_SIZE], q_saved[4];
+	TAssert(ohmd_device_getf(dev, OHMD_FUSION_STATE, state) == OHMD_S_OK);
+	ohmd_ctx_update(ctx);
+	ohmd_device_getf(dev, OHMD_ROTATION_QUAT, q_saved);
+	TAssert(q_saved[1] > .005f);
+
+	ohmd_close_device(dev);
+
+	// warm start, the orientation comes back and the bias is known from the first sample, so it doesn't drift
+	dev = open_external(ctx, NULL);
+	TAssert(ohmd_device_setf(dev, OHMD_FUSION_STATE, state) == OHMD_S_OK);
+
+	make_samples(samples, 101, 4000000000ull, .02f);
+	TAssert(ohmd_device_push_imu_samples(dev, samples, 101) == OHMD_S_OK);
+
+	float q[4];
+	ohmd_ctx_update(ctx);
+	ohmd_device_getf(dev, OHMD_ROTATION_QUAT, q);
+	for(int i = 0; i < 4; i++)
+		TAssert(float_eq(q[i], q_saved[i], .001f));
+
+	// state from another version is refused
+	state[0] += 1;
+	TAssert(ohmd_device_setf(dev, OHMD_FUSION_STATE, state) == OHMD_S_INVALID_PARAMETER);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+static void configure_eskf(ohmd_device_settings* settings)
+{
+	int engine = OHMD_FUSION_ESKF, bad_engine = 42;
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_FUSION_ENGINE, &bad_engine) == OHMD_S_INVALID_PARAMETER);
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_FUSION_ENGINE, &engine) == OHMD_S_OK);
+}
+
+void test_highlevel_fusion_engine()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, configure_eskf);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	ohmd_imu_sample samples[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+	TAssert(ohmd_device_push_imu_samples(dev, samples, 101) == OHMD_S_OK);
+
+	ohmd_ctx_update(ctx);
+	TAssert(turned(dev, 1, .01f));
+
+	ohmd_ctx_destroy(ctx);
+}
+
+static void configure_bank(ohmd_device_settings* settings)
+{
+	int bank = 1;
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_FUSION_BANK, &bank) == OHMD_S_OK);
+}
+
+static void configure_mahony(ohmd_device_settings* settings)
+{
+	int engine = OHMD_FUSION_MAHONY;
+	TAssert(ohmd_device_settings_seti(settings, OHMD_IDS_FUSION_ENGINE, &engine) == OHMD_S_OK);
+}
+
+// pushes a second of samples, fewer at a time than the bank keeps, and updates after every push
+static void push_and_update(ohmd_context* ctx, ohmd_device* dev, float* q)
+{
+	ohmd_imu_sample samples[101];
+	make_samples(samples, 101, 5000000000ull, 1);
+
+	for(int i = 0; i < 101; i += 20){
+		TAssert(ohmd_device_push_imu_samples(dev, samples + i, OHMD_MIN(20, 101 - i)) == OHMD_S_OK);
+		ohmd_ctx_update(ctx);
+	}
+
+	ohmd_device_getf(dev, OHMD_ROTATION_QUAT, q);
+}
+
+void test_highlevel_fusion_bank()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	ohmd_device* dev = open_external(ctx, configure_bank);
+	if(!dev){
+		// external driver not built
+		ohmd_ctx_destroy(ctx);
+		return;
+	}
+
+	float banked[4], q[4];
+	push_and_update(ctx, dev, banked);
+	TAssert(turned(dev, 1, .01f));
+	ohmd_close_device(dev);
+
+	// the bank runs the filter a device of its own runs with the Mahony engine
+	dev = open_external(ctx, configure_mahony);
+	push_and_update(ctx, dev, q);
+	for(int i = 0; i < 4; i++)
+		TAssert(float_eq(q[i], banked[i], .0005f));
+
+	ohmd_ctx_destroy(ctx);
+}
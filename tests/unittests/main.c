@@ -34,10 +34,58 @@ int main()
 	Test(test_oquatf_diff);
 	printf("\n");
 
+	printf("math backend tests\n");
+	Test(test_omath_backends);
+	Test(test_omath_soa);
+	printf("\n");
+
+	printf("streaming statistics tests\n");
+	Test(test_ostats_window);
+	printf("\n");
+
+	printf("hid reader tests\n");
+	Test(test_ohmd_hid_ring);
+	printf("\n");
+
+	printf("pose encoding tests\n");
+	Test(test_ohmd_pose_codec);
+	Test(test_ohmd_pose_log);
+	printf("\n");
+
+	printf("fusion tests\n");
+	Test(test_ofusion_update_batch);
+	Test(test_ofusion_defer);
+	Test(test_ofusion_eskf);
+	Test(test_ofusion_mahony_madgwick);
+	Test(test_ofusion_params);
+	Test(test_ofusion_preintegration);
+	Test(test_ofusion_fixed);
+	Test(test_ofusion_bias);
+	Test(test_ofusion_bank);
+	printf("\n");
+
 	printf("high level tests\n");
 	Test(test_highlevel_open_close_device);
 	Test(test_highlevel_open_close_many_devices);
+	Test(test_highlevel_stream_loopback);
+	Test(test_highlevel_stream_devices);
+	Test(test_highlevel_push_imu_samples);
+	Test(test_highlevel_imu_ring);
+	Test(test_highlevel_imu_socket);
+	Test(test_highlevel_control_events);
+	Test(test_highlevel_shared_device);
+	Test(test_highlevel_idle_parking);
+	Test(test_highlevel_lazy_fusion);
+	Test(test_highlevel_fusion_state);
+	Test(test_highlevel_fusion_engine);
+	Test(test_highlevel_fusion_bank);
+	printf("\n");
+
+#ifdef TEST_CPP_BINDING
+	printf("c++ binding tests\n");
+	Test(test_cpp_binding);
 	printf("\n");
+#endif
 
 	printf("all a-ok\n");
 	return 0;
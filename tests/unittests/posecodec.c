@@ -0,0 +1,196 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - Compressed Pose Encoding Tests */
+
+#include <string.h>
+#include "tests.h"
+#include "posecodec.h"
+
+#define NUM_POSES 3000
+
+static float rand_unit(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+// a hand waving about for three seconds at 1 kHz, the timestamps jitter by a few microseconds
+static void make_poses(ohmd_pose* poses, int count)
+{
+	unsigned int seed = 5;
+
+	for(int i = 0; i < count; i++){
+		float t = i * 0.001f;
+		vec3f axis = {{ sinf(t), cosf(0.7f * t), 0.3f }};
+		ovec3f_normalize_me(&axis);
+
+		poses[i].timestamp_ns = 1000000000000ull + i * 1000000ull + (uint64_t)((rand_unit(&seed) + 1.0f) * 20000);
+		oquatf_init_axis(&poses[i].rotation, &axis, 2.5f * sinf(1.3f * t));
+		poses[i].position.x = 0.3f * sinf(2.0f * t);
+		poses[i].position.y = 1.6f + 0.1f * cosf(3.0f * t);
+		poses[i].position.z = -0.4f + 0.2f * sinf(t);
+	}
+}
+
+// about the angle between two close rotations, q and -q are the same, acosf of the dot product is too coarse for this
+static float rotation_error(const quatf* a, const quatf* b)
+{
+	float diff = 0, sum = 0;
+	for(int i = 0; i < 4; i++){
+		diff += (a->arr[i] - b->arr[i]) * (a->arr[i] - b->arr[i]);
+		sum += (a->arr[i] + b->arr[i]) * (a->arr[i] + b->arr[i]);
+	}
+	return 2.0f * sqrtf(OHMD_MIN(diff, sum));
+}
+
+static bool pose_eq(const ohmd_pose* a, const ohmd_pose* b)
+{
+	return a->timestamp_ns == b->timestamp_ns && rotation_error(&a->rotation, &b->rotation) < 0.0002f &&
+	       vec3f_eq(a->position, b->position, OHMD_POSE_POSITION_UNIT * 0.51f);
+}
+
+void test_ohmd_pose_codec()
+{
+	static ohmd_pose poses[NUM_POSES];
+	static unsigned char buffer[NUM_POSES * OHMD_POSE_MAX_RECORD];
+	make_poses(poses, NUM_POSES);
+
+	ohmd_pose_codec encoder, decoder;
+	ohmd_pose_codec_reset(&encoder);
+	ohmd_pose_codec_reset(&decoder);
+
+	int size = 0;
+	for(int i = 0; i < NUM_POSES; i++){
+		int n = ohmd_pose_encode(&encoder, poses + i, false, buffer + size);
+		TAssert(n > 6 && n <= OHMD_POSE_MAX_RECORD);
+		size += n;
+	}
+
+	// about a third of the floats, the first record is a key record even though none was asked for
+	TAssert(size < NUM_POSES * 14);
+
+	ohmd_pose pose;
+	int offset = 0;
+	for(int i = 0; i < NUM_POSES; i++){
+		int n = ohmd_pose_decode(&decoder, buffer + offset, size - offset, &pose);
+		TAssert(n > 0);
+		TAssert(pose_eq(&pose, poses + i));
+		offset += n;
+	}
+	TAssert(offset == size);
+	TAssert(ohmd_pose_decode(&decoder, buffer + offset, 0, &pose) == 0);
+
+	// a record cut short is not decoded, a delta record can't be decoded without a key record before it
+	ohmd_pose_codec_reset(&encoder);
+	int key = ohmd_pose_encode(&encoder, poses, false, buffer);
+	int delta = ohmd_pose_encode(&encoder, poses + 1, false, buffer + key);
+
+	ohmd_pose_codec_reset(&decoder);
+	TAssert(ohmd_pose_decode(&decoder, buffer, key - 1, &pose) == 0);
+	TAssert(ohmd_pose_decode(&decoder, buffer + key, delta, &pose) == -1);
+	TAssert(ohmd_pose_decode(&decoder, buffer, key + delta, &pose) == key);
+	TAssert(ohmd_pose_decode(&decoder, buffer + key, delta, &pose) == delta && pose_eq(&pose, poses + 1));
+
+	// the rotation stays within 0.01 degrees for any quaternion and either sign, 0 is the identity
+	unsigned int seed = 3;
+	float worst = 0;
+	for(int i = 0; i < 10000; i++){
+		quatf q = {{ rand_unit(&seed), rand_unit(&seed), rand_unit(&seed), rand_unit(&seed) }}, out;
+		unsigned char packed[6];
+
+		oquatf_normalize_me(&q);
+		ohmd_pose_pack_rotation(&q, i & 1, packed);
+		TAssert(ohmd_pose_unpack_rotation(packed, &out) == (i & 1));
+		worst = OHMD_MAX(worst, rotation_error(&q, &out));
+	}
+	TAssert(worst < 0.01f * (float)M_PI / 180.0f);
+
+	quatf zero = {{ 0, 0, 0, 0 }}, identity = {{ 0, 0, 0, 1 }}, out;
+	unsigned char packed[6];
+	ohmd_pose_pack_rotation(&zero, false, packed);
+	ohmd_pose_unpack_rotation(packed, &out);
+	TAssert(rotation_error(&out, &identity) < 0.0001f);
+}
+
+void test_ohmd_pose_log()
+{
+	static ohmd_pose poses[NUM_POSES];
+	make_poses(poses, NUM_POSES);
+
+	ohmd_pose_log log;
+	ohmd_pose pose;
+	ohmd_pose_log_init(&log, 100);
+
+	TAssert(!ohmd_pose_log_find(&log, poses[0].timestamp_ns, &pose));
+
+	for(int i = 0; i < NUM_POSES; i++)
+		TAssert(ohmd_pose_log_append(&log, poses + i));
+
+	TAssert(log.num_blocks == NUM_POSES / 100 && ohmd_pose_log_count(&log) == NUM_POSES);
+
+	// any pose by its time, or the one before if the time falls between two
+	TAssert(!ohmd_pose_log_find(&log, poses[0].timestamp_ns - 1, &pose));
+	for(int i = 0; i < NUM_POSES; i += 7){
+		TAssert(ohmd_pose_log_find(&log, poses[i].timestamp_ns, &pose) && pose_eq(&pose, poses + i));
+		TAssert(ohmd_pose_log_find(&log, poses[i].timestamp_ns + 1, &pose) && pose_eq(&pose, poses + i));
+	}
+	TAssert(ohmd_pose_log_find(&log, UINT64_MAX, &pose) && pose_eq(&pose, poses + NUM_POSES - 1));
+
+	// saved and loaded, then appended to
+	FILE* file = tmpfile();
+	TAssert(file);
+	TAssert(ohmd_pose_log_save(&log, file));
+
+	ohmd_pose_log loaded;
+	ohmd_pose_log_init(&loaded, 1);
+	rewind(file);
+	TAssert(ohmd_pose_log_load(&loaded, file));
+	TAssert(loaded.size == log.size && memcmp(loaded.data, log.data, log.size) == 0);
+	TAssert(loaded.block_poses == 100 && ohmd_pose_log_count(&loaded) == NUM_POSES);
+
+	ohmd_pose later = poses[NUM_POSES - 1];
+	later.timestamp_ns += 1000000;
+	TAssert(ohmd_pose_log_append(&log, &later) && ohmd_pose_log_append(&loaded, &later));
+	TAssert(loaded.size == log.size && memcmp(loaded.data, log.data, log.size) == 0);
+
+	// a file cut short or of something else is refused and the log is left as it was
+	rewind(file);
+	fputc('X', file);
+	rewind(file);
+	TAssert(!ohmd_pose_log_load(&loaded, file));
+	TAssert(ohmd_pose_log_count(&loaded) == NUM_POSES + 1);
+
+	// as is one with a block that doesn't start with a key record, which can't be found in either
+	ohmd_pose_codec decoder;
+	ohmd_pose_codec_reset(&decoder);
+	uint32_t key = (uint32_t)ohmd_pose_decode(&decoder, log.data + log.blocks[1].offset, log.size, &pose);
+	log.blocks[1].offset += key;
+	TAssert(!ohmd_pose_log_find(&log, poses[100].timestamp_ns, &pose));
+
+	rewind(file);
+	TAssert(ohmd_pose_log_save(&log, file));
+	rewind(file);
+	TAssert(!ohmd_pose_log_load(&loaded, file));
+	TAssert(ohmd_pose_log_count(&loaded) == NUM_POSES + 1);
+	log.blocks[1].offset -= key;
+	fclose(file);
+
+	// trimming keeps a bounded history, the block the time falls in stays, the later pose started a block of its own
+	ohmd_pose_log_trim(&log, poses[1050].timestamp_ns);
+	TAssert(log.num_blocks == NUM_POSES / 100 + 1 - 10 && ohmd_pose_log_count(&log) == NUM_POSES - 1000 + 1);
+	TAssert(!ohmd_pose_log_find(&log, poses[999].timestamp_ns, &pose));
+	TAssert(ohmd_pose_log_find(&log, poses[1000].timestamp_ns, &pose) && pose_eq(&pose, poses + 1000));
+	TAssert(ohmd_pose_log_find(&log, poses[2999].timestamp_ns, &pose) && pose_eq(&pose, poses + 2999));
+
+	ohmd_pose_log_trim(&log, UINT64_MAX);
+	TAssert(log.num_blocks == 1 && ohmd_pose_log_find(&log, UINT64_MAX, &pose) && pose_eq(&pose, &later));
+
+	ohmd_pose_log_free(&loaded);
+	ohmd_pose_log_free(&log);
+	TAssert(log.data == NULL && log.num_blocks == 0);
+}
@@ -0,0 +1,238 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - Math Backend Tests */
+
+#include <float.h>
+#include <string.h>
+#include "tests.h"
+
+#define ROUNDS 1000
+
+// inputs are within [-1, 1], so a few ulp of 1 covers the different rounding of reordered and fused operations
+#define ULP_TOLERANCE (8 * FLT_EPSILON)
+
+static float rand_unit(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+static void rand_quat(unsigned int* seed, quatf* q)
+{
+	for(int i = 0; i < 4; i++)
+		q->arr[i] = rand_unit(seed);
+	oquatf_normalize_me(q);
+}
+
+static bool floats_eq(const float* a, const float* b, int count)
+{
+	for(int i = 0; i < count; i++)
+		if(!float_eq(a[i], b[i], ULP_TOLERANCE)){
+			printf("\n[%d] == %.9g, scalar %.9g\n", i, a[i], b[i]);
+			return false;
+		}
+
+	return true;
+}
+
+void test_omath_backends()
+{
+	const omath_backend* backends[8];
+	const omath_backend* scalar = &omath_scalar;
+	int count = omath_get_backends(backends, 8);
+
+	TAssert(count >= 1);
+	TAssert(backends[count - 1] == scalar);
+
+	for(int b = 0; b < count; b++){
+		const omath_backend* be = backends[b];
+		unsigned int seed = 11;
+
+		for(int round = 0; round < ROUNDS; round++){
+			quatf q1, q2, out, ref;
+			rand_quat(&seed, &q1);
+			rand_quat(&seed, &q2);
+
+			be->quat_mult(&q1, &q2, &out);
+			scalar->quat_mult(&q1, &q2, &ref);
+			TAssert(floats_eq(out.arr, ref.arr, 4));
+
+			vec3f v = {{ rand_unit(&seed), rand_unit(&seed), rand_unit(&seed) }}, rot, rot_ref;
+			be->quat_get_rotated(&q1, &v, &rot);
+			scalar->quat_get_rotated(&q1, &v, &rot_ref);
+			TAssert(floats_eq(rot.arr, rot_ref.arr, 3));
+
+			quatf n = {{ rand_unit(&seed), rand_unit(&seed), rand_unit(&seed), rand_unit(&seed) }}, n_ref = n;
+			be->quat_normalize(&n);
+			scalar->quat_normalize(&n_ref);
+			TAssert(floats_eq(n.arr, n_ref.arr, 4));
+
+			mat4x4f m1, m2, m_out, m_ref;
+			for(int i = 0; i < 16; i++){
+				m1.arr[i] = rand_unit(&seed);
+				m2.arr[i] = rand_unit(&seed);
+			}
+
+			be->mat4x4_mult(&m1, &m2, &m_out);
+			scalar->mat4x4_mult(&m1, &m2, &m_ref);
+			TAssert(floats_eq(m_out.arr, m_ref.arr, 16));
+
+			// transposing only moves values around, it has to be exact
+			be->mat4x4_transpose(&m1, &m_out);
+			scalar->mat4x4_transpose(&m1, &m_ref);
+			TAssert(memcmp(m_out.arr, m_ref.arr, sizeof(mat4x4f)) == 0);
+		}
+
+		// unaligned storage, like the float arrays applications pass to ohmd_device_getf
+		float buffer[1 + 16 + 16 + 16];
+		mat4x4f* um1 = (mat4x4f*)(buffer + 1);
+		mat4x4f* um2 = (mat4x4f*)(buffer + 17);
+		mat4x4f* uout = (mat4x4f*)(buffer + 33);
+		mat4x4f m_ref;
+		for(int i = 0; i < 32; i++)
+			buffer[1 + i] = rand_unit(&seed);
+
+		be->mat4x4_mult(um1, um2, uout);
+		scalar->mat4x4_mult(um1, um2, &m_ref);
+		TAssert(floats_eq(uout->arr, m_ref.arr, 16));
+	}
+
+	// the global backend can be switched and the wrappers follow it
+	const omath_backend* old = omath_get_backend();
+	omath_set_backend(scalar);
+	TAssert(omath_get_backend() == scalar);
+	omath_set_backend(old);
+}
+
+// an odd count, so every backend leaves a tail to the scalar code
+#define SOA_COUNT 37
+
+void test_omath_soa()
+{
+	const omath_backend* backends[8];
+	const omath_backend* scalar = &omath_scalar;
+	const omath_backend* old = omath_get_backend();
+	int count = omath_get_backends(backends, 8);
+
+	static float a[4][SOA_COUNT], b[4][SOA_COUNT], r[4][SOA_COUNT], v[3][SOA_COUNT], vr[3][SOA_COUNT];
+	static float t[SOA_COUNT];
+	static mat4x4f m[SOA_COUNT];
+
+	quatf_soa qa = { a[0], a[1], a[2], a[3] }, qb = { b[0], b[1], b[2], b[3] }, qr = { r[0], r[1], r[2], r[3] };
+	vec3f_soa va = { v[0], v[1], v[2] }, vo = { vr[0], vr[1], vr[2] };
+
+	for(int be = 0; be < count; be++){
+		unsigned int seed = 23;
+
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf q1, q2;
+			rand_quat(&seed, &q1);
+			rand_quat(&seed, &q2);
+			for(int j = 0; j < 4; j++){
+				a[j][i] = q1.arr[j];
+				b[j][i] = q2.arr[j];
+			}
+			for(int j = 0; j < 3; j++)
+				v[j][i] = rand_unit(&seed);
+			t[i] = 0.5f * (rand_unit(&seed) + 1.0f);
+		}
+
+		omath_set_backend(backends[be]);
+
+		oquatf_soa_mult(&qa, &qb, &qr, SOA_COUNT);
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf q1 = {{ a[0][i], a[1][i], a[2][i], a[3][i] }}, q2 = {{ b[0][i], b[1][i], b[2][i], b[3][i] }};
+			quatf out = {{ r[0][i], r[1][i], r[2][i], r[3][i] }}, ref;
+			scalar->quat_mult(&q1, &q2, &ref);
+			TAssert(floats_eq(out.arr, ref.arr, 4));
+		}
+
+		oquatf_soa_get_rotated(&qa, &va, &vo, SOA_COUNT);
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf q = {{ a[0][i], a[1][i], a[2][i], a[3][i] }};
+			vec3f in = {{ v[0][i], v[1][i], v[2][i] }}, out = {{ vr[0][i], vr[1][i], vr[2][i] }}, ref;
+			scalar->quat_get_rotated(&q, &in, &ref);
+			TAssert(floats_eq(out.arr, ref.arr, 3));
+		}
+
+		oquatf_soa_get_mat4x4(&qa, &va, m, SOA_COUNT);
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf q = {{ a[0][i], a[1][i], a[2][i], a[3][i] }};
+			vec3f p = {{ v[0][i], v[1][i], v[2][i] }};
+			mat4x4f ref;
+			oquatf_get_mat4x4(&q, &p, ref.m);
+			TAssert(floats_eq(m[i].arr, ref.arr, 16));
+		}
+
+		// no points, no translation
+		oquatf_soa_get_mat4x4(&qa, NULL, m, SOA_COUNT);
+		for(int i = 0; i < SOA_COUNT; i++)
+			TAssert(m[i].m[0][3] == 0 && m[i].m[1][3] == 0 && m[i].m[2][3] == 0 && m[i].m[3][3] == 1.0f);
+
+		// in place, scaled so there is something to normalize
+		for(int j = 0; j < 4; j++)
+			for(int i = 0; i < SOA_COUNT; i++){
+				r[j][i] = a[j][i];
+				a[j][i] *= 1.0f + 0.1f * (float)i;
+			}
+
+		oquatf_soa_normalize_me(&qa, SOA_COUNT);
+		TAssert(floats_eq(a[0], r[0], SOA_COUNT));
+		TAssert(floats_eq(a[3], r[3], SOA_COUNT));
+
+		oquatf_soa_mult(&qa, &qb, &qa, SOA_COUNT);
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf q1 = {{ r[0][i], r[1][i], r[2][i], r[3][i] }}, q2 = {{ b[0][i], b[1][i], b[2][i], b[3][i] }};
+			quatf out = {{ a[0][i], a[1][i], a[2][i], a[3][i] }}, ref;
+			scalar->quat_mult(&q1, &q2, &ref);
+			TAssert(floats_eq(out.arr, ref.arr, 4));
+		}
+	}
+
+	omath_set_backend(old);
+
+	// slerp stays on the unit sphere, starts at the first quaternion and ends at the rotation of the second,
+	// which about half of the random pairs only reach by the shortest path through -q
+	unsigned int seed = 29;
+	int opposite = 0;
+	for(int i = 0; i < SOA_COUNT; i++){
+		quatf q1, q2;
+		rand_quat(&seed, &q1);
+		rand_quat(&seed, &q2);
+		for(int j = 0; j < 4; j++){
+			a[j][i] = q1.arr[j];
+			b[j][i] = q2.arr[j];
+		}
+		if(oquatf_get_dot(&q1, &q2) < 0)
+			opposite++;
+	}
+	TAssert(opposite > 0);
+
+	for(int step = 0; step <= 4; step++){
+		for(int i = 0; i < SOA_COUNT; i++)
+			t[i] = 0.25f * (float)step;
+
+		oquatf_soa_slerp(t, &qa, &qb, &qr, SOA_COUNT);
+
+		for(int i = 0; i < SOA_COUNT; i++){
+			quatf out = {{ r[0][i], r[1][i], r[2][i], r[3][i] }};
+			quatf q1 = {{ a[0][i], a[1][i], a[2][i], a[3][i] }}, q2 = {{ b[0][i], b[1][i], b[2][i], b[3][i] }};
+			TAssert(float_eq(oquatf_get_length(&out), 1.0f, .0001f));
+
+			vec3f x = {{ 1.0f, 0, 0 }}, x_out, x_ref;
+			oquatf_get_rotated(&out, &x, &x_out);
+			if(step == 0){
+				oquatf_get_rotated(&q1, &x, &x_ref);
+				TAssert(vec3f_eq(x_out, x_ref, .0001f));
+			}else if(step == 4){
+				oquatf_get_rotated(&q2, &x, &x_ref);
+				TAssert(vec3f_eq(x_out, x_ref, .0001f));
+			}
+		}
+	}
+}
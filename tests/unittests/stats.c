@@ -0,0 +1,96 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - Streaming Statistics Tests */
+
+#include "tests.h"
+
+#define WINDOW 16
+
+static float rand_value(unsigned int* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (float)(*seed >> 8) / (float)(1 << 24) - 0.5f;
+}
+
+// the statistics of the last count values added to history, the slow way
+static void window_stats(const vec3f* history, int n, int count, vec3f* mean, vec3f* var, vec3f* min, vec3f* max)
+{
+	for(int a = 0; a < 3; a++){
+		double sum = 0, sum_sq = 0;
+		float lo = history[n - 1].arr[a], hi = lo;
+
+		for(int i = n - count; i < n; i++){
+			float v = history[i].arr[a];
+			sum += v;
+			lo = v < lo ? v : lo;
+			hi = v > hi ? v : hi;
+		}
+
+		double m = sum / count;
+		for(int i = n - count; i < n; i++)
+			sum_sq += (history[i].arr[a] - m) * (history[i].arr[a] - m);
+
+		mean->arr[a] = (float)m;
+		var->arr[a] = (float)(sum_sq / count);
+		min->arr[a] = lo;
+		max->arr[a] = hi;
+	}
+}
+
+void test_ostats_window()
+{
+	static vec3f history[4000];
+	vec3f elems[WINDOW];
+	stats_extrema extrema[WINDOW];
+	stats_window stats;
+	unsigned int seed = 5;
+
+	ostats_init(&stats, elems, extrema, WINDOW);
+
+	vec3f zero = {{ 0, 0, 0 }}, v;
+	ostats_get_mean(&stats, &v);
+	TAssert(vec3f_eq(v, zero, .000001f));
+
+	for(int n = 1; n <= 4000; n++){
+		// around gravity, so the variance is small compared to the values
+		vec3f* h = history + n - 1;
+		h->x = rand_value(&seed) * 0.2f;
+		h->y = 9.81f + rand_value(&seed) * 0.2f;
+		h->z = n < 2000 ? rand_value(&seed) : n * 0.001f; // noise, then a ramp
+
+		ostats_add(&stats, elems, extrema, h);
+
+		int count = n < WINDOW ? n : WINDOW;
+		TAssert(stats.count == count);
+
+		vec3f mean, var, min, max;
+		window_stats(history, n, count, &mean, &var, &min, &max);
+
+		// before the window is full only the values added so far count
+		ostats_get_mean(&stats, &v);
+		TAssert(vec3f_eq(v, mean, .0001f));
+		ostats_get_variance(&stats, &v);
+		TAssert(vec3f_eq(v, var, .0001f));
+		ostats_get_min(&stats, elems, extrema, &v);
+		TAssert(vec3f_eq(v, min, .000001f));
+		ostats_get_max(&stats, elems, extrema, &v);
+		TAssert(vec3f_eq(v, max, .000001f));
+	}
+
+	// a constant signal has no variance left over from earlier values
+	vec3f still = {{ 0.5f, 9.81f, -0.25f }};
+	for(int i = 0; i < WINDOW; i++)
+		ostats_add(&stats, elems, extrema, &still);
+
+	ostats_get_variance(&stats, &v);
+	TAssert(vec3f_eq(v, zero, .00001f));
+	ostats_get_min(&stats, elems, extrema, &v);
+	TAssert(vec3f_eq(v, still, .000001f));
+	ostats_get_max(&stats, elems, extrema, &v);
+	TAssert(vec3f_eq(v, still, .000001f));
+}
@@ -40,8 +40,48 @@ void test_oquatf_diff();
 
 void test_oquatf_get_mat4x4();
 
+// math backend tests
+void test_omath_backends();
+void test_omath_soa();
+
+// streaming statistics tests
+void test_ostats_window();
+
+// hid reader tests
+void test_ohmd_hid_ring();
+
+// pose encoding tests
+void test_ohmd_pose_codec();
+void test_ohmd_pose_log();
+
+// fusion tests
+void test_ofusion_update_batch();
+void test_ofusion_defer();
+void test_ofusion_eskf();
+void test_ofusion_mahony_madgwick();
+void test_ofusion_params();
+void test_ofusion_preintegration();
+void test_ofusion_fixed();
+void test_ofusion_bias();
+void test_ofusion_bank();
+
 // high-level tests
 void test_highlevel_open_close_device();
 void test_highlevel_open_close_many_devices();
+void test_highlevel_stream_loopback();
+void test_highlevel_stream_devices();
+void test_highlevel_push_imu_samples();
+void test_highlevel_imu_ring();
+void test_highlevel_imu_socket();
+void test_highlevel_control_events();
+void test_highlevel_shared_device();
+void test_highlevel_idle_parking();
+void test_highlevel_lazy_fusion();
+void test_highlevel_fusion_state();
+void test_highlevel_fusion_engine();
+void test_highlevel_fusion_bank();
+
+// C++ binding tests
+void test_cpp_binding();
 
 #endif
@@ -0,0 +1,73 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Pose Server - Client Library */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "poseshm.h"
+
+struct ohmd_poseshm_client
+{
+	const ohmd_poseshm* shm;
+};
+
+ohmd_poseshm_client* ohmd_poseshm_client_open(const char* name)
+{
+	if(!name)
+		name = OHMD_POSESHM_DEFAULT_NAME;
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0)
+		return NULL;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ohmd_poseshm)){
+		close(fd);
+		return NULL;
+	}
+
+	void* map = mmap(NULL, sizeof(ohmd_poseshm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED)
+		return NULL;
+
+	const ohmd_poseshm* shm = (const ohmd_poseshm*)map;
+	if(shm->magic != OHMD_POSESHM_MAGIC || shm->version != OHMD_POSESHM_VERSION || shm->size != sizeof(ohmd_poseshm)){
+		fprintf(stderr, "%s is not a compatible pose server region\n", name);
+		munmap(map, sizeof(ohmd_poseshm));
+		return NULL;
+	}
+
+	ohmd_poseshm_client* client = calloc(1, sizeof(ohmd_poseshm_client));
+	if(!client){
+		munmap(map, sizeof(ohmd_poseshm));
+		return NULL;
+	}
+
+	client->shm = shm;
+	return client;
+}
+
+void ohmd_poseshm_client_close(ohmd_poseshm_client* client)
+{
+	munmap((void*)client->shm, sizeof(ohmd_poseshm));
+	free(client);
+}
+
+const ohmd_poseshm* ohmd_poseshm_client_get(ohmd_poseshm_client* client)
+{
+	return client->shm;
+}
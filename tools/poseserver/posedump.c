@@ -0,0 +1,60 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Pose Server - prints the poses published by a running server */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "poseshm.h"
+
+int main(int argc, char** argv)
+{
+	const char* name = argc > 1 && argv[1][0] ? argv[1] : NULL;
+	int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+	ohmd_poseshm_client* client = ohmd_poseshm_client_open(name);
+	if(!client){
+		printf("no pose server running\n");
+		return 1;
+	}
+
+	const ohmd_poseshm* shm = ohmd_poseshm_client_get(client);
+
+	for(int i = 0; i < (int)shm->num_devices; i++)
+		printf("slot %d: %s %s, class %d, %d controls\n", i, shm->devices[i].vendor, shm->devices[i].product,
+			shm->devices[i].device_class, shm->devices[i].control_count);
+
+	for(int r = 0; r < rounds; r++){
+		for(int i = 0; i < (int)shm->num_devices; i++){
+			ohmd_poseshm_pose pose;
+			float controls[OHMD_POSESHM_MAX_CONTROLS];
+
+			if(!ohmd_poseshm_read_controls(shm, i, &pose, controls))
+				continue;
+
+			printf("slot %d @ %llu (#%llu): rot % f % f % f % f pos % f % f % f",
+				i, (unsigned long long)pose.timestamp_ns, (unsigned long long)pose.update_count,
+				pose.rotation[0], pose.rotation[1], pose.rotation[2], pose.rotation[3],
+				pose.position[0], pose.position[1], pose.position[2]);
+
+			for(int c = 0; c < shm->devices[i].control_count; c++)
+				printf(" %f", controls[c]);
+			printf("\n");
+		}
+
+		struct timespec sleepfor = { 0, 100000000 };
+		nanosleep(&sleepfor, NULL);
+	}
+
+	ohmd_poseshm_client_close(client);
+
+	return 0;
+}
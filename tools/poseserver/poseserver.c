@@ -0,0 +1,253 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Pose Server - owns the devices and publishes their state to shared memory */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <openhmd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "poseshm.h"
+
+static volatile sig_atomic_t quit = 0;
+
+static void handle_signal(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void usage(const char* prog)
+{
+	printf("usage: %s [-n name] [-r rate] [-d index]...\n", prog);
+	printf("  -n name   shared memory region name (default: %s)\n", OHMD_POSESHM_DEFAULT_NAME);
+	printf("  -r rate   publish rate in Hz (default: 1000)\n");
+	printf("  -d index  open the device with this probe index, can be repeated (default: all)\n");
+}
+
+// true if the region is published by a server that is still running
+static bool region_in_use(const char* name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	bool in_use = false;
+	if(fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ohmd_poseshm)){
+		void* map = mmap(NULL, sizeof(ohmd_poseshm), PROT_READ, MAP_SHARED, fd, 0);
+		if(map != MAP_FAILED){
+			const ohmd_poseshm* shm = (const ohmd_poseshm*)map;
+			in_use = __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) == OHMD_POSESHM_MAGIC &&
+			         shm->server_pid > 0 && kill((pid_t)shm->server_pid, 0) == 0;
+			munmap(map, sizeof(ohmd_poseshm));
+		}
+	}
+
+	close(fd);
+	return in_use;
+}
+
+static ohmd_poseshm* create_region(const char* name)
+{
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0 && errno == EEXIST){
+		// never wipe the region of a running server, only one left behind by a server that crashed
+		if(region_in_use(name)){
+			printf("%s is served by another pose server\n", name);
+			return NULL;
+		}
+
+		shm_unlink(name);
+		fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+
+	if(fd < 0){
+		perror("shm_open");
+		return NULL;
+	}
+
+	if(ftruncate(fd, sizeof(ohmd_poseshm)) != 0){
+		perror("ftruncate");
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	void* map = mmap(NULL, sizeof(ohmd_poseshm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED){
+		perror("mmap");
+		shm_unlink(name);
+		return NULL;
+	}
+
+	ohmd_poseshm* shm = (ohmd_poseshm*)map;
+	memset(shm, 0, sizeof(ohmd_poseshm));
+
+	shm->version = OHMD_POSESHM_VERSION;
+	shm->size = sizeof(ohmd_poseshm);
+	shm->server_pid = getpid();
+
+	// publish the magic last so clients never see a half initialized header
+	__atomic_store_n(&shm->magic, OHMD_POSESHM_MAGIC, __ATOMIC_RELEASE);
+
+	return shm;
+}
+
+static void describe_device(ohmd_context* ctx, int index, ohmd_device* dev, ohmd_poseshm_device* slot)
+{
+	int count = 0;
+
+	ohmd_list_geti(ctx, index, OHMD_DEVICE_CLASS, &slot->device_class);
+	ohmd_list_geti(ctx, index, OHMD_DEVICE_FLAGS, &slot->device_flags);
+	snprintf(slot->vendor, sizeof(slot->vendor), "%s", ohmd_list_gets(ctx, index, OHMD_VENDOR));
+	snprintf(slot->product, sizeof(slot->product), "%s", ohmd_list_gets(ctx, index, OHMD_PRODUCT));
+
+	ohmd_device_geti(dev, OHMD_CONTROL_COUNT, &count);
+	if(count > OHMD_POSESHM_MAX_CONTROLS)
+		count = OHMD_POSESHM_MAX_CONTROLS;
+
+	slot->control_count = count;
+	if(count > 0){
+		ohmd_device_geti(dev, OHMD_CONTROLS_HINTS, slot->controls_hints);
+		ohmd_device_geti(dev, OHMD_CONTROLS_TYPES, slot->controls_types);
+	}
+}
+
+static void publish_device(ohmd_device* dev, ohmd_poseshm_device* slot, uint64_t timestamp)
+{
+	float rotation[4], position[3], controls[OHMD_POSESHM_MAX_CONTROLS];
+
+	// query outside of the write section to keep it as short as possible
+	ohmd_device_getf(dev, OHMD_ROTATION_QUAT, rotation);
+	ohmd_device_getf(dev, OHMD_POSITION_VECTOR, position);
+	if(slot->control_count > 0)
+		ohmd_device_getf(dev, OHMD_CONTROLS_STATE, controls);
+
+	ohmd_poseshm_write_begin(&slot->pose);
+
+	slot->pose.active = 1;
+	slot->pose.timestamp_ns = timestamp;
+	slot->pose.update_count++;
+	memcpy(slot->pose.rotation, rotation, sizeof(rotation));
+	memcpy(slot->pose.position, position, sizeof(position));
+	memcpy(slot->controls, controls, sizeof(float) * slot->control_count);
+
+	ohmd_poseshm_write_end(&slot->pose);
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = OHMD_POSESHM_DEFAULT_NAME;
+	double rate = 1000.0;
+	int indices[OHMD_POSESHM_MAX_DEVICES];
+	int num_indices = 0;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc){
+			name = argv[++i];
+		}else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc){
+			rate = atof(argv[++i]);
+		}else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc && num_indices < OHMD_POSESHM_MAX_DEVICES){
+			indices[num_indices++] = atoi(argv[++i]);
+		}else{
+			usage(argv[0]);
+			return argc > 1 && strcmp(argv[1], "-h") == 0 ? 0 : 1;
+		}
+	}
+
+	if(rate <= 0.0)
+		rate = 1000.0;
+
+	ohmd_context* ctx = ohmd_ctx_create();
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	if(num_devices < 0){
+		printf("failed to probe devices: %s\n", ohmd_ctx_get_error(ctx));
+		ohmd_ctx_destroy(ctx);
+		return 1;
+	}
+
+	if(num_indices == 0){
+		for(int i = 0; i < num_devices && num_indices < OHMD_POSESHM_MAX_DEVICES; i++)
+			indices[num_indices++] = i;
+	}
+
+	ohmd_poseshm* shm = create_region(name);
+	if(!shm){
+		ohmd_ctx_destroy(ctx);
+		return 1;
+	}
+
+	ohmd_device* devices[OHMD_POSESHM_MAX_DEVICES];
+	int count = 0;
+
+	for(int i = 0; i < num_indices; i++){
+		ohmd_device* dev = ohmd_list_open_device(ctx, indices[i]);
+		if(!dev){
+			printf("failed to open device %d: %s\n", indices[i], ohmd_ctx_get_error(ctx));
+			continue;
+		}
+
+		describe_device(ctx, indices[i], dev, &shm->devices[count]);
+		printf("publishing device %d (%s) in slot %d\n", indices[i], shm->devices[count].product, count);
+		devices[count++] = dev;
+	}
+
+	__atomic_store_n(&shm->num_devices, count, __ATOMIC_RELEASE);
+
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+
+	printf("serving %d devices on %s at %.0f Hz\n", count, name, rate);
+
+	while(!quit){
+		ohmd_ctx_update(ctx);
+
+		uint64_t timestamp = now_ns();
+		for(int i = 0; i < count; i++)
+			publish_device(devices[i], &shm->devices[i], timestamp);
+
+		__atomic_store_n(&shm->heartbeat_ns, timestamp, __ATOMIC_RELEASE);
+
+		ohmd_sleep(1.0 / rate);
+	}
+
+	// mark every slot inactive so clients still mapping the region notice
+	for(int i = 0; i < count; i++){
+		ohmd_poseshm_write_begin(&shm->devices[i].pose);
+		shm->devices[i].pose.active = 0;
+		ohmd_poseshm_write_end(&shm->devices[i].pose);
+	}
+
+	shm_unlink(name);
+	munmap(shm, sizeof(ohmd_poseshm));
+
+	ohmd_ctx_destroy(ctx);
+
+	return 0;
+}
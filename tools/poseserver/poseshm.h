@@ -0,0 +1,197 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/**
+ * \file poseshm.h
+ * Shared memory layout and client API for the OpenHMD pose server.
+ *
+ * The pose server owns the ohmd_context and publishes the state of every open device into a POSIX
+ * shared memory region. Every device slot is protected by a sequence lock, readers never block
+ * the server and a pose read touches a single cache line without any system calls.
+ **/
+
+#ifndef OHMD_POSESHM_H
+#define OHMD_POSESHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Name of the shared memory region used when none is given. */
+#define OHMD_POSESHM_DEFAULT_NAME "/openhmd-poses"
+
+#define OHMD_POSESHM_MAGIC 0x4f484d44 /* "OHMD" */
+#define OHMD_POSESHM_VERSION 1
+
+#define OHMD_POSESHM_MAX_DEVICES 16
+#define OHMD_POSESHM_MAX_CONTROLS 64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OHMD_POSESHM_ALIGNED __attribute__((aligned(64)))
+#else
+#define OHMD_POSESHM_ALIGNED
+#endif
+
+/** Everything a pose read needs, kept within one cache line. */
+typedef struct {
+	/** Sequence lock, odd while the server is writing the slot. */
+	uint32_t seq;
+	/** Non-zero if the slot holds an open device. */
+	uint32_t active;
+	/** Host CLOCK_MONOTONIC time in nanoseconds when the pose was published. */
+	uint64_t timestamp_ns;
+	/** Number of times this slot has been published. */
+	uint64_t update_count;
+	/** Rotation quaternion (x, y, z, w), same as OHMD_ROTATION_QUAT. */
+	float rotation[4];
+	/** Position, same as OHMD_POSITION_VECTOR. */
+	float position[3];
+} OHMD_POSESHM_ALIGNED ohmd_poseshm_pose;
+
+/** A published device, static information is only written when the device is opened. */
+typedef struct {
+	ohmd_poseshm_pose pose;
+
+	/** Same as OHMD_CONTROLS_STATE, protected by pose.seq. */
+	float controls[OHMD_POSESHM_MAX_CONTROLS];
+
+	int32_t device_class;
+	int32_t device_flags;
+	int32_t control_count;
+	int32_t controls_hints[OHMD_POSESHM_MAX_CONTROLS];
+	int32_t controls_types[OHMD_POSESHM_MAX_CONTROLS];
+	char vendor[64];
+	char product[64];
+} OHMD_POSESHM_ALIGNED ohmd_poseshm_device;
+
+/** The whole shared memory region. */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	/** Size of this struct, lets clients check the layout matches. */
+	uint32_t size;
+	/** Number of device slots in use. */
+	uint32_t num_devices;
+	/** Process id of the server. */
+	int64_t server_pid;
+	/** Host CLOCK_MONOTONIC time in nanoseconds of the last publish round. */
+	uint64_t heartbeat_ns;
+
+	ohmd_poseshm_device devices[OHMD_POSESHM_MAX_DEVICES];
+} OHMD_POSESHM_ALIGNED ohmd_poseshm;
+
+/* sequence lock primitives, shared between the server and the clients */
+
+static inline uint32_t ohmd_poseshm_read_begin(const ohmd_poseshm_pose* slot)
+{
+	return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+}
+
+static inline bool ohmd_poseshm_read_retry(const ohmd_poseshm_pose* slot, uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (seq & 1) || __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq;
+}
+
+static inline void ohmd_poseshm_write_begin(ohmd_poseshm_pose* slot)
+{
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void ohmd_poseshm_write_end(ohmd_poseshm_pose* slot)
+{
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* client API */
+
+/** An opaque pointer to a read-only mapping of the pose server region. */
+typedef struct ohmd_poseshm_client ohmd_poseshm_client;
+
+/**
+ * Map the region of a running pose server.
+ *
+ * @param name Name of the shared memory region, or NULL for OHMD_POSESHM_DEFAULT_NAME.
+ * @return a client on success, NULL if no compatible server region exists.
+ **/
+ohmd_poseshm_client* ohmd_poseshm_client_open(const char* name);
+
+/**
+ * Unmap the region.
+ *
+ * @param client The client to close.
+ **/
+void ohmd_poseshm_client_close(ohmd_poseshm_client* client);
+
+/**
+ * Get the mapped region, for reading the static device information.
+ *
+ * @param client An open client.
+ * @return the read-only region.
+ **/
+const ohmd_poseshm* ohmd_poseshm_client_get(ohmd_poseshm_client* client);
+
+/**
+ * Read a consistent copy of a device pose.
+ *
+ * Spins while the server is in the middle of updating the slot, which is bounded by a few
+ * dozen stores.
+ *
+ * @param shm The region returned by ohmd_poseshm_client_get().
+ * @param index Device slot, between 0 and num_devices - 1.
+ * @param[out] out The pose.
+ * @return true if the slot holds an open device.
+ **/
+static inline bool ohmd_poseshm_read_pose(const ohmd_poseshm* shm, int index, ohmd_poseshm_pose* out)
+{
+	const ohmd_poseshm_pose* slot = &shm->devices[index].pose;
+	uint32_t seq;
+
+	do {
+		seq = ohmd_poseshm_read_begin(slot);
+		*out = *slot;
+	} while(ohmd_poseshm_read_retry(slot, seq));
+
+	out->seq = seq;
+	return out->active != 0;
+}
+
+/**
+ * Read a consistent copy of a device pose and the state of its controls.
+ *
+ * @param shm The region returned by ohmd_poseshm_client_get().
+ * @param index Device slot, between 0 and num_devices - 1.
+ * @param[out] out The pose.
+ * @param[out] controls At least control_count floats.
+ * @return true if the slot holds an open device.
+ **/
+static inline bool ohmd_poseshm_read_controls(const ohmd_poseshm* shm, int index, ohmd_poseshm_pose* out, float* controls)
+{
+	const ohmd_poseshm_device* dev = &shm->devices[index];
+	int count = dev->control_count;
+	uint32_t seq;
+
+	do {
+		seq = ohmd_poseshm_read_begin(&dev->pose);
+		*out = dev->pose;
+		for(int i = 0; i < count; i++)
+			controls[i] = dev->controls[i];
+	} while(ohmd_poseshm_read_retry(&dev->pose, seq));
+
+	out->seq = seq;
+	return out->active != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
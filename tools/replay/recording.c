@@ -0,0 +1,181 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Fusion Replay - Recorded IMU Sessions */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "recording.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void recording_usage(void)
+{
+	printf("\n");
+	printf("Files ending in .csv hold one sample per line, comments start with #:\n");
+	printf("  timestamp_ns,gx,gy,gz,ax,ay,az,mx,my,mz[,qx,qy,qz,qw]\n");
+	printf("with the reference orientation in the optional last four columns. Any other file is an array\n");
+	printf("of ohmd_imu_sample in host byte order, as sent to OHMD_EXTERNAL_STREAM_SOURCE unix sockets.\n");
+}
+
+static bool append(recording* rec, int* capacity, const ohmd_imu_sample* s, const float* ref)
+{
+	if(rec->count == *capacity){
+		int cap = *capacity ? *capacity * 2 : 4096;
+
+		ohmd_imu_sample* samples = realloc(rec->samples, cap * sizeof(ohmd_imu_sample));
+		if(!samples)
+			return false;
+		rec->samples = samples;
+
+		float (*reference)[4] = realloc(rec->reference, cap * sizeof(float[4]));
+		if(!reference)
+			return false;
+		rec->reference = reference;
+
+		*capacity = cap;
+	}
+
+	rec->samples[rec->count] = *s;
+	memcpy(rec->reference[rec->count], ref, sizeof(float[4]));
+	rec->count++;
+
+	return true;
+}
+
+static bool read_csv(FILE* f, recording* rec)
+{
+	char line[1024];
+	int capacity = 0, line_no = 0;
+	bool have_reference = false;
+
+	while(fgets(line, sizeof(line), f)){
+		line_no++;
+
+		char* p = line;
+		while(*p == ' ' || *p == '\t')
+			p++;
+		if(*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+
+		ohmd_imu_sample s;
+		float values[13], ref[4] = { NAN, NAN, NAN, NAN };
+		int count = 0;
+		char* end;
+
+		s.timestamp_ns = strtoull(p, &end, 10);
+		if(end == p){
+			// a header line
+			if(rec->count == 0)
+				continue;
+			fprintf(stderr, "line %d: expected a timestamp\n", line_no);
+			return false;
+		}
+
+		for(p = end; count < 13 && *p == ','; p = end){
+			values[count] = strtof(p + 1, &end);
+			if(end == p + 1)
+				break;
+			count++;
+		}
+
+		if(count != 9 && count != 13){
+			fprintf(stderr, "line %d: expected 10 or 14 columns\n", line_no);
+			return false;
+		}
+
+		memcpy(s.gyro, values, sizeof(s.gyro));
+		memcpy(s.accel, values + 3, sizeof(s.accel));
+		memcpy(s.mag, values + 6, sizeof(s.mag));
+
+		if(count == 13){
+			memcpy(ref, values + 9, sizeof(ref));
+			have_reference = true;
+		}
+
+		if(!append(rec, &capacity, &s, ref)){
+			fprintf(stderr, "out of memory\n");
+			return false;
+		}
+	}
+
+	if(!have_reference){
+		free(rec->reference);
+		rec->reference = NULL;
+	}
+
+	return true;
+}
+
+static bool read_binary(FILE* f, recording* rec)
+{
+	const float no_ref[4] = { NAN, NAN, NAN, NAN };
+	int capacity = 0;
+	ohmd_imu_sample s;
+
+	while(fread(&s, sizeof(s), 1, f) == 1){
+		if(!append(rec, &capacity, &s, no_ref)){
+			fprintf(stderr, "out of memory\n");
+			return false;
+		}
+	}
+
+	free(rec->reference);
+	rec->reference = NULL;
+
+	return true;
+}
+
+double recording_angle_between(const float* a, const float* b)
+{
+	double dot = fabs((double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2] + (double)a[3] * b[3]);
+	if(dot > 1.0)
+		dot = 1.0;
+
+	return 2.0 * acos(dot) * 180.0 / M_PI;
+}
+
+bool recording_load(const char* path, recording* rec)
+{
+	FILE* f = fopen(path, "rb");
+	if(!f){
+		perror(path);
+		return false;
+	}
+
+	rec->samples = NULL;
+	rec->reference = NULL;
+	rec->count = 0;
+
+	size_t len = strlen(path);
+	bool ok = len > 4 && strcmp(path + len - 4, ".csv") == 0 ? read_csv(f, rec) : read_binary(f, rec);
+	fclose(f);
+
+	if(ok && rec->count == 0){
+		fprintf(stderr, "%s holds no samples\n", path);
+		ok = false;
+	}
+
+	if(!ok)
+		recording_free(rec);
+
+	return ok;
+}
+
+void recording_free(recording* rec)
+{
+	free(rec->samples);
+	free(rec->reference);
+	rec->samples = NULL;
+	rec->reference = NULL;
+	rec->count = 0;
+}
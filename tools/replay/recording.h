@@ -0,0 +1,31 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Fusion Replay - Recorded IMU Sessions */
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <openhmd.h>
+#include <stdbool.h>
+
+typedef struct {
+	ohmd_imu_sample* samples;
+	float (*reference)[4]; // NULL, or one quaternion per sample, NaN where the recording has none
+	int count;
+} recording;
+
+// prints the file formats for the usage text of a tool
+void recording_usage(void);
+// reads the whole file, prints what is wrong with it to stderr and returns false if it can't be used
+bool recording_load(const char* path, recording* rec);
+void recording_free(recording* rec);
+
+// the rotation angle between two orientations, in degrees
+double recording_angle_between(const float* a, const float* b);
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Fusion Replay - runs recorded IMU samples through sensor fusion as fast as possible */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "recording.h"
+#include "posecodec.h"
+
+#define MAX_ENGINES 8
+
+static const char* engine_names[] = { "complementary", "eskf", "mahony", "madgwick", "fixed" };
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void usage(const char* prog)
+{
+	printf("usage: %s [-e engine[,engine...]] [-b batch] [-i samples] [-q x,y,z,w] [-t degrees] [-w poses] file\n", prog);
+	printf("  -e engine   complementary, eskf, mahony, madgwick or fixed (default: the driver's choice). Given\n");
+	printf("              several, each one replays the recording and is compared to the first\n");
+	printf("  -b batch    samples per ohmd_device_push_imu_samples() call (default: 1)\n");
+	printf("  -i samples  samples pre-integrated into one fusion step (default: 0, every sample)\n");
+	printf("  -q x,y,z,w  reference for the final orientation, overrides the one in the recording\n");
+	printf("  -t degrees  exit with 2 if the final orientation is further than this from the reference\n");
+	printf("  -w poses    write the orientation after every push of the first engine as a pose log\n");
+	recording_usage();
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+static ohmd_device* open_external(ohmd_context* ctx, int engine, int preintegrate)
+{
+	int num_devices = ohmd_ctx_probe(ctx);
+	if(num_devices < 0){
+		fprintf(stderr, "failed to probe devices: %s\n", ohmd_ctx_get_error(ctx));
+		return NULL;
+	}
+
+	for(int i = 0; i < num_devices; i++){
+		if(strcmp(ohmd_list_gets(ctx, i, OHMD_PRODUCT), "External Device") != 0)
+			continue;
+
+		// no update thread, every sample is fused inside the timed push
+		ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+		int auto_update = 0;
+		ohmd_device_settings_seti(settings, OHMD_IDS_AUTOMATIC_UPDATE, &auto_update);
+		ohmd_device_settings_seti(settings, OHMD_IDS_FUSION_ENGINE, &engine);
+		ohmd_device_settings_seti(settings, OHMD_IDS_PREINTEGRATE_SAMPLES, &preintegrate);
+
+		ohmd_device* dev = ohmd_list_open_device_s(ctx, i, settings);
+		ohmd_device_settings_destroy(settings);
+
+		if(!dev)
+			fprintf(stderr, "failed to open the external device: %s\n", ohmd_ctx_get_error(ctx));
+
+		return dev;
+	}
+
+	fprintf(stderr, "the external driver is not built in\n");
+	return NULL;
+}
+
+static int parse_engines(char* list, int* engines)
+{
+	int count = 0;
+
+	for(char* name = strtok(list, ","); name; name = strtok(NULL, ",")){
+		int engine = -2;
+		for(int e = 0; e < (int)(sizeof(engine_names) / sizeof(engine_names[0])); e++)
+			if(strcmp(name, engine_names[e]) == 0)
+				engine = e;
+
+		if(engine == -2){
+			fprintf(stderr, "unknown engine %s\n", name);
+			return -1;
+		}
+		if(count == MAX_ENGINES){
+			fprintf(stderr, "at most %d engines\n", MAX_ENGINES);
+			return -1;
+		}
+
+		engines[count++] = engine;
+	}
+
+	return count;
+}
+
+// replays the whole recording through a freshly opened device, orient gets the rotation after every push
+static bool replay(ohmd_context* ctx, const recording* rec, int engine, int batch, int preintegrate,
+                   uint64_t* latency, float (*orient)[4], float* final)
+{
+	ohmd_device* dev = open_external(ctx, engine, preintegrate);
+	if(!dev)
+		return false;
+
+	double error_sum = 0, error_max = 0;
+	int error_count = 0;
+	uint64_t total = 0;
+	int pushes = (rec->count + batch - 1) / batch;
+
+	for(int i = 0, p = 0; i < rec->count; i += batch, p++){
+		int n = rec->count - i < batch ? rec->count - i : batch;
+
+		uint64_t start = now_ns();
+		ohmd_device_push_imu_samples(dev, rec->samples + i, n);
+		latency[p] = now_ns() - start;
+		total += latency[p];
+
+		// the rotation applications see is the one published by the context update
+		ohmd_ctx_update(ctx);
+		ohmd_device_getf(dev, OHMD_ROTATION_QUAT, orient[p]);
+
+		// against the reference of the last sample of the push
+		const float* ref = rec->reference ? rec->reference[i + n - 1] : NULL;
+		if(ref && !isnan(ref[0])){
+			double error = recording_angle_between(orient[p], ref);
+			error_sum += error;
+			error_count++;
+			if(error > error_max)
+				error_max = error;
+		}
+	}
+
+	memcpy(final, orient[pushes - 1], sizeof(float) * 4);
+	ohmd_close_device(dev);
+
+	qsort(latency, pushes, sizeof(uint64_t), compare_u64);
+
+	double seconds = (double)(rec->samples[rec->count - 1].timestamp_ns - rec->samples[0].timestamp_ns) / 1e9;
+	printf("%d samples, %.1f s of data, engine %s, %d per push, %d per fusion step\n", rec->count, seconds,
+	       engine == OHMD_FUSION_DEFAULT ? "default" : engine_names[engine], batch, preintegrate > 1 ? preintegrate : 1);
+	printf("throughput        %.0f samples/s\n", rec->count / ((double)total / 1e9));
+	printf("latency per push  p50 %.0f ns, p90 %.0f ns, p99 %.0f ns, max %.0f ns\n",
+	       (double)latency[pushes / 2], (double)latency[pushes * 9 / 10],
+	       (double)latency[pushes * 99 / 100], (double)latency[pushes - 1]);
+	printf("final orientation %f %f %f %f\n", final[0], final[1], final[2], final[3]);
+
+	if(error_count > 0)
+		printf("error             mean %.3f deg, max %.3f deg over %d references\n",
+		       error_sum / error_count, error_max, error_count);
+
+	return true;
+}
+
+// the orientation track as a compressed pose log, stamped with the last sample of each push
+static bool write_poses(const char* path, const recording* rec, int batch, const float (*orient)[4])
+{
+	FILE* file = fopen(path, "wb");
+	if(!file){
+		fprintf(stderr, "could not open %s for writing\n", path);
+		return false;
+	}
+
+	ohmd_pose_log log;
+	ohmd_pose_log_init(&log, 100);
+
+	bool ok = true;
+	int pushes = (rec->count + batch - 1) / batch;
+	for(int p = 0; p < pushes && ok; p++){
+		int last = (p + 1) * batch < rec->count ? (p + 1) * batch - 1 : rec->count - 1;
+		ohmd_pose pose = { rec->samples[last].timestamp_ns, {{ orient[p][0], orient[p][1], orient[p][2], orient[p][3] }}, {{ 0, 0, 0 }} };
+		ok = ohmd_pose_log_append(&log, &pose);
+	}
+
+	ok = ok && ohmd_pose_log_save(&log, file);
+	ok = fclose(file) == 0 && ok;
+
+	if(ok)
+		printf("wrote %d poses to %s, %.2f bytes per pose\n", pushes, path, (double)log.size / pushes);
+	else
+		fprintf(stderr, "could not write %s\n", path);
+
+	ohmd_pose_log_free(&log);
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = NULL;
+	const char* poses_path = NULL;
+	int engines[MAX_ENGINES] = { OHMD_FUSION_DEFAULT };
+	int num_engines = 1;
+	int batch = 1;
+	int preintegrate = 0;
+	float final_ref[4];
+	bool have_final_ref = false;
+	double tolerance = -1.0;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-e") == 0 && i + 1 < argc){
+			num_engines = parse_engines(argv[++i], engines);
+			if(num_engines < 1){
+				usage(argv[0]);
+				return 1;
+			}
+		}else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc){
+			batch = atoi(argv[++i]);
+		}else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc){
+			preintegrate = atoi(argv[++i]);
+		}else if(strcmp(argv[i], "-q") == 0 && i + 1 < argc){
+			if(sscanf(argv[++i], "%f,%f,%f,%f", &final_ref[0], &final_ref[1], &final_ref[2], &final_ref[3]) != 4){
+				usage(argv[0]);
+				return 1;
+			}
+			have_final_ref = true;
+		}else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+			tolerance = atof(argv[++i]);
+		}else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc){
+			poses_path = argv[++i];
+		}else if(argv[i][0] != '-' && !path){
+			path = argv[i];
+		}else{
+			usage(argv[0]);
+			return argc > 1 && strcmp(argv[1], "-h") == 0 ? 0 : 1;
+		}
+	}
+
+	if(!path || batch < 1 || preintegrate < 0 || preintegrate > 64){
+		usage(argv[0]);
+		return 1;
+	}
+
+	// the whole recording is parsed up front, only fusion is timed
+	recording rec;
+	if(!recording_load(path, &rec))
+		return 1;
+
+	// the final reference is the last one in the recording unless given on the command line
+	if(!have_final_ref && rec.reference && !isnan(rec.reference[rec.count - 1][0])){
+		memcpy(final_ref, rec.reference[rec.count - 1], sizeof(final_ref));
+		have_final_ref = true;
+	}
+
+	int pushes = (rec.count + batch - 1) / batch;
+	uint64_t* latency = malloc(pushes * sizeof(uint64_t));
+	float (*orient)[4] = malloc(pushes * sizeof(float[4]));
+	float (*first)[4] = num_engines > 1 ? malloc(pushes * sizeof(float[4])) : NULL;
+	if(!latency || !orient || (num_engines > 1 && !first)){
+		fprintf(stderr, "out of memory\n");
+		free(latency);
+		free(orient);
+		free(first);
+		recording_free(&rec);
+		return 1;
+	}
+
+	ohmd_context* ctx = ohmd_ctx_create();
+	int ret = 0;
+
+	for(int e = 0; e < num_engines && ret != 1; e++){
+		float q[4];
+
+		if(e > 0)
+			printf("\n");
+
+		if(!replay(ctx, &rec, engines[e], batch, preintegrate, latency, orient, q)){
+			ret = 1;
+			break;
+		}
+
+		if(e == 0 && poses_path && !write_poses(poses_path, &rec, batch, (const float (*)[4])orient)){
+			ret = 1;
+			break;
+		}
+
+		// every later engine against the first, push by push, e.g. fixed-point against the float path
+		if(e == 0 && first){
+			memcpy(first, orient, pushes * sizeof(float[4]));
+		}else if(first){
+			double diff_sum = 0, diff_max = 0;
+			for(int p = 0; p < pushes; p++){
+				double diff = recording_angle_between(orient[p], first[p]);
+				diff_sum += diff;
+				if(diff > diff_max)
+					diff_max = diff;
+			}
+
+			printf("against %-9s mean %.4f deg, max %.4f deg over %d pushes\n",
+			       engine_names[engines[0]], diff_sum / pushes, diff_max, pushes);
+		}
+
+		if(have_final_ref){
+			double error = recording_angle_between(q, final_ref);
+			printf("final error       %.3f deg\n", error);
+
+			if(tolerance >= 0 && error > tolerance){
+				printf("FAILED, more than %.3f deg off\n", tolerance);
+				ret = 2;
+			}
+		}else if(tolerance >= 0){
+			fprintf(stderr, "-t needs a reference, from -q or the recording\n");
+			ret = 1;
+		}
+	}
+
+	free(first);
+	free(orient);
+	free(latency);
+	recording_free(&rec);
+	ohmd_ctx_destroy(ctx);
+
+	return ret;
+}
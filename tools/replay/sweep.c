@@ -0,0 +1,546 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Fusion Sweep - tunes the complementary filter on recorded sessions */
+
+/*
+ * Every combination of the given fusion_params values is run over every session, one job per combination and
+ * session. The jobs are split into one contiguous range per thread, a thread that runs out steals the older half
+ * of the range of another one. A combination is scored per device class by its mean tilt error against the
+ * reference orientations of the sessions (drift) and the thread CPU time spent in fusion per sample (latency),
+ * and the combinations no other one beats on both are printed.
+ *
+ * The fusion code is built into the tool, the library doesn't export it.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "openhmdi.h"
+#include "recording.h"
+
+#define MAX_SESSIONS 256
+#define MAX_CLASSES 32
+#define MAX_VALUES 64
+#define MAX_SETS 1000000
+#define MAX_THREADS 256
+#define MAX_WINDOW 256  // largest accelerometer window, see ofusion_set_window
+
+typedef struct {
+	const char* path;
+	int class_idx;
+	fusion_sample* samples;
+	int count;
+	int* ref_index; // the samples with a reference orientation
+	vec3f* ref_up;  // world up in the body frame according to the reference, per reference
+	int ref_count;
+} session;
+
+typedef struct {
+	double error_sum, error_max; // tilt error in degrees
+	uint64_t cpu_ns;
+} job_result;
+
+// the jobs [head, tail) a thread still has to do, it works from the tail and others steal from the head
+typedef struct {
+	pthread_mutex_t lock;
+	int head, tail;
+	int thread_idx;
+	quatf* orient; // scratch, one per reference of the longest session
+	vec3f window[MAX_WINDOW];
+} worker;
+
+static const struct {
+	const char* name;
+	size_t offset;
+	bool is_int;
+} param_info[] = {
+	{ "grav_gain", offsetof(fusion_params, grav_gain), false },
+	{ "gravity_tolerance", offsetof(fusion_params, gravity_tolerance), false },
+	{ "ang_vel_tolerance", offsetof(fusion_params, ang_vel_tolerance), false },
+	{ "level_samples", offsetof(fusion_params, level_samples), true },
+	{ "window_size", offsetof(fusion_params, window_size), true },
+};
+
+#define NUM_PARAMS (int)(sizeof(param_info) / sizeof(param_info[0]))
+
+static session sessions[MAX_SESSIONS];
+static int num_sessions;
+static char class_names[MAX_CLASSES][64];
+static int num_classes;
+
+static fusion_params* sets;
+static int num_sets;
+
+static job_result* results; // num_sets * num_sessions
+static worker workers[MAX_THREADS];
+static int num_workers;
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void usage(const char* prog)
+{
+	printf("usage: %s [-j threads] [-p name=value,...]... [class=]file...\n", prog);
+	printf("  -j threads          worker threads (default: one per core)\n");
+	printf("  -p name=value,...   values to try for a parameter, the others keep their default:\n");
+	for(int i = 0; i < NUM_PARAMS; i++)
+		printf("                        %s\n", param_info[i].name);
+	printf("  class=file          a session recorded with a device of this class, such as rift-cv1, vive or wmr\n");
+	printf("\n");
+	printf("Every session needs reference orientations.\n");
+	recording_usage();
+}
+
+static void set_param(fusion_params* p, int param, double value)
+{
+	char* field = (char*)p + param_info[param].offset;
+
+	if(param_info[param].is_int)
+		*(int*)field = (int)value;
+	else
+		*(float*)field = (float)value;
+}
+
+static double get_param(const fusion_params* p, int param)
+{
+	const char* field = (const char*)p + param_info[param].offset;
+	return param_info[param].is_int ? *(const int*)field : *(const float*)field;
+}
+
+// -p name=v1,v2,...
+static bool parse_grid(const char* arg, double values[NUM_PARAMS][MAX_VALUES], int* counts)
+{
+	const char* eq = strchr(arg, '=');
+	if(!eq)
+		return false;
+
+	int param = -1;
+	for(int i = 0; i < NUM_PARAMS; i++)
+		if(strlen(param_info[i].name) == (size_t)(eq - arg) && strncmp(arg, param_info[i].name, eq - arg) == 0)
+			param = i;
+
+	if(param < 0){
+		fprintf(stderr, "unknown parameter %.*s\n", (int)(eq - arg), arg);
+		return false;
+	}
+
+	counts[param] = 0;
+	for(const char* p = eq + 1; *p; ){
+		char* end;
+		double v = strtod(p, &end);
+		if(end == p || counts[param] == MAX_VALUES){
+			fprintf(stderr, "bad values for %s\n", param_info[param].name);
+			return false;
+		}
+
+		values[param][counts[param]++] = v;
+		p = *end == ',' ? end + 1 : end;
+		if(*end != ',' && *end != '\0'){
+			fprintf(stderr, "bad values for %s\n", param_info[param].name);
+			return false;
+		}
+	}
+
+	return counts[param] > 0;
+}
+
+// the default parameters come first, followed by every valid combination of the grid
+static bool build_sets(double values[NUM_PARAMS][MAX_VALUES], const int* counts)
+{
+	double total = 1;
+	for(int i = 0; i < NUM_PARAMS; i++)
+		total *= counts[i];
+
+	if(total + 1 > MAX_SETS){
+		fprintf(stderr, "%.0f parameter sets, at most %d are supported\n", total, MAX_SETS);
+		return false;
+	}
+
+	sets = calloc((size_t)total + 1, sizeof(fusion_params));
+	if(!sets)
+		return false;
+
+	sets[num_sets++] = ofusion_default_params;
+
+	static vec3f check_window[MAX_WINDOW];
+	fusion check;
+	ofusion_init(&check);
+	ofusion_set_window(&check, check_window, MAX_WINDOW);
+
+	int skipped = 0;
+	for(int n = 0; n < (int)total; n++){
+		fusion_params p = ofusion_default_params;
+
+		for(int i = 0, rest = n; i < NUM_PARAMS; i++){
+			set_param(&p, i, values[i][rest % counts[i]]);
+			rest /= counts[i];
+		}
+
+		if(memcmp(&p, &ofusion_default_params, sizeof(p)) == 0)
+			continue;
+
+		if(!ofusion_set_params(&check, &p)){
+			skipped++;
+			continue;
+		}
+
+		sets[num_sets++] = p;
+	}
+
+	if(skipped > 0)
+		fprintf(stderr, "skipped %d parameter sets with values out of range\n", skipped);
+
+	return true;
+}
+
+// [class=]file
+static bool load_session(const char* arg)
+{
+	if(num_sessions == MAX_SESSIONS){
+		fprintf(stderr, "at most %d sessions are supported\n", MAX_SESSIONS);
+		return false;
+	}
+
+	session* s = &sessions[num_sessions];
+	const char* eq = strchr(arg, '=');
+	char class_name[64] = "all";
+
+	s->path = arg;
+	if(eq){
+		snprintf(class_name, sizeof(class_name), "%.*s", (int)(eq - arg), arg);
+		s->path = eq + 1;
+	}
+
+	s->class_idx = -1;
+	for(int i = 0; i < num_classes; i++)
+		if(strcmp(class_names[i], class_name) == 0)
+			s->class_idx = i;
+
+	if(s->class_idx < 0){
+		if(num_classes == MAX_CLASSES){
+			fprintf(stderr, "at most %d device classes are supported\n", MAX_CLASSES);
+			return false;
+		}
+		strcpy(class_names[num_classes], class_name);
+		s->class_idx = num_classes++;
+	}
+
+	recording rec;
+	if(!recording_load(s->path, &rec))
+		return false;
+
+	if(!rec.reference){
+		fprintf(stderr, "%s has no reference orientations\n", s->path);
+		recording_free(&rec);
+		return false;
+	}
+
+	s->samples = calloc(rec.count, sizeof(fusion_sample));
+	s->ref_index = calloc(rec.count, sizeof(int));
+	s->ref_up = calloc(rec.count, sizeof(vec3f));
+	if(!s->samples || !s->ref_index || !s->ref_up){
+		fprintf(stderr, "out of memory\n");
+		recording_free(&rec);
+		return false;
+	}
+
+	// the time steps as the external driver derives them, samples that are not newer are dropped
+	uint64_t last = 0;
+	for(int i = 0; i < rec.count; i++){
+		const ohmd_imu_sample* in = rec.samples + i;
+		if(s->count > 0 && in->timestamp_ns <= last)
+			continue;
+
+		fusion_sample* out = s->samples + s->count;
+		out->dt = s->count > 0 ? (float)(in->timestamp_ns - last) * 1e-9f : 0;
+		memcpy(out->ang_vel.arr, in->gyro, sizeof(out->ang_vel.arr));
+		memcpy(out->accel.arr, in->accel, sizeof(out->accel.arr));
+		memcpy(out->mag.arr, in->mag, sizeof(out->mag.arr));
+		last = in->timestamp_ns;
+
+		const float* ref = rec.reference[i];
+		if(!isnan(ref[0])){
+			quatf inv = {{ -ref[0], -ref[1], -ref[2], ref[3] }};
+			vec3f up = {{ 0, 1.0f, 0 }};
+			oquatf_normalize_me(&inv);
+			oquatf_get_rotated(&inv, &up, &s->ref_up[s->ref_count]);
+			s->ref_index[s->ref_count++] = s->count;
+		}
+
+		s->count++;
+	}
+
+	recording_free(&rec);
+	num_sessions++;
+
+	return true;
+}
+
+static void run_job(worker* w, int job)
+{
+	const fusion_params* params = &sets[job / num_sessions];
+	const session* s = &sessions[job % num_sessions];
+	job_result* result = &results[job];
+	fusion f;
+
+	ofusion_init(&f);
+	ofusion_set_window(&f, w->window, MAX_WINDOW);
+	ofusion_set_params(&f, params);
+
+	// only fusion and keeping the orientations for the scoring afterwards are timed
+	uint64_t start = thread_cpu_ns();
+	for(int i = 0, r = 0; i < s->count; i++){
+		ofusion_update_batch(&f, s->samples + i, 1);
+		if(r < s->ref_count && s->ref_index[r] == i)
+			w->orient[r++] = f.orient;
+	}
+	result->cpu_ns = thread_cpu_ns() - start;
+
+	result->error_sum = 0;
+	result->error_max = 0;
+	for(int r = 0; r < s->ref_count; r++){
+		quatf inv = {{ -w->orient[r].x, -w->orient[r].y, -w->orient[r].z, w->orient[r].w }};
+		vec3f up = {{ 0, 1.0f, 0 }}, est;
+		oquatf_get_rotated(&inv, &up, &est);
+
+		double dot = ovec3f_get_dot(&est, &s->ref_up[r]);
+		double error = acos(dot > 1.0 ? 1.0 : dot < -1.0 ? -1.0 : dot) * 180.0 / M_PI;
+
+		result->error_sum += error;
+		if(error > result->error_max)
+			result->error_max = error;
+	}
+}
+
+static bool pop_job(worker* w, int* job)
+{
+	pthread_mutex_lock(&w->lock);
+	bool ok = w->head < w->tail;
+	if(ok)
+		*job = --w->tail;
+	pthread_mutex_unlock(&w->lock);
+
+	return ok;
+}
+
+// takes the older half of the jobs another thread has left
+static bool steal_jobs(worker* w)
+{
+	for(int i = 1; i < num_workers; i++){
+		worker* victim = &workers[(w->thread_idx + i) % num_workers];
+
+		pthread_mutex_lock(&victim->lock);
+		int left = victim->tail - victim->head;
+		int take = (left + 1) / 2;
+		int head = victim->head;
+		victim->head += take;
+		pthread_mutex_unlock(&victim->lock);
+
+		if(take > 0){
+			pthread_mutex_lock(&w->lock);
+			w->head = head;
+			w->tail = head + take;
+			pthread_mutex_unlock(&w->lock);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void* work(void* arg)
+{
+	worker* w = (worker*)arg;
+	int job;
+
+	// no jobs are added while running, once nothing is left to steal everything is done or being done
+	do{
+		while(pop_job(w, &job))
+			run_job(w, job);
+	}while(steal_jobs(w));
+
+	return NULL;
+}
+
+static void print_set(const char* label, int set, int class_idx)
+{
+	double error_sum = 0, error_max = 0, cpu_ns = 0, refs = 0, samples = 0;
+
+	for(int s = 0; s < num_sessions; s++){
+		if(sessions[s].class_idx != class_idx)
+			continue;
+
+		const job_result* r = &results[set * num_sessions + s];
+		error_sum += r->error_sum;
+		error_max = r->error_max > error_max ? r->error_max : error_max;
+		cpu_ns += (double)r->cpu_ns;
+		refs += sessions[s].ref_count;
+		samples += sessions[s].count;
+	}
+
+	const fusion_params* p = &sets[set];
+	printf("  %-8s %9.4f %9.3f %9.3f %7d %7d   %8.3f %8.3f %8.1f\n", label, p->grav_gain, p->gravity_tolerance,
+	       p->ang_vel_tolerance, p->level_samples, p->window_size, refs > 0 ? error_sum / refs : 0, error_max,
+	       cpu_ns / samples);
+}
+
+typedef struct {
+	int set;
+	double drift, latency;
+} score;
+
+static int compare_scores(const void* a, const void* b)
+{
+	const score* x = (const score*)a;
+	const score* y = (const score*)b;
+
+	if(x->drift != y->drift)
+		return x->drift < y->drift ? -1 : 1;
+	return x->latency < y->latency ? -1 : x->latency > y->latency;
+}
+
+static void print_class(int class_idx, score* scores)
+{
+	int class_sessions = 0, refs = 0, samples = 0;
+	for(int s = 0; s < num_sessions; s++){
+		if(sessions[s].class_idx == class_idx){
+			class_sessions++;
+			refs += sessions[s].ref_count;
+			samples += sessions[s].count;
+		}
+	}
+
+	for(int set = 0; set < num_sets; set++){
+		double error_sum = 0, cpu_ns = 0;
+		for(int s = 0; s < num_sessions; s++){
+			if(sessions[s].class_idx == class_idx){
+				error_sum += results[set * num_sessions + s].error_sum;
+				cpu_ns += (double)results[set * num_sessions + s].cpu_ns;
+			}
+		}
+
+		scores[set].set = set;
+		scores[set].drift = refs > 0 ? error_sum / refs : 0;
+		scores[set].latency = cpu_ns / samples;
+	}
+
+	printf("%s: %d sessions, %d samples, %d parameter sets\n", class_names[class_idx], class_sessions, samples,
+	       num_sets);
+	printf("  %-8s %9s %9s %9s %7s %7s   %8s %8s %8s\n", "", "grav_gain", "grav_tol", "angv_tol", "level",
+	       "window", "drift", "max", "ns");
+	print_set("default", 0, class_idx);
+
+	// sorted by drift, a set is on the front when it is faster than every set that drifts less
+	qsort(scores, num_sets, sizeof(score), compare_scores);
+
+	double best_latency = INFINITY;
+	for(int i = 0; i < num_sets; i++){
+		if(scores[i].latency < best_latency){
+			best_latency = scores[i].latency;
+			print_set("pareto", scores[i].set, class_idx);
+		}
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	double values[NUM_PARAMS][MAX_VALUES];
+	int counts[NUM_PARAMS];
+	int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	for(int i = 0; i < NUM_PARAMS; i++){
+		values[i][0] = get_param(&ofusion_default_params, i);
+		counts[i] = 1;
+	}
+
+	omath_init();
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+			threads = atoi(argv[++i]);
+		}else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc){
+			if(!parse_grid(argv[++i], values, counts))
+				return 1;
+		}else if(argv[i][0] != '-'){
+			if(!load_session(argv[i]))
+				return 1;
+		}else{
+			usage(argv[0]);
+			return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+		}
+	}
+
+	if(num_sessions == 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(!build_sets(values, counts))
+		return 1;
+
+	int num_jobs = num_sets * num_sessions;
+	results = calloc(num_jobs, sizeof(job_result));
+	if(!results){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int max_refs = 0;
+	for(int s = 0; s < num_sessions; s++)
+		max_refs = sessions[s].ref_count > max_refs ? sessions[s].ref_count : max_refs;
+
+	num_workers = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+	if(num_workers > num_jobs)
+		num_workers = num_jobs;
+
+	pthread_t ids[MAX_THREADS];
+	for(int i = 0; i < num_workers; i++){
+		worker* w = &workers[i];
+		pthread_mutex_init(&w->lock, NULL);
+		w->head = (int)((int64_t)num_jobs * i / num_workers);
+		w->tail = (int)((int64_t)num_jobs * (i + 1) / num_workers);
+		w->thread_idx = i;
+		w->orient = malloc(sizeof(quatf) * (max_refs > 0 ? max_refs : 1));
+		if(!w->orient){
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+	}
+
+	fprintf(stderr, "running %d jobs on %d threads\n", num_jobs, num_workers);
+
+	for(int i = 1; i < num_workers; i++)
+		pthread_create(&ids[i], NULL, work, &workers[i]);
+	work(&workers[0]);
+	for(int i = 1; i < num_workers; i++)
+		pthread_join(ids[i], NULL);
+
+	score* scores = malloc(sizeof(score) * num_sets);
+	if(!scores){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	printf("drift is the mean tilt error in degrees, max the largest one, ns the fusion time per sample\n\n");
+	for(int c = 0; c < num_classes; c++)
+		print_class(c, scores);
+
+	return 0;
+}